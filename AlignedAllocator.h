@@ -0,0 +1,133 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include "pstdint.h"
+#include "AllocationTracker.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
+//Bytes the CPU moves between memory and cache at a time.
+const uint32_t CACHE_LINE_SIZE = 64;
+
+//size bytes starting on a multiple of alignment, a power of two at least
+//sizeof(void*). Null if out of memory. Free with AlignedFree.
+inline void* AlignedMalloc(size_t size, size_t alignment)
+{
+    if(IsAllocationTrackingEnabled())
+    {
+        NoteAllocation(size);
+    }
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    void* memory = 0;
+    if(posix_memalign(&memory, alignment, size) != 0)
+    {
+        return 0;
+    }
+    return memory;
+#endif
+}
+
+inline void AlignedFree(void* memory)
+{
+    if(memory && IsAllocationTrackingEnabled())
+    {
+        NoteFree();
+    }
+#if defined(_WIN32)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+//Standard allocator whose blocks start on an ALIGNMENT byte boundary, so
+//element 0 of a std::vector using it starts a cache line and a vector of
+//8 byte elements packs 8 to a line with none straddling two.
+template<class T, size_t ALIGNMENT>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, ALIGNMENT> other;
+    };
+
+    AlignedAllocator() {}
+    AlignedAllocator(const AlignedAllocator&) {}
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+    pointer address(reference value) const
+    {
+        return &value;
+    }
+    const_pointer address(const_reference value) const
+    {
+        return &value;
+    }
+
+    pointer allocate(size_type count, const void* = 0)
+    {
+        if(count > max_size())
+        {
+            throw std::bad_alloc();
+        }
+        void* memory = AlignedMalloc(count * sizeof(T), ALIGNMENT);
+        if(!memory)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(memory);
+    }
+
+    void deallocate(pointer memory, size_type)
+    {
+        AlignedFree(memory);
+    }
+
+    size_type max_size() const
+    {
+        return static_cast<size_type>(-1) / sizeof(T);
+    }
+
+    void construct(pointer memory, const T& value)
+    {
+        new(static_cast<void*>(memory)) T(value);
+    }
+
+    void destroy(pointer memory)
+    {
+        memory->~T();
+    }
+};
+
+template<class T, class U, size_t ALIGNMENT>
+inline bool operator==(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&)
+{
+    return true;
+}
+
+template<class T, class U, size_t ALIGNMENT>
+inline bool operator!=(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&)
+{
+    return false;
+}
+
+#endif
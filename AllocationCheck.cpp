@@ -0,0 +1,101 @@
+//Checks that frames of a game in steady state make no heap allocations.
+//Usage: AllocationCheck [-frames N] [-warmup N] [-seed N]
+//Plays -frames N frames (default ten minutes at 60Hz) of GameScreen on a
+//HeadlessInvaders with a stepped clock and random keys from -seed N,
+//starting a new game whenever the last one is lost. Allocations are
+//counted by AllocationTracker.h from frame -warmup N on (default 0, as
+//ResetLevel already makes room for what a game needs). Logs the first
+//frames that allocate and exits 1 if any did.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "AllocationTracker.h"
+#include "Game.h"
+#include "HeadlessInvaders.h"
+
+namespace
+{
+    const int WINDOW_WIDTH = 1280;
+    const int WINDOW_HEIGHT = 720;
+    const float FRAMES_PER_SECOND = 60.0f;
+
+    //Seconds between scripted key changes on average.
+    const float KEY_INTERVAL = 0.1f;
+}
+
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t numFrames = GetOptionInt(argc, argv, "-frames", 36000);
+    const uint32_t warmupFrames = GetOptionInt(argc, argv, "-warmup", 0);
+    const uint32_t seed = GetOptionInt(argc, argv, "-seed", 1);
+
+    HeadlessInvaders* system = new HeadlessInvaders(FRAMES_PER_SECOND, numFrames + 1);
+    system->useSteppedClock();
+    system->injectRandomKeys(seed, static_cast<uint32_t>(numFrames / FRAMES_PER_SECOND / KEY_INTERVAL) + 1,
+        0.0f, KEY_INTERVAL);
+    system->init(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    GameState* state = new GameState(WINDOW_WIDTH, WINDOW_HEIGHT);
+    InitLevel(system, *state);
+
+    EnableAllocationTracking();
+
+    uint32_t numGames = 1;
+    for(uint32_t frame = 0; frame < numFrames; ++frame)
+    {
+        if(frame == warmupFrames)
+        {
+            ResetAllocationFrameStats();
+        }
+        if(!state->mPlayerLives)
+        {
+            ResetLevel(*state, system->getElapsedTime());
+            numGames++;
+        }
+
+        GameScreen(system, 0, 0, 0, *state);
+        system->update();
+    }
+
+    AllocationFrameStats stats;
+    GetAllocationFrameStats(stats);
+    std::printf("%u frames, %u games, %u frames checked after %u warm-up frames\n",
+        numFrames, numGames, stats.mFrames, std::min(warmupFrames, numFrames));
+    std::printf("%u frames allocated, %u allocations, %llu bytes, at most %u in a frame\n",
+        stats.mAllocatingFrames, stats.mAllocations,
+        static_cast<unsigned long long>(stats.mBytes), stats.mMaxAllocations);
+    std::printf("Frame arena: %.1f KB at most in a frame of %.1f KB, %u frames overflowed\n",
+        state->mArena.getHighWater() / 1024.0, state->mArena.getCapacity() / 1024.0,
+        state->mArena.getOverflows());
+
+    for(uint32_t index = 0; index < NUM_OBJECT_TYPES; ++index)
+    {
+        state->mSprites[index]->destroy();
+    }
+    delete state;
+    system->destroy();
+
+    if(stats.mAllocatingFrames)
+    {
+        std::printf("FAILED: frame %u was the first to allocate\n",
+            warmupFrames + stats.mFirstAllocatingFrame);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
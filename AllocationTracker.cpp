@@ -0,0 +1,199 @@
+#include "AllocationTracker.h"
+#include "Atomics.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    //Allocating frames logged after each ResetAllocationFrameStats.
+    const uint32_t MAX_LOGGED_FRAMES = 8;
+
+    struct AllocationTracker
+    {
+        bool mEnabled;//Set before any other thread starts.
+        volatile int32_t mAllocations;
+        volatile int32_t mFrees;
+        volatile int32_t mBytes;
+
+        //Only the thread running GameScreen touches these.
+        AllocationCounts mFrameStart;
+        AllocationFrameStats mStats;
+        uint32_t mLoggedFrames;
+    };
+
+    //Zero initialised before any constructor runs, so allocations made
+    //while other globals are constructed find it ready.
+    AllocationTracker gTracker;
+
+    void* Allocate(size_t size)
+    {
+        if(gTracker.mEnabled)
+        {
+            NoteAllocation(size);
+        }
+        return std::malloc(size ? size : 1);
+    }
+
+    void Free(void* memory)
+    {
+        if(memory && gTracker.mEnabled)
+        {
+            NoteFree();
+        }
+        std::free(memory);
+    }
+}
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+    void* memory = Allocate(size);
+    if(!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+    void* memory = Allocate(size);
+    if(!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+    return Allocate(size);
+}
+
+void operator delete(void* memory) throw()
+{
+    Free(memory);
+}
+
+void operator delete[](void* memory) throw()
+{
+    Free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) throw()
+{
+    Free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) throw()
+{
+    Free(memory);
+}
+
+void EnableAllocationTracking()
+{
+    gTracker.mEnabled = true;
+    ResetAllocationFrameStats();
+}
+
+bool IsAllocationTrackingEnabled()
+{
+    return gTracker.mEnabled;
+}
+
+void GetAllocationCounts(AllocationCounts& counts)
+{
+    counts.mAllocations = static_cast<uint32_t>(AtomicLoad(&gTracker.mAllocations));
+    counts.mFrees = static_cast<uint32_t>(AtomicLoad(&gTracker.mFrees));
+    counts.mBytes = static_cast<uint32_t>(AtomicLoad(&gTracker.mBytes));
+}
+
+void NoteAllocation(size_t bytes)
+{
+    AtomicIncrement(&gTracker.mAllocations);
+    AtomicAdd(&gTracker.mBytes, static_cast<int32_t>(bytes));
+}
+
+void NoteFree()
+{
+    AtomicIncrement(&gTracker.mFrees);
+}
+
+void AllocationFrameBegin()
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+    GetAllocationCounts(gTracker.mFrameStart);
+}
+
+void AllocationFrameEnd()
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+
+    AllocationCounts end;
+    GetAllocationCounts(end);
+    const uint32_t allocations = end.mAllocations - gTracker.mFrameStart.mAllocations;
+    const uint32_t bytes = end.mBytes - gTracker.mFrameStart.mBytes;
+
+    AllocationFrameStats& stats = gTracker.mStats;
+    if(allocations)
+    {
+        if(!stats.mAllocatingFrames)
+        {
+            stats.mFirstAllocatingFrame = stats.mFrames;
+        }
+        stats.mAllocatingFrames++;
+        stats.mAllocations += allocations;
+        stats.mBytes += bytes;
+        stats.mMaxAllocations = std::max(stats.mMaxAllocations, allocations);
+
+        if(gTracker.mLoggedFrames < MAX_LOGGED_FRAMES)
+        {
+            gTracker.mLoggedFrames++;
+            LogMessage("Frame %u: %u allocations, %u bytes, %u frees", stats.mFrames, allocations, bytes,
+                end.mFrees - gTracker.mFrameStart.mFrees);
+        }
+    }
+    stats.mFrames++;
+}
+
+void GetAllocationFrameStats(AllocationFrameStats& stats)
+{
+    stats = gTracker.mStats;
+}
+
+void ResetAllocationFrameStats()
+{
+    AllocationFrameStats& stats = gTracker.mStats;
+    stats.mFrames = 0;
+    stats.mAllocatingFrames = 0;
+    stats.mAllocations = 0;
+    stats.mBytes = 0;
+    stats.mMaxAllocations = 0;
+    stats.mFirstAllocatingFrame = 0;
+    gTracker.mLoggedFrames = 0;
+}
+
+void LogAllocationReport()
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+
+    const AllocationFrameStats& stats = gTracker.mStats;
+    LogMessage("Allocations: %u of %u frames allocated, %u allocations, %.1f KB, at most %u in a frame",
+        stats.mAllocatingFrames, stats.mFrames, stats.mAllocations,
+        static_cast<double>(stats.mBytes) / 1024.0, stats.mMaxAllocations);
+}
@@ -0,0 +1,58 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cstddef>
+#include "pstdint.h"
+
+//Counts heap allocations made through operator new, new[] and
+//AlignedMalloc, which between them are every allocation the game's own
+//code makes. AllocationTracker.cpp replaces the global operators, so
+//linking it in is all it takes. Counting is off by default and the
+//operators only test a flag until it is enabled.
+//
+//GameScreen brackets each frame with AllocationFrameBegin and
+//AllocationFrameEnd, which give the counts per frame. Allocations are
+//counted on every thread, so a frame's counts include whatever other
+//threads allocated meanwhile.
+void EnableAllocationTracking();
+bool IsAllocationTrackingEnabled();
+
+struct AllocationCounts
+{
+    uint32_t mAllocations;
+    uint32_t mFrees;
+    uint32_t mBytes;//Wraps. Differences are right below 4GB.
+};
+
+//Totals since tracking was enabled.
+void GetAllocationCounts(AllocationCounts& counts);
+
+//For allocators that do not go through operator new.
+void NoteAllocation(size_t bytes);
+void NoteFree();
+
+void AllocationFrameBegin();
+void AllocationFrameEnd();
+
+//Frames bracketed since tracking was enabled or the stats were last
+//reset.
+struct AllocationFrameStats
+{
+    uint32_t mFrames;
+    uint32_t mAllocatingFrames;
+    uint32_t mAllocations;
+    uint64_t mBytes;
+    uint32_t mMaxAllocations;//In one frame.
+    uint32_t mFirstAllocatingFrame;//Of mFrames, if mAllocatingFrames.
+};
+
+void GetAllocationFrameStats(AllocationFrameStats& stats);
+
+//Start the stats again, say once a game has warmed up. The first few
+//frames that allocate after this are logged as they end.
+void ResetAllocationFrameStats();
+
+//Log the frame stats.
+void LogAllocationReport();
+
+#endif
@@ -0,0 +1,180 @@
+#include "AssetLoader.h"
+#include "Bitmap.h"
+#include "Log.h"
+#include "StartupTimeline.h"
+#include "Timer.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    //Smallest page size of the platforms the game runs on.
+    const uint32_t PAGE_SIZE = 4096;
+}
+
+//The whole file, or false if it cannot be read.
+static bool ReadWholeFile(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* file = std::fopen(path, "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    data.clear();
+    uint8_t buffer[4096];
+    size_t bytesRead;
+    while((bytesRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + bytesRead);
+    }
+    std::fclose(file);
+    return !data.empty();
+}
+
+//Read a word of every page of pixels, so a mapping faults them in now.
+static void TouchPages(const uint32_t* pixels, const uint32_t count)
+{
+    volatile uint32_t sink = 0;
+    const uint32_t wordsPerPage = PAGE_SIZE / sizeof(uint32_t);
+    for(uint32_t index = 0; index < count; index += wordsPerPage)
+    {
+        sink += pixels[index];
+    }
+    if(count)
+    {
+        sink += pixels[count - 1];
+    }
+}
+
+AssetLoader::AssetLoader(uint32_t numThreads) : mPool(numThreads > 1 ? numThreads - 1 : 0),
+    mWidth(0),
+    mHeight(0),
+    mbRunning(false)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    finish();
+}
+
+void AssetLoader::start(const char* atlasPath,
+                        const char* const* paths,
+                        const uint32_t count,
+                        const uint32_t width,
+                        const uint32_t height)
+{
+    finish();
+
+    if(atlasPath && width)
+    {
+        StartupSpan span("map", atlasPath);
+        mAtlas.open(atlasPath);
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mAssets.resize(count);
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        Asset& asset = mAssets[index];
+        asset.mPath = paths[index];
+        asset.mPixels = 0;
+        asset.mDecoded.clear();
+        asset.mBytesRead = 0;
+        asset.mNanoseconds = 0;
+        asset.mbFromAtlas = false;
+    }
+
+    mPool.beginParallelFor(count, 1, LoadAssets, this);
+    mbRunning = true;
+}
+
+void AssetLoader::finish()
+{
+    if(mbRunning)
+    {
+        mPool.endParallelFor();
+        mbRunning = false;
+    }
+}
+
+const uint32_t* AssetLoader::getPixels(const char* path)
+{
+    finish();
+
+    for(size_t index = 0; index < mAssets.size(); ++index)
+    {
+        if(std::strcmp(mAssets[index].mPath, path) == 0)
+        {
+            return mAssets[index].mPixels;
+        }
+    }
+    return 0;
+}
+
+void AssetLoader::LoadAssets(void* context, uint32_t begin, uint32_t end)
+{
+    AssetLoader& loader = *static_cast<AssetLoader*>(context);
+    const uint32_t numPixels = loader.mWidth * loader.mHeight;
+
+    for(uint32_t index = begin; index < end; ++index)
+    {
+        Asset& asset = loader.mAssets[index];
+        const uint64_t startTime = GetTimeNanoseconds();
+
+        const uint32_t* atlasPixels = numPixels ? loader.mAtlas.find(asset.mPath, loader.mWidth, loader.mHeight) : 0;
+        if(atlasPixels)
+        {
+            StartupSpan span("atlas", asset.mPath);
+            TouchPages(atlasPixels, numPixels);
+            asset.mPixels = atlasPixels;
+            asset.mbFromAtlas = true;
+        }
+        else
+        {
+            StartupSpan span(numPixels ? "decode" : "read", asset.mPath);
+            std::vector<uint8_t> data;
+            if(ReadWholeFile(asset.mPath, data))
+            {
+                asset.mBytesRead = static_cast<uint32_t>(data.size());
+                if(numPixels)
+                {
+                    asset.mDecoded.resize(numPixels);
+                    if(DecodeBmp(&data[0], data.size(), &asset.mDecoded[0], loader.mWidth, loader.mHeight))
+                    {
+                        asset.mPixels = &asset.mDecoded[0];
+                    }
+                }
+            }
+        }
+
+        asset.mNanoseconds = GetTimeNanoseconds() - startTime;
+    }
+}
+
+void AssetLoader::logStats() const
+{
+    uint32_t numFromAtlas = 0;
+    uint32_t numLoaded = 0;
+    uint32_t numFilesRead = 0;
+    uint32_t bytesRead = 0;
+    uint64_t nanoseconds = 0;
+    for(size_t index = 0; index < mAssets.size(); ++index)
+    {
+        const Asset& asset = mAssets[index];
+        numFromAtlas += asset.mbFromAtlas;
+        numLoaded += asset.mPixels != 0;
+        numFilesRead += asset.mBytesRead != 0;
+        bytesRead += asset.mBytesRead;
+        nanoseconds += asset.mNanoseconds;
+    }
+
+    LogMessage("Assets: %u of %u sprites loaded on %u threads, %u from the atlas (%u bytes mapped), "
+        "%u files read (%u bytes), %.3f ms of jobs",
+        numLoaded, static_cast<uint32_t>(mAssets.size()), mPool.getNumThreads(),
+        numFromAtlas, static_cast<uint32_t>(mAtlas.getSize()),
+        numFilesRead, bytesRead,
+        NanosecondsToMilliseconds(nanoseconds));
+}
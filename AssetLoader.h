@@ -0,0 +1,71 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <vector>
+#include "pstdint.h"
+#include "SpriteAtlas.h"
+#include "ThreadPool.h"
+
+//Loads the sprites on worker threads while the rest of startup goes on.
+//start() hands one job per sprite to the pool and returns. A job takes
+//the sprite from the atlas, touching its pixels so the mapping faults
+//them in there and not on the first draw, or else reads and decodes its
+//BMP. finish() runs what the workers have not got to and waits for the
+//rest; getPixels() finishes first, so the first sprite created waits for
+//all of them. With 0 workers every job runs in finish().
+//
+//Each job is a span on the startup timeline, see StartupTimeline.h.
+class AssetLoader
+{
+public:
+    //numThreads counts the calling thread, as ThreadPool does.
+    explicit AssetLoader(uint32_t numThreads);
+    ~AssetLoader();
+
+    //Load paths at width by height pixels, from atlasPath if it is not
+    //null and has them. A width of 0 only reads the files, which puts
+    //them in the OS file cache for a backend that loads them itself.
+    //paths must outlive the loader.
+    void start(const char* atlasPath,
+               const char* const* paths,
+               const uint32_t count,
+               const uint32_t width,
+               const uint32_t height);
+
+    //Wait until every job is done. Does nothing if there are none.
+    void finish();
+
+    //Pixels of path, top row first, or null if it was not started or
+    //could not be loaded. They last as long as the loader.
+    const uint32_t* getPixels(const char* path);
+
+    //Sprites from the atlas and from files, file bytes read and the time
+    //the jobs took between them. Call after finish().
+    void logStats() const;
+
+private:
+    AssetLoader(const AssetLoader&);
+    AssetLoader& operator=(const AssetLoader&);
+
+    static void LoadAssets(void* context, uint32_t begin, uint32_t end);
+
+    struct Asset
+    {
+        const char* mPath;
+        const uint32_t* mPixels;//In the atlas or mDecoded.
+        std::vector<uint32_t> mDecoded;
+        uint32_t mBytesRead;
+        uint64_t mNanoseconds;
+        bool mbFromAtlas;
+    };
+
+private:
+    ThreadPool mPool;
+    SpriteAtlas mAtlas;
+    std::vector<Asset> mAssets;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    bool mbRunning;//Between start() and finish().
+};
+
+#endif
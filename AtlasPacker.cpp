@@ -0,0 +1,84 @@
+//Build step that decodes sprite BMPs into a single SpriteAtlas file.
+//Usage: AtlasPacker <output.atlas> <sprite.bmp>...
+//Entries are named by the path given on the command line, which must match
+//the name later passed to IDiceInvaders::createSprite.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Bitmap.h"
+#include "SpriteAtlas.h"
+
+const uint32_t SPRITE_PIXELS = 32;
+
+static uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s <output.atlas> <sprite.bmp>...\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t numEntries = static_cast<uint32_t>(argc - 2);
+    const uint32_t blockSize = SPRITE_PIXELS * SPRITE_PIXELS * sizeof(uint32_t);
+
+    std::vector<AtlasEntry> entries(numEntries);
+    uint32_t offset = AlignUp(sizeof(AtlasHeader) + numEntries * sizeof(AtlasEntry), ATLAS_ALIGNMENT);
+
+    std::vector<uint8_t> file(offset + numEntries * AlignUp(blockSize, ATLAS_ALIGNMENT), 0);
+
+    for(uint32_t index = 0; index < numEntries; ++index)
+    {
+        const char* path = argv[index + 2];
+        if(std::strlen(path) >= ATLAS_NAME_SIZE)
+        {
+            std::fprintf(stderr, "%s: name longer than %u characters\n", path, ATLAS_NAME_SIZE - 1);
+            return 1;
+        }
+
+        if(!LoadBmp(path, reinterpret_cast<uint32_t*>(&file[offset]), SPRITE_PIXELS, SPRITE_PIXELS))
+        {
+            std::fprintf(stderr, "%s: not a %ux%u 24/32-bit BMP\n", path, SPRITE_PIXELS, SPRITE_PIXELS);
+            return 1;
+        }
+
+        AtlasEntry& entry = entries[index];
+        std::memset(&entry, 0, sizeof(entry));
+        std::strcpy(entry.mName, path);
+        entry.mWidth = SPRITE_PIXELS;
+        entry.mHeight = SPRITE_PIXELS;
+        entry.mOffset = offset;
+
+        offset += AlignUp(blockSize, ATLAS_ALIGNMENT);
+    }
+
+    AtlasHeader header;
+    header.mMagic = ATLAS_MAGIC;
+    header.mVersion = ATLAS_VERSION;
+    header.mNumEntries = numEntries;
+    header.mFileSize = static_cast<uint32_t>(file.size());
+
+    std::memcpy(&file[0], &header, sizeof(header));
+    std::memcpy(&file[sizeof(header)], &entries[0], numEntries * sizeof(AtlasEntry));
+
+    FILE* out = std::fopen(argv[1], "wb");
+    if(!out || std::fwrite(&file[0], 1, file.size(), out) != file.size())
+    {
+        std::fprintf(stderr, "%s: write failed\n", argv[1]);
+        if(out)
+        {
+            std::fclose(out);
+        }
+        return 1;
+    }
+    std::fclose(out);
+
+    std::printf("%s: %u sprites, %u bytes\n", argv[1], numEntries, header.mFileSize);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef ATOMICS_H
+#define ATOMICS_H
+
+#include "pstdint.h"
+
+//Minimal set of 32-bit atomic operations. All operations are full
+//barriers except the plain load/store which are acquire/release.
+//AtomicFence is a full barrier on its own.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+inline int32_t AtomicIncrement(volatile int32_t* value)
+{
+    return _InterlockedIncrement(reinterpret_cast<volatile long*>(value));
+}
+
+inline int32_t AtomicDecrement(volatile int32_t* value)
+{
+    return _InterlockedDecrement(reinterpret_cast<volatile long*>(value));
+}
+
+//Returns the value before the addition.
+inline int32_t AtomicAdd(volatile int32_t* value, int32_t amount)
+{
+    return _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(value), amount);
+}
+
+//Returns the value before the exchange.
+inline int32_t AtomicCompareExchange(volatile int32_t* value, int32_t exchange, int32_t comparand)
+{
+    return _InterlockedCompareExchange(reinterpret_cast<volatile long*>(value), exchange, comparand);
+}
+
+inline int32_t AtomicLoad(const volatile int32_t* value)
+{
+    //Volatile reads have acquire semantics with MSVC on x86/x64.
+    const int32_t result = *value;
+    _ReadWriteBarrier();
+    return result;
+}
+
+inline void AtomicStore(volatile int32_t* value, int32_t newValue)
+{
+    //Volatile writes have release semantics with MSVC on x86/x64.
+    _ReadWriteBarrier();
+    *value = newValue;
+}
+
+inline void AtomicFence()
+{
+    _ReadWriteBarrier();
+    _mm_mfence();
+    _ReadWriteBarrier();
+}
+
+#else
+
+inline int32_t AtomicIncrement(volatile int32_t* value)
+{
+    return __sync_add_and_fetch(value, 1);
+}
+
+inline int32_t AtomicDecrement(volatile int32_t* value)
+{
+    return __sync_sub_and_fetch(value, 1);
+}
+
+//Returns the value before the addition.
+inline int32_t AtomicAdd(volatile int32_t* value, int32_t amount)
+{
+    return __sync_fetch_and_add(value, amount);
+}
+
+//Returns the value before the exchange.
+inline int32_t AtomicCompareExchange(volatile int32_t* value, int32_t exchange, int32_t comparand)
+{
+    return __sync_val_compare_and_swap(value, comparand, exchange);
+}
+
+inline int32_t AtomicLoad(const volatile int32_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+inline void AtomicStore(volatile int32_t* value, int32_t newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+inline void AtomicFence()
+{
+    __sync_synchronize();
+}
+
+#endif
+
+#endif
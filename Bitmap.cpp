@@ -0,0 +1,98 @@
+#include "Bitmap.h"
+#include <cstdio>
+#include <vector>
+
+static uint32_t ReadU16(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t ReadU32(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+bool DecodeBmp(const uint8_t* data,
+               size_t size,
+               uint32_t* pixels,
+               uint32_t width,
+               uint32_t height)
+{
+    //BITMAPFILEHEADER (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes).
+    const size_t HeaderSize = 14 + 40;
+    if(size < HeaderSize || data[0] != 'B' || data[1] != 'M')
+    {
+        return false;
+    }
+
+    const uint32_t pixelOffset = ReadU32(data + 10);
+    const int32_t bmpWidth = static_cast<int32_t>(ReadU32(data + 18));
+    const int32_t bmpHeight = static_cast<int32_t>(ReadU32(data + 22));
+    const uint32_t bitsPerPixel = ReadU16(data + 28);
+    const uint32_t compression = ReadU32(data + 30);
+
+    //Only BI_RGB and BI_BITFIELDS with the default masks are supported.
+    if(compression != 0 && compression != 3)
+    {
+        return false;
+    }
+
+    if(bitsPerPixel != 24 && bitsPerPixel != 32)
+    {
+        return false;
+    }
+
+    //Negative height means the rows are stored top-down.
+    const bool bTopDown = bmpHeight < 0;
+    const uint32_t absHeight = static_cast<uint32_t>(bTopDown ? -bmpHeight : bmpHeight);
+    if(static_cast<uint32_t>(bmpWidth) != width || absHeight != height)
+    {
+        return false;
+    }
+
+    const uint32_t bytesPerPixel = bitsPerPixel / 8;
+    const uint32_t stride = (width * bytesPerPixel + 3) & ~3u;
+    if(pixelOffset + static_cast<size_t>(stride) * height > size)
+    {
+        return false;
+    }
+
+    for(uint32_t y = 0; y < height; ++y)
+    {
+        const uint32_t srcRow = bTopDown ? y : (height - 1 - y);
+        const uint8_t* src = data + pixelOffset + srcRow * stride;
+        uint32_t* dst = pixels + y * width;
+
+        for(uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t rgb = src[0] | (src[1] << 8) | (src[2] << 16);
+            dst[x] = rgb ? (rgb | 0xFF000000) : TRANSPARENT_PIXEL;
+            src += bytesPerPixel;
+        }
+    }
+
+    return true;
+}
+
+bool LoadBmp(const char* path,
+             uint32_t* pixels,
+             uint32_t width,
+             uint32_t height)
+{
+    FILE* file = std::fopen(path, "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t bytesRead;
+    while((bytesRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + bytesRead);
+    }
+    std::fclose(file);
+
+    return !data.empty() && DecodeBmp(&data[0], data.size(), pixels, width, height);
+}
@@ -0,0 +1,26 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <cstddef>
+#include "pstdint.h"
+
+//Decoded pixels are 32-bit 0xAARRGGBB, stored top row first. Black is the
+//transparent colour of the sprite bitmaps so it decodes to 0 and
+//every other colour gets an alpha of 0xFF.
+const uint32_t TRANSPARENT_PIXEL = 0;
+
+//Decode an uncompressed 24 or 32 bit BMP held in memory. The image must be
+//exactly width*height pixels.
+bool DecodeBmp(const uint8_t* data,
+               size_t size,
+               uint32_t* pixels,
+               uint32_t width,
+               uint32_t height);
+
+//Read and decode a BMP file.
+bool LoadBmp(const char* path,
+             uint32_t* pixels,
+             uint32_t width,
+             uint32_t height);
+
+#endif
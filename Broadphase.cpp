@@ -0,0 +1,333 @@
+#include "Broadphase.h"
+#include "Narrowphase.h"
+#include <algorithm>
+
+namespace
+{
+    //Each table's interval across, from an object's x.
+    const float BOX_LEFTS[NUM_TABLES] =
+    {
+        TableTraits<TABLE_PLAYER>::BOX_LEFT,
+        TableTraits<TABLE_ALIENS>::BOX_LEFT,
+        TableTraits<TABLE_BOMBS>::BOX_LEFT,
+        TableTraits<TABLE_ROCKETS>::BOX_LEFT,
+    };
+    const float BOX_RIGHTS[NUM_TABLES] =
+    {
+        TableTraits<TABLE_PLAYER>::BOX_RIGHT,
+        TableTraits<TABLE_ALIENS>::BOX_RIGHT,
+        TableTraits<TABLE_BOMBS>::BOX_RIGHT,
+        TableTraits<TABLE_ROCKETS>::BOX_RIGHT,
+    };
+
+    //The tables of each rule, for the sweep.
+    const TableId RULE_SHOTS[NUM_COLLISION_RULES] =
+    {
+        RuleTraits<RULE_ROCKETS_ALIENS>::SHOTS,
+        RuleTraits<RULE_ROCKETS_BOMBS>::SHOTS,
+        RuleTraits<RULE_BOMBS_PLAYER>::SHOTS,
+    };
+    const TableId RULE_TARGETS[NUM_COLLISION_RULES] =
+    {
+        RuleTraits<RULE_ROCKETS_ALIENS>::TARGETS,
+        RuleTraits<RULE_ROCKETS_BOMBS>::TARGETS,
+        RuleTraits<RULE_BOMBS_PLAYER>::TARGETS,
+    };
+
+    //Moves per object past which the insertion sort hands over to
+    //std::sort. A frame's order is within a few moves of the last one's.
+    const uint32_t MAX_SORT_MOVES_PER_ENTRY = 4;
+
+    //The most pairs of a rule in a scene of rows, see MaxTableRows.
+    //Projectiles are narrower than a sprite, so each overlaps no more than
+    //MaxAliensAcross aliens.
+    uint32_t MaxPairs(const uint32_t rule, const uint32_t rows[NUM_TABLES])
+    {
+        uint32_t numTargets = rows[RULE_TARGETS[rule]];
+        if(RULE_TARGETS[rule] == TABLE_ALIENS)
+        {
+            numTargets = std::min(numTargets, MaxAliensAcross());
+        }
+        return rows[RULE_SHOTS[rule]] * numTargets;
+    }
+
+    bool ByShot(const CollisionPair& a, const CollisionPair& b)
+    {
+        return a.mShot < b.mShot || (a.mShot == b.mShot && a.mTarget < b.mTarget);
+    }
+
+    //The pairs of RULE whose projectile hits its target, a block of pairs
+    //at a time: their positions are gathered into a PairBlock and tested
+    //together. touching has room for every pair. Returns how many hit.
+    template<CollisionRule RULE>
+    uint32_t FindHits(const SceneTables& scene,
+                      const CollisionPairVector& pairs,
+                      ArenaSpan<CollisionPair>& touching)
+    {
+        const PositionVector& shots = scene.mTables[RuleTraits<RULE>::SHOTS].mPositions;
+        const PositionVector& targets = scene.mTables[RuleTraits<RULE>::TARGETS].mPositions;
+        const HitGeometry geometry = RuleGeometry<RULE>();
+
+        PairBlock block;
+        uint32_t masks[NARROWPHASE_MASK_WORDS];
+        uint32_t numTouching = 0;
+        for(size_t first = 0; first < pairs.size(); first += NARROWPHASE_BLOCK)
+        {
+            block.mCount = static_cast<uint32_t>(std::min<size_t>(NARROWPHASE_BLOCK, pairs.size() - first));
+            for(uint32_t index = 0; index < block.mCount; ++index)
+            {
+                const CollisionPair& pair = pairs[first + index];
+                block.mShotX[index] = CoordinateX(shots[pair.mShot]);
+                block.mShotY[index] = CoordinateY(shots[pair.mShot]);
+                block.mTargetX[index] = CoordinateX(targets[pair.mTarget]);
+                block.mTargetY[index] = CoordinateY(targets[pair.mTarget]);
+            }
+
+            PairHitMasks(block, geometry, masks);
+            for(uint32_t word = 0; word < (block.mCount + 31) / 32; ++word)
+            {
+                for(uint32_t index = word * 32, mask = masks[word]; mask; ++index, mask >>= 1)
+                {
+                    if(mask & 1)
+                    {
+                        touching[numTouching++] = pairs[first + index];
+                    }
+                }
+            }
+        }
+        return numTouching;
+    }
+
+    //Hits of RULE. A projectile can touch several targets and a target
+    //several projectiles, so the hits are taken in the order
+    //CollideObjects' projectile by projectile loop takes them, which
+    //decides the one projectile a destroyed target uses up and the one
+    //target a projectile is spent on. Sorted by projectile, a
+    //projectile's hits are a run: it kills the first target of its run it
+    //can, one spent by an earlier rule kills none, and the rest of the
+    //run is skipped. Returns whether anything was hit.
+    template<CollisionRule RULE>
+    bool CollidePairs(const SceneTables& scene,
+                      const CollisionPairVector& pairs,
+                      const uint32_t starts[NUM_TABLES + 1],
+                      FrameArena& arena,
+                      SceneFlags& hit,
+                      int hitCounts[NUM_OBJECT_TYPES])
+    {
+        const TableId SHOTS = RuleTraits<RULE>::SHOTS;
+        const TableId TARGETS = RuleTraits<RULE>::TARGETS;
+
+        ArenaSpan<CollisionPair> touching = arena.allocate<CollisionPair>(static_cast<uint32_t>(pairs.size()));
+        const uint32_t numTouching = FindHits<RULE>(scene, pairs, touching);
+        std::sort(touching.begin(), touching.begin() + numTouching, ByShot);
+
+        bool bHit = false;
+        uint32_t first = 0;
+        while(first < numTouching)
+        {
+            const uint32_t shot = touching[first].mShot;
+            uint32_t end = first + 1;
+            while(end < numTouching && touching[end].mShot == shot)
+            {
+                ++end;
+            }
+
+            for(uint32_t index = first; index < end; ++index)
+            {
+                if(RecordHit<SHOTS, TARGETS>(scene.mTables[TARGETS], starts[SHOTS] + shot,
+                    starts[TARGETS] + touching[index].mTarget, hit, hitCounts))
+                {
+                    bHit = true;
+                    break;
+                }
+            }
+            first = end;
+        }
+        return bHit;
+    }
+}
+
+SweepAndPrune::SweepAndPrune() : mNumMoves(0),
+    mSorted(false)
+{
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        mNumRows[table] = 0;
+    }
+}
+
+void SweepAndPrune::update(const SceneTables& scene)
+{
+    bool bShrunk = false;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        bShrunk = bShrunk || scene.mTables[table].mPositions.size() < mNumRows[table];
+    }
+    if(bShrunk)
+    {
+        size_t kept = 0;
+        for(size_t index = 0; index < mEntries.size(); ++index)
+        {
+            const Entry& entry = mEntries[index];
+            if(entry.mRow < scene.mTables[entry.mTable].mPositions.size())
+            {
+                mEntries[kept++] = entry;
+            }
+        }
+        mEntries.resize(kept);
+    }
+
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        const uint32_t numRows = static_cast<uint32_t>(scene.mTables[table].mPositions.size());
+        for(uint32_t row = std::min(mNumRows[table], numRows); row < numRows; ++row)
+        {
+            Entry entry;
+            entry.mTable = table;
+            entry.mRow = row;
+            mEntries.push_back(entry);
+        }
+        mNumRows[table] = numRows;
+    }
+
+    for(size_t index = 0; index < mEntries.size(); ++index)
+    {
+        Entry& entry = mEntries[index];
+        const float x = scene.mTables[entry.mTable].mPositions[entry.mRow].x();
+        entry.mLeft = x + BOX_LEFTS[entry.mTable];
+        entry.mRight = x + BOX_RIGHTS[entry.mTable];
+    }
+
+    sortEntries();
+    sweep();
+}
+
+void SweepAndPrune::reserve(const uint32_t rows[NUM_TABLES])
+{
+    uint32_t numObjects = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        mActive[table].reserve(rows[table]);
+        numObjects += rows[table];
+    }
+    mEntries.reserve(numObjects);
+
+    for(uint32_t rule = 0; rule < NUM_COLLISION_RULES; ++rule)
+    {
+        mPairs[rule].reserve(MaxPairs(rule, rows));
+    }
+}
+
+void SweepAndPrune::sortEntries()
+{
+    mNumMoves = 0;
+    mSorted = false;
+
+    const size_t count = mEntries.size();
+    const size_t maxMoves = count * MAX_SORT_MOVES_PER_ENTRY;
+    for(size_t index = 1; index < count; ++index)
+    {
+        const Entry entry = mEntries[index];
+        size_t to = index;
+        while(to > 0 && mEntries[to - 1].mLeft > entry.mLeft)
+        {
+            mEntries[to] = mEntries[to - 1];
+            --to;
+            ++mNumMoves;
+        }
+        mEntries[to] = entry;
+
+        if(mNumMoves > maxMoves)
+        {
+            std::sort(mEntries.begin(), mEntries.end(), LeftOrder);
+            mSorted = true;
+            return;
+        }
+    }
+}
+
+void SweepAndPrune::sweep()
+{
+    for(uint32_t rule = 0; rule < NUM_COLLISION_RULES; ++rule)
+    {
+        mPairs[rule].clear();
+    }
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        mActive[table].clear();
+    }
+
+    //Entries come in order of their left, so an active entry whose right
+    //is left of this one's left is left of every one still to come.
+    for(uint32_t index = 0; index < mEntries.size(); ++index)
+    {
+        const Entry& entry = mEntries[index];
+        for(uint32_t rule = 0; rule < NUM_COLLISION_RULES; ++rule)
+        {
+            const bool bShot = RULE_SHOTS[rule] == entry.mTable;
+            if(!bShot && RULE_TARGETS[rule] != entry.mTable)
+            {
+                continue;
+            }
+
+            std::vector<uint32_t>& active = mActive[bShot ? RULE_TARGETS[rule] : RULE_SHOTS[rule]];
+            size_t kept = 0;
+            for(size_t i = 0; i < active.size(); ++i)
+            {
+                const Entry& other = mEntries[active[i]];
+                if(other.mRight < entry.mLeft)
+                {
+                    continue;
+                }
+                active[kept++] = active[i];
+
+                CollisionPair pair;
+                pair.mShot = bShot ? entry.mRow : other.mRow;
+                pair.mTarget = bShot ? other.mRow : entry.mRow;
+                mPairs[rule].push_back(pair);
+            }
+            active.resize(kept);
+        }
+        mActive[entry.mTable].push_back(index);
+    }
+}
+
+void CollideObjects(SceneTables& scene,
+                    SweepAndPrune& broadphase,
+                    FrameArena& arena,
+                    int hitCounts[NUM_OBJECT_TYPES])
+{
+    broadphase.update(scene);
+
+    uint32_t starts[NUM_TABLES + 1];
+    TableStarts(scene, starts);
+
+    SceneFlags hit = arena.allocate<uint8_t>(NumObjects(scene), 0);
+    bool bHit = CollidePairs<RULE_ROCKETS_ALIENS>(scene, broadphase.getPairs(RULE_ROCKETS_ALIENS),
+        starts, arena, hit, hitCounts);
+    bHit = CollidePairs<RULE_ROCKETS_BOMBS>(scene, broadphase.getPairs(RULE_ROCKETS_BOMBS),
+        starts, arena, hit, hitCounts) || bHit;
+    bHit = CollidePairs<RULE_BOMBS_PLAYER>(scene, broadphase.getPairs(RULE_BOMBS_PLAYER),
+        starts, arena, hit, hitCounts) || bHit;
+
+    if(bHit)
+    {
+        DestroyObjects(scene, hit);
+    }
+}
+
+size_t CollideArenaBytes(const uint32_t rows[NUM_TABLES])
+{
+    //Flags cover the destroyed objects as well as the tables.
+    uint32_t numObjects = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        numObjects += rows[table];
+    }
+    size_t bytes = FrameArena::bytesFor<uint8_t>(numObjects * 2);
+    for(uint32_t rule = 0; rule < NUM_COLLISION_RULES; ++rule)
+    {
+        bytes += FrameArena::bytesFor<CollisionPair>(MaxPairs(rule, rows));
+    }
+    return bytes;
+}
@@ -0,0 +1,98 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include "ObjectTraits.h"
+
+//Rows of one projectile and one object it may hit.
+struct CollisionPair
+{
+    uint32_t mShot;
+    uint32_t mTarget;
+};
+
+typedef std::vector<CollisionPair> CollisionPairVector;
+
+//Sweep and prune along x. Every object of the tables has an interval,
+//its hit box across, and only objects whose intervals overlap can touch,
+//so only those pairs of the collision rules are handed on to be tested.
+//
+//The objects are kept sorted by the left of their interval from one
+//frame to the next. Objects mostly move up and down and aliens all move
+//together, so the order hardly changes and an insertion sort puts it
+//right in close to one pass. Objects stay in the order by table and row:
+//appended rows join at the end and rows past the end of a shrunk table
+//drop out, so the order is always of exactly the scene's objects even if
+//rows now hold other objects than last frame. That only costs the sort
+//more moves. A sort that runs far from linear, as after a new level or a
+//restored state, is finished by std::sort instead.
+//
+//What it finds only depends on the scene, not on what it kept, so it can
+//be copied with the state, or thrown away, at any time.
+class SweepAndPrune
+{
+public:
+    SweepAndPrune();
+
+    //Bring the order up to date with scene and find the pairs that
+    //overlap across. Pairs come in no particular order.
+    void update(const SceneTables& scene);
+
+    //Make room for as many objects as rows gives each table and the pairs
+    //they can make, so updates do not allocate. See MaxTableRows.
+    void reserve(const uint32_t rows[NUM_TABLES]);
+
+    const CollisionPairVector& getPairs(const CollisionRule rule) const
+    {
+        return mPairs[rule];
+    }
+
+    //Moves the last update's insertion sort made, and whether it gave up
+    //for std::sort.
+    uint32_t getNumMoves() const
+    {
+        return mNumMoves;
+    }
+    bool getSorted() const
+    {
+        return mSorted;
+    }
+
+private:
+    struct Entry
+    {
+        float mLeft;
+        float mRight;
+        uint32_t mTable;
+        uint32_t mRow;
+    };
+
+    static bool LeftOrder(const Entry& a, const Entry& b)
+    {
+        return a.mLeft < b.mLeft;
+    }
+
+    void sortEntries();
+    void sweep();
+
+    std::vector<Entry> mEntries;
+    uint32_t mNumRows[NUM_TABLES];//Rows of each table in mEntries.
+    std::vector<uint32_t> mActive[NUM_TABLES];//Entries the sweep is inside.
+    CollisionPairVector mPairs[NUM_COLLISION_RULES];
+    uint32_t mNumMoves;
+    bool mSorted;
+};
+
+//CollideObjects with the pairs of broadphase: the same hits, the same
+//projectiles used up and the same counts, without testing every
+//projectile against every object of the tables it hits.
+void CollideObjects(SceneTables& scene,
+                    SweepAndPrune& broadphase,
+                    FrameArena& arena,
+                    int hitCounts[NUM_OBJECT_TYPES]);
+
+//The most FrameArena bytes CollideObjects takes for a scene of rows, see
+//MaxTableRows.
+size_t CollideArenaBytes(const uint32_t rows[NUM_TABLES]);
+
+#endif
@@ -0,0 +1,338 @@
+//Cache behaviour of the object layouts.
+//Usage: CacheBench [-objects N] [-reps N]
+//Times the bounds test of CullObjects and the update of MoveObjects over
+//-objects objects (default 100000) kept as
+//  flat      the single list of 20 byte SceneObjectData the game used to
+//            keep, type, position and velocity together
+//  table     8 byte positions starting on a cache line, as PositionVector
+//            keeps them
+//  table+4   the same positions starting 4 bytes into a line, so one in
+//            eight straddles two lines
+//and the table layout again with a software prefetch 1 to 16 lines ahead.
+//Columns: cache lines the pass brings in per object, the share of objects
+//split over two lines, and the best ns per object of -reps runs with cold caches (a buffer bigger than the last
+//level cache is written before each run) and with warm ones. Every layout
+//is checked against the flat result.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+#include "SceneObject.h"
+#include "Timer.h"
+
+namespace
+{
+    const int WIDTH = 4096;
+    const int HEIGHT = 4096;
+    const float FRAME_TIME = 1.0f / 60.0f;
+
+    //Larger than any last level cache this runs on.
+    const size_t FLUSH_BYTES = 64 * 1024 * 1024;
+
+    //What PositionVector is in a build without FIXED_POSITIONS.
+    typedef std::vector<Vec2, AlignedAllocator<Vec2, CACHE_LINE_SIZE> > Vec2Vector;
+
+    inline void PrefetchRead(const void* address)
+    {
+#if defined(_MSC_VER)
+        _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+        __builtin_prefetch(address);
+#endif
+    }
+
+    struct Layout
+    {
+        SceneObjectVector mFlat;
+        Vec2Vector mTable;//One line longer, for table+4.
+        Vec2* mPositions;//Where the pass reads positions from.
+        Vec2 mVelocity;
+        uint32_t mCount;
+        uint32_t mPrefetchLines;
+    };
+
+    typedef uint32_t (*PassFunc)(Layout& layout);
+
+    uint32_t IsOutside(const Vec2& position)
+    {
+        return position.x() < -1 || position.x() > WIDTH+1 ||
+            position.y() < -1 || position.y() > HEIGHT+1;
+    }
+
+    uint32_t FlatCull(Layout& layout)
+    {
+        uint32_t numCulled = 0;
+        for(uint32_t index = 0; index < layout.mCount; ++index)
+        {
+            numCulled += IsOutside(layout.mFlat[index].mPosition);
+        }
+        return numCulled;
+    }
+
+    uint32_t FlatMove(Layout& layout)
+    {
+        for(uint32_t index = 0; index < layout.mCount; ++index)
+        {
+            SceneObjectData& object = layout.mFlat[index];
+            object.mPosition += object.mVelocity * FRAME_TIME;
+        }
+        return 0;
+    }
+
+    //Objects one cache line of positions covers.
+    const uint32_t LINE_OBJECTS = CACHE_LINE_SIZE / sizeof(Vec2);
+
+    uint32_t TableCull(Layout& layout)
+    {
+        const Vec2* positions = layout.mPositions;
+        const uint32_t ahead = layout.mPrefetchLines * LINE_OBJECTS;
+        uint32_t numCulled = 0;
+        for(uint32_t index = 0; index < layout.mCount; ++index)
+        {
+            if(ahead && index % LINE_OBJECTS == 0 && index + ahead < layout.mCount)
+            {
+                PrefetchRead(&positions[index + ahead]);
+            }
+            numCulled += IsOutside(positions[index]);
+        }
+        return numCulled;
+    }
+
+    uint32_t TableMove(Layout& layout)
+    {
+        Vec2* positions = layout.mPositions;
+        const Vec2 step = layout.mVelocity * FRAME_TIME;
+        const uint32_t ahead = layout.mPrefetchLines * LINE_OBJECTS;
+        for(uint32_t index = 0; index < layout.mCount; ++index)
+        {
+            if(ahead && index % LINE_OBJECTS == 0 && index + ahead < layout.mCount)
+            {
+                PrefetchRead(&positions[index + ahead]);
+            }
+            positions[index] += step;
+        }
+        return 0;
+    }
+
+    //Distinct cache lines holding count objects of size bytes, stride
+    //bytes apart from first, and how many of the objects cross a line.
+    double LinesPerObject(const void* first, uint32_t count, size_t stride, size_t size,
+                          uint32_t& numSplit)
+    {
+        numSplit = 0;
+        const uintptr_t start = reinterpret_cast<uintptr_t>(first);
+        uintptr_t lastLine = ~static_cast<uintptr_t>(0);
+        uint32_t lines = 0;
+        for(uint32_t index = 0; index < count; ++index)
+        {
+            const uintptr_t begin = (start + index * stride) / CACHE_LINE_SIZE;
+            const uintptr_t end = (start + index * stride + size - 1) / CACHE_LINE_SIZE;
+            numSplit += begin != end;
+            for(uintptr_t line = begin; line <= end; ++line)
+            {
+                if(line != lastLine)
+                {
+                    ++lines;
+                    lastLine = line;
+                }
+            }
+        }
+        return count ? static_cast<double>(lines) / count : 0.0;
+    }
+
+    uint32_t FlushCaches(std::vector<uint8_t>& buffer)
+    {
+        uint32_t sum = 0;
+        for(size_t index = 0; index < buffer.size(); index += CACHE_LINE_SIZE)
+        {
+            buffer[index]++;
+            sum += buffer[index];
+        }
+        return sum;
+    }
+}
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+//Bombs falling over the playfield, some already below it.
+static void BuildLayout(Layout& layout, uint32_t count)
+{
+    uint32_t random = 12345;
+    layout.mCount = count;
+    layout.mPositions = 0;
+    layout.mPrefetchLines = 0;
+    layout.mVelocity = Vec2(0.0f, BOMB_SPEED);
+    layout.mFlat.resize(count);
+    layout.mTable.resize(count + LINE_OBJECTS);
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        const float x = static_cast<float>(NextRandom(random) % WIDTH);
+        const float y = static_cast<float>(NextRandom(random) % (HEIGHT + HEIGHT / 20));
+        layout.mFlat[index].mType = BOMB;
+        layout.mFlat[index].mPosition = Vec2(x, y);
+        layout.mFlat[index].mVelocity = layout.mVelocity;
+    }
+}
+
+//Put the positions offset bytes into the table's first line.
+static void PlacePositions(Layout& layout, size_t offset)
+{
+    uint8_t* base = reinterpret_cast<uint8_t*>(&layout.mTable[0]);
+    layout.mPositions = reinterpret_cast<Vec2*>(base + offset);
+    for(uint32_t index = 0; index < layout.mCount; ++index)
+    {
+        layout.mPositions[index] = layout.mFlat[index].mPosition;
+    }
+}
+
+static bool SamePositions(const Layout& layout, const SceneObjectVector& reference)
+{
+    for(uint32_t index = 0; index < layout.mCount; ++index)
+    {
+        if(std::memcmp(&layout.mPositions[index], &reference[index].mPosition, sizeof(Vec2)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t numObjects = std::max(GetOptionInt(argc, argv, "-objects", 100000), 1);
+    const uint32_t numReps = std::max(GetOptionInt(argc, argv, "-reps", 20), 1);
+
+    struct Variant
+    {
+        const char* mName;
+        bool mFlat;
+        size_t mOffset;
+        uint32_t mPrefetchLines;
+    };
+    const Variant variants[] =
+    {
+        {"flat", true, 0, 0},
+        {"table", false, 0, 0},
+        {"table+4", false, 4, 0},
+        {"prefetch 1", false, 0, 1},
+        {"prefetch 4", false, 0, 4},
+        {"prefetch 16", false, 0, 16},
+    };
+    struct Pass
+    {
+        const char* mName;
+        PassFunc mFlat;
+        PassFunc mTable;
+    };
+    const Pass passes[] =
+    {
+        {"Cull", FlatCull, TableCull},
+        {"Move", FlatMove, TableMove},
+    };
+
+    Layout original;
+    BuildLayout(original, numObjects);
+    std::vector<uint8_t> flush(FLUSH_BYTES);
+    uint32_t sink = 0;
+
+    std::printf("%u objects, %u byte lines, sizeof(SceneObjectData) %u, sizeof(Vec2) %u\n",
+        numObjects, CACHE_LINE_SIZE, static_cast<uint32_t>(sizeof(SceneObjectData)),
+        static_cast<uint32_t>(sizeof(Vec2)));
+    std::printf("%-6s %-12s %10s %8s %12s %12s\n", "pass", "layout", "lines/obj", "split", "cold ns/obj", "warm ns/obj");
+
+    uint32_t mismatches = 0;
+    for(uint32_t passIndex = 0; passIndex < sizeof(passes) / sizeof(passes[0]); ++passIndex)
+    {
+        const Pass& pass = passes[passIndex];
+
+        //What the flat layout makes of one run.
+        Layout expected = original;
+        const uint32_t expectedResult = pass.mFlat(expected);
+
+        for(uint32_t variantIndex = 0; variantIndex < sizeof(variants) / sizeof(variants[0]); ++variantIndex)
+        {
+            const Variant& variant = variants[variantIndex];
+            Layout layout = original;
+            layout.mPrefetchLines = variant.mPrefetchLines;
+
+            double lines = 0.0;
+            uint32_t numSplit = 0;
+            if(variant.mFlat)
+            {
+                lines = LinesPerObject(&layout.mFlat[0].mPosition, numObjects, sizeof(SceneObjectData),
+                    pass.mFlat == FlatMove ? 2 * sizeof(Vec2) : sizeof(Vec2), numSplit);
+            }
+            else
+            {
+                PlacePositions(layout, variant.mOffset);
+                lines = LinesPerObject(layout.mPositions, numObjects, sizeof(Vec2), sizeof(Vec2), numSplit);
+            }
+
+            uint64_t bestTimes[2] = {~0ull, ~0ull};
+            for(uint32_t rep = 0; rep < numReps * 2; ++rep)
+            {
+                const bool bCold = rep < numReps;
+                if(variant.mFlat)
+                {
+                    layout.mFlat = original.mFlat;
+                }
+                else
+                {
+                    PlacePositions(layout, variant.mOffset);
+                }
+                if(bCold)
+                {
+                    sink += FlushCaches(flush);
+                }
+
+                const uint64_t start = GetTimeNanoseconds();
+                const uint32_t result = variant.mFlat ? pass.mFlat(layout) : pass.mTable(layout);
+                const uint64_t time = GetTimeNanoseconds() - start;
+                bestTimes[bCold ? 0 : 1] = std::min(bestTimes[bCold ? 0 : 1], time);
+
+                const bool bSame = variant.mFlat ?
+                    std::memcmp(&layout.mFlat[0], &expected.mFlat[0], numObjects * sizeof(SceneObjectData)) == 0 :
+                    SamePositions(layout, expected.mFlat);
+                if(result != expectedResult || !bSame)
+                {
+                    ++mismatches;
+                }
+            }
+
+            std::printf("%-6s %-12s %10.3f %7.1f%% %12.3f %12.3f\n", pass.mName, variant.mName, lines,
+                100.0 * numSplit / numObjects,
+                static_cast<double>(bestTimes[0]) / numObjects,
+                static_cast<double>(bestTimes[1]) / numObjects);
+        }
+    }
+
+    if(sink == 1)
+    {
+        std::printf("\n");
+    }
+    if(mismatches)
+    {
+        std::printf("%u runs differ from the flat layout\n", mismatches);
+        return 1;
+    }
+    std::printf("every layout matches the flat one\n");
+    return 0;
+}
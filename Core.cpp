@@ -4,11 +4,29 @@
 #include <crtdbg.h>
 
 #include <windows.h>
+#include <algorithm>
 #include <cassert>
-#include <cstdio>
-#include <cmath>
-
-#include "SceneObject.h"
+#include <cstring>
+#include <cstdlib>
+
+#include "AllocationTracker.h"
+#include "AssetLoader.h"
+#include "FrameLimiter.h"
+#include "Game.h"
+#include "GameJobs.h"
+#include "HeadlessInvaders.h"
+#include "InputSampler.h"
+#include "Latency.h"
+#include "LiveState.h"
+#include "Log.h"
+#include "Pipeline.h"
+#include "Replay.h"
+#include "Rollback.h"
+#include "SoftwareInvaders.h"
+#include "StartupTimeline.h"
+#include "Threading.h"
+#include "TileRasterizer.h"
+#include "UdpTransport.h"
 
 class DiceInvadersLib
 {
@@ -43,261 +61,301 @@ private:
 	HMODULE m_lib;
 };
 
-struct GameState
+//Returns the integer following option on the command line or
+//defaultValue if the option is not present.
+static int GetCommandLineInt(const char* commandLine, const char* option, int defaultValue)
 {
-    static const int HudWidth = 32;
-    static const int MaxLives = 3;
-
-    GameState(int windowW, int windowH) : mWindowWidth(windowW),
-        mWindowHeight(windowH),
-        mPlayerScore(0),
-        mPlayerLives(MaxLives),
-        mFireKeyWasDown(0)
+    const char* found = std::strstr(commandLine, option);
+    if(!found)
     {
+        return defaultValue;
     }
+    return std::atoi(found + std::strlen(option));
+}
 
-    int mWindowWidth;
-    int mWindowHeight;
-    int mPlayerScore;
-    int mPlayerLives;
-    float mLastTime;//Time values are in seconds.
-    int mFloorLastTime;
-    float mTimeOfLastFire;
-    int mFireKeyWasDown;
-    SceneObjectVector mObjects;
-    ISprite* mSprites[NUM_OBJECT_TYPES];
-};
-
-void ProcessKeyboardInput(IDiceInvaders* system,
-                          GameState& state,
-                          const float deltaTimeInSecs)
+//Copies the word following option on the command line to value. Returns
+//false if the option is not present.
+static bool GetCommandLineString(const char* commandLine, const char* option, char* value, size_t size)
 {
-    IDiceInvaders::KeyStatus keys;
-    system->getKeyStatus(keys);
-
-    const float move = deltaTimeInSecs * PLAYER_SPEED;
-
-    assert(PLAYER == 0);//Assume player is first in vector;
-    SceneObjectData* player = &state.mObjects[0];
-
-    player->mPosition.moveX((keys.right * move) + (-move * keys.left));
-    player->mPosition.clampX(0.0f, state.mWindowWidth-F_SPRITE_SIZE);
-
-    const float currentTime = system->getElapsedTime();
-
-    if(keys.fire)
+    const char* found = std::strstr(commandLine, option);
+    if(!found || !size)
     {
-        if(!state.mFireKeyWasDown || 
-            (currentTime-state.mTimeOfLastFire > ROCKET_RATE_OF_FIRE))
-        {
-            //Fire rocket upwards from just above the player position.
-            Vec2 velocity(0.0f, -ROCKET_SPEED);
-            CreateObjects(ROCKET, 1, player->mPosition - Vec2(0, SPRITE_SIZE/2), velocity, Vec2(0, 0), state.mObjects);
+        return false;
+    }
 
-            state.mTimeOfLastFire = currentTime;
-        }
+    found += std::strlen(option);
+    while(*found == ' ')
+    {
+        ++found;
     }
-    state.mFireKeyWasDown = keys.fire;
-}
 
-void ResultScreen(IDiceInvaders* system,
-                GameState& state)
-{
-    const int resultStringSize = 16+MAX_SCORE_DIGITS;
-    char resultString[resultStringSize];
-    if(sprintf_s(resultString, resultStringSize, "Final score is %d", state.mPlayerScore))
+    size_t length = 0;
+    while(found[length] && found[length] != ' ' && length + 1 < size)
     {
-        system->drawText(state.mWindowWidth/3, state.mWindowHeight/2, resultString);
+        ++length;
     }
+    std::memcpy(value, found, length);
+    value[length] = 0;
+    return length > 0;
 }
 
-void GameScreen(IDiceInvaders* system,
-                GameState& state)
+int APIENTRY WinMain(
+	HINSTANCE instance,
+	HINSTANCE previousInstance,
+	LPSTR commandLine,
+	int commandShow)
 {
-    const float newTime = system->getElapsedTime();
-    const float deltaTimeInSecs = newTime - state.mLastTime;
-    const int iFloorNewTime = static_cast<int>(std::floor(newTime));
+    _CrtSetDbgFlag ( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+    StartupTimelineBegin();
 
+    //-latency follows key changes to the screen and logs the
+    //distribution on exit.
+    if(std::strstr(commandLine, "-latency"))
     {
-        const int scoreStringSize = MAX_SCORE_DIGITS+8;
-        char scoreString[scoreStringSize];
-        if(sprintf_s(scoreString, scoreStringSize, "Score: %d", state.mPlayerScore))
-        {
-            system->drawText(0, state.mWindowHeight-SPRITE_SIZE, scoreString);
-        }
+        EnableLatencyTracking();
     }
-#if defined(SHOW_STATS)
-    {
-        const int debugInfoSize = 128;
-        char debugInfo[debugInfoSize];
-
-        //Average milliseconds per frame over a 1 second period.
-        static float startTime = newTime;
-        static float accumTime = 0;
-        static int frame = 0;
-        static float avgFrameTime = 0;
 
-        if(accumTime > 1)//Reset approx each second
-        {
-            avgFrameTime = accumTime/frame;
-            startTime = newTime;
-            accumTime = 0;
-            frame = 0;
-        }
+    //-allocations counts the heap allocations each GameScreen frame makes,
+    //logs the first frames that make any and the totals on exit.
+    if(std::strstr(commandLine, "-allocations"))
+    {
+        EnableAllocationTracking();
+    }
 
-        frame++;
-        accumTime += deltaTimeInSecs;
+    //-software selects the CPU framebuffer renderer instead of the
+    //library. -threads N sets how many threads it rasterizes with.
+    //-headless runs -frames N frames without a window, paced like vsync
+    //at -refresh N Hz (0 for as fast as possible), with random key
+    //presses from the seed given by -seed N.
+    //
+    //The sprites start loading on the asset loader's workers before the
+    //backend is made, so they load while the library loads and the
+    //window opens. The software renderer draws what the loader decoded;
+    //the library loads its own, so for it the workers only read the
+    //files into the OS cache. The headless backend needs none, so it gets
+    //no loader and no workers. The loader outlives the system, which
+    //draws from its pixels.
+    AssetLoader* assets = 0;
+    DiceInvadersLib* lib = 0;
+    IDiceInvaders* system = 0;
+    int windowWidth = 1280;
+    int windowHeight = 720;
+    const bool bHeadless = std::strstr(commandLine, "-headless") != 0;
+    if(bHeadless)
+    {
+        const int numFrames = GetCommandLineInt(commandLine, "-frames", 3600);
+        const int refreshRate = GetCommandLineInt(commandLine, "-refresh", 60);
+        HeadlessInvaders* headless = new HeadlessInvaders(static_cast<float>(refreshRate), std::max(numFrames, 1));
+        headless->injectRandomKeys(GetCommandLineInt(commandLine, "-seed", 1), numFrames / 6, 0.5f, 0.1f);
+        system = headless;
+    }
+    else if(std::strstr(commandLine, "-software"))
+    {
+        assets = new AssetLoader(GetHardwareThreadCount());
+        assets->start(SPRITE_ATLAS_PATH, SPRITE_PATHS, NUM_OBJECT_TYPES, RASTER_IMAGE_SIZE, RASTER_IMAGE_SIZE);
+        const int numThreads = GetCommandLineInt(commandLine, "-threads", GetHardwareThreadCount());
+        system = CreateSoftwareInvaders(std::max(numThreads, 1), *assets);
+    }
+    else
+    {
+        assets = new AssetLoader(GetHardwareThreadCount());
+        assets->start(0, SPRITE_PATHS, NUM_OBJECT_TYPES, 0, 0);
+        StartupSpan span("LoadLibrary", "DiceInvaders.dll");
+        lib = new DiceInvadersLib("DiceInvaders.dll");
+        system = lib->get();
+    }
 
-        if(sprintf_s(debugInfo, debugInfoSize, "%d objects; %.4f ms", state.mObjects.size(),
-            avgFrameTime * 1000.0f))
-        {
-            system->drawText(0, state.mWindowHeight-64, debugInfo);
-        }
+    //-rollback N plays co-op with the peer listening on the port given by
+    //-peer N, both on this machine. Both peers need the same playfield.
+    //-netdelay MS, -netjitter MS and -netloss PERCENT simulate a network.
+    const int rollbackPort = GetCommandLineInt(commandLine, "-rollback", 0);
+    const int peerPort = GetCommandLineInt(commandLine, "-peer", 0);
+    const bool bRollback = rollbackPort > 0 && peerPort > 0;
+
+    //-replay FILE plays a recording back at its own window size, from
+    //-seekframe N. -record FILE records the game, with a keyframe every
+    //-keyframes N frames.
+    ReplayReader replay;
+    char replayPath[MAX_PATH];
+    const bool bReplay = GetCommandLineString(commandLine, "-replay", replayPath, sizeof(replayPath)) &&
+        replay.open(replayPath);
+    if(bReplay)
+    {
+        windowWidth = replay.getWindowWidth();
+        windowHeight = replay.getWindowHeight();
+    }
+    else if(!bHeadless && !bRollback)
+    {
+        windowWidth = GetSystemMetrics(SM_CXFULLSCREEN)/3*2;
+        windowHeight = GetSystemMetrics(SM_CYFULLSCREEN)/3*2;
     }
-#endif
 
-    state.mLastTime = newTime;
+    const uint32_t initSpan = StartupSpanBegin("init", 0);
+    if(system->init(windowWidth, windowHeight) == false)
+    {
+        system->destroy();
+        delete lib;
+        delete assets;
+        return 0;
+    }
+    StartupSpanEnd(initSpan);
 
-    DrawObjects(state.mObjects,
-        state.mSprites);
+    GameState gameState(windowWidth, windowHeight);
 
-    //Health. 1 player sprite for each life.
-    for(int i=0; i<state.mPlayerLives; ++i)
     {
-        const int x = state.mWindowWidth-(SPRITE_SIZE*GameState::MaxLives) + SPRITE_SIZE*i;
-        const int y = state.mWindowHeight-SPRITE_SIZE;
-        state.mSprites[PLAYER]->draw(x, y);
+        StartupSpan span("InitLevel", 0);
+        InitLevel(system, gameState);
     }
 
+    //The startup timeline ends with the first update, the first frame
+    //the window shows.
+    const uint32_t firstFrameSpan = StartupSpanBegin("first frame", 0);
+    bool bSystemOK = system->update();
+    StartupSpanEnd(firstFrameSpan);
+    if(assets)
     {
-        Box mAlienBBox;//Bounding box of ALL aliens
-        CalcAlienBBox(state.mObjects, mAlienBBox);
-
-        bool hitLeft =  mAlienBBox.mLeft <= 0;
-        bool hitRight = mAlienBBox.mRight >= (state.mWindowWidth);
-        if(hitLeft || hitRight)
-            AliensChangeDirection(state.mObjects, mAlienBBox, 0, state.mWindowWidth-F_SPRITE_SIZE-1.0f, deltaTimeInSecs);
+        assets->finish();
     }
-
-    MoveObjects(state.mObjects, deltaTimeInSecs);
-
-    int cullCounts[NUM_OBJECT_TYPES];
-    for(int i=0; i<NUM_OBJECT_TYPES;++i)
+    LogStartupTimeline();
+    if(assets)
     {
-        cullCounts[i] = 0;
+        assets->logStats();
     }
-    CullObjects(state.mObjects, state.mWindowWidth, state.mWindowHeight-state.HudWidth, cullCounts);
 
-    if(cullCounts[ENEMY1] || cullCounts[ENEMY2])
+    ReplayWriter replayWriter;
+    ReplayWriter* recorder = 0;
+    char recordPath[MAX_PATH];
+    if(!bReplay && GetCommandLineString(commandLine, "-record", recordPath, sizeof(recordPath)))
     {
-        //Alien reached the bottom of the window
-        state.mPlayerLives = 0;
+        const int keyframeInterval = GetCommandLineInt(commandLine, "-keyframes", static_cast<int>(REPLAY_KEYFRAME_INTERVAL));
+        if(replayWriter.open(recordPath, windowWidth, windowHeight, static_cast<uint32_t>(std::max(keyframeInterval, 1))))
+        {
+            recorder = &replayWriter;
+        }
     }
 
-    Animate(state.mObjects, iFloorNewTime);
+    //-export NAME publishes every frame of the game loop, with the time
+    //each simulation phase took, to shared memory NAME for LiveReader.
+    //-pipelined publishes from its simulation thread; -jobs publishes
+    //without phase times, as its phases overlap.
+    LiveStateWriter liveWriter;
+    LiveStateWriter* exporter = 0;
+    char exportName[MAX_PATH];
+    if(GetCommandLineString(commandLine, "-export", exportName, sizeof(exportName)) &&
+        liveWriter.open(exportName, windowWidth, windowHeight))
+    {
+        exporter = &liveWriter;
+    }
 
-    int hitCounts[NUM_OBJECT_TYPES];
-    for(int i=0; i<NUM_OBJECT_TYPES;++i)
+    //-inputrate N polls the keys N times a second on a separate thread and
+    //applies every change at the time it happened instead of once a frame.
+    InputSampler inputSampler(system);
+    InputSampler* sampler = 0;
+    const int inputRate = GetCommandLineInt(commandLine, "-inputrate", 0);
+    if(inputRate > 0 && inputSampler.start(inputRate))
     {
-        hitCounts[i] = 0;
+        sampler = &inputSampler;
     }
-    CollideObjects(state.mObjects, hitCounts);
 
-    state.mPlayerScore += hitCounts[ENEMY1];
-    state.mPlayerScore += hitCounts[ENEMY2];
-    state.mPlayerLives -= hitCounts[PLAYER];
+    //-fps N caps the game loop at N frames per second. The final score
+    //screen runs at -idlefps N, by default IDLE_FRAME_RATE in a window
+    //and unlimited headless so scripted runs end as soon as they can.
+    //Frame time, jitter and CPU use of both loops are logged either way.
+    const float gameFrameRate = static_cast<float>(GetCommandLineInt(commandLine, "-fps", 0));
+    const float idleFrameRate = static_cast<float>(GetCommandLineInt(commandLine, "-idlefps",
+        bHeadless ? 0 : static_cast<int>(IDLE_FRAME_RATE)));
 
-    state.mPlayerScore = std::min(state.mPlayerScore, MAX_SCORE);
+    {
+        FrameLimiter limiter(system, gameFrameRate);
 
-    AliensRandomFire(state.mObjects, state.mFloorLastTime, iFloorNewTime);
+        if(bSystemOK && bReplay)
+        {
+            bSystemOK = PlayReplay(system, replay,
+                GetCommandLineInt(commandLine, "-seekframe", 0), limiter, gameState);
 
-    ProcessKeyboardInput(system,
-        state,
-        deltaTimeInSecs);
+            //Whatever state the recording reached, it is over.
+            gameState.mPlayerLives = 0;
+        }
 
-    //Check for no more aliens. The objects are sorted
-    //so if the second object is not alien then there are none
-    if(state.mObjects.size() > 1 && state.mObjects[1].mType > ENEMY2)
-        SpawnAliens(state.mObjects, state.mWindowWidth);
+        UdpTransport transport;
+        if(bSystemOK && bRollback && gameState.mPlayerLives &&
+            transport.open(static_cast<uint16_t>(rollbackPort), static_cast<uint16_t>(peerPort)))
+        {
+            transport.setConditions(GetCommandLineInt(commandLine, "-netdelay", 0),
+                GetCommandLineInt(commandLine, "-netjitter", 0),
+                GetCommandLineInt(commandLine, "-netloss", 0));
+            bSystemOK = RunRollbackGame(system, transport, limiter, gameState, 0);
 
-    state.mFloorLastTime = iFloorNewTime;
+            //A game the peer walked out of is over for both.
+            gameState.mPlayerLives = 0;
+        }
 
-    //Wait until the end to free all objects so preceding
-    //code and safely assume there is at least 1 object in vector.
-    if(!state.mPlayerLives)
-    {
-        state.mObjects.clear();
-    }
-}
+        //-pipelined simulates the next frame on a second thread while this
+        //one draws the current frame.
+        if(bSystemOK && gameState.mPlayerLives && std::strstr(commandLine, "-pipelined"))
+        {
+            bSystemOK = RunPipelinedGame(system, sampler, recorder, exporter, limiter, gameState);
+        }
 
-void InitLevel(IDiceInvaders* system, GameState& gameState)
-{
-    gameState.mObjects.reserve(512);
-    const float fWindowWidth = static_cast<float>(gameState.mWindowWidth);
-    const float fWindowHeight = static_cast<float>(gameState.mWindowHeight);
-    const float fHudWidth = static_cast<float>(gameState.HudWidth);
-
-    //Create the player first. Guaranteed to be at the first
-    //index so no need to search for it.
-    CreateObjects(PLAYER, 1, Vec2(fWindowWidth/2.0f, fWindowHeight-fHudWidth), Vec2(0, 0), Vec2(0, 0), gameState.mObjects);
-
-    gameState.mSprites[ROCKET] = system->createSprite("data/rocket.bmp");
-    gameState.mSprites[BOMB] = system->createSprite("data/bomb.bmp");
-    gameState.mSprites[PLAYER] = system->createSprite("data/player.bmp");
-    gameState.mSprites[ENEMY1] = system->createSprite("data/enemy1.bmp");
-    gameState.mSprites[ENEMY2] = system->createSprite("data/enemy2.bmp");
-    gameState.mSprites[NULL_OBJECT] = system->createSprite("data/null.bmp");
-
-    SpawnAliens(gameState.mObjects, gameState.mWindowWidth);
-
-    gameState.mLastTime = system->getElapsedTime();
-    gameState.mTimeOfLastFire = gameState.mLastTime;
-}
+        //-jobs N runs each frame as a graph of jobs on N worker threads
+        //and logs which of them overlap.
+        if(bSystemOK && gameState.mPlayerLives && std::strstr(commandLine, "-jobs"))
+        {
+            GameJobs jobs(static_cast<uint32_t>(std::max(GetCommandLineInt(commandLine, "-jobs", 0), 0)));
+            jobs.logSchedule();
+            while(bSystemOK && gameState.mPlayerLives)
+            {
+                jobs.runFrame(system, sampler, recorder, exporter, gameState);
+                bSystemOK = system->update();
+                LatencyMark(LATENCY_PRESENTED);
+                limiter.wait();
+            }
+        }
 
-int APIENTRY WinMain(
-	HINSTANCE instance,
-	HINSTANCE previousInstance,
-	LPSTR commandLine,
-	int commandShow)
-{
-    _CrtSetDbgFlag ( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+        while(bSystemOK && gameState.mPlayerLives)
+        {
+            GameScreen(system, sampler, recorder, exporter, gameState);
+            bSystemOK = system->update();
+            LatencyMark(LATENCY_PRESENTED);
+            limiter.wait();
+        }
 
-	DiceInvadersLib lib("DiceInvaders.dll");
-	IDiceInvaders * const system = lib.get();
+        limiter.logStats("Game loop");
+    }
 
-    const int windowWidth = GetSystemMetrics(SM_CXFULLSCREEN)/3*2;
-    const int windowHeight = GetSystemMetrics(SM_CYFULLSCREEN)/3*2;
+    inputSampler.stop();
 
-    if(system->init(windowWidth, windowHeight) == false)
+    if(recorder && !replayWriter.close(gameState))
     {
-        return 0;
+        LogMessage("Could not finish the recording %s", recordPath);
     }
 
-    GameState gameState(windowWidth, windowHeight);
-
-    InitLevel(system, gameState);
+    {
+        FrameLimiter limiter(system, idleFrameRate);
 
-    bool bSystemOK = system->update();
+        while (bSystemOK)
+        {
+            //Game has ended. Window has not been closed. Show final score
+            ResultScreen(system, gameState);
+            bSystemOK = system->update();
+            limiter.wait();
+        }
 
-    while(bSystemOK && gameState.mPlayerLives)
-    {
-        GameScreen(system, gameState);
-        bSystemOK = system->update();
+        limiter.logStats("Result screen");
     }
 
-	while (bSystemOK)
-	{
-        //Game has ended. Window has not been closed. Show final score
-        ResultScreen(system, gameState);
-        bSystemOK = system->update();
-	}
-
     for(uint32_t index = 0; index < NUM_OBJECT_TYPES; ++index)
     {
         gameState.mSprites[index]->destroy();
     }
 
+    LogLatencyReport();
+    LogAllocationReport();
+    gameState.mArena.logStats("Frame arena");
+
 	system->destroy();
+    delete lib;
+    delete assets;
 
 	return 0;
 }
@@ -0,0 +1,291 @@
+#include "FastForward.h"
+#include "ObjectTraits.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //Events are brought forward so that rounding in the positions, or in
+    //the sums SimulateGame compares times with, cannot carry a frame over
+    //a threshold before the event is due. Fixed positions move in whole
+    //steps, which can put them up to a step past velocity times time.
+#if defined(FIXED_POSITIONS)
+    const float POSITION_MARGIN = 0.05f + 1.0f / FIXED_ONE;
+#else
+    const float POSITION_MARGIN = 0.05f;
+#endif
+    const float TIME_MARGIN = 0.0001f;
+
+    //Offsets of the pixels and boxes CollideObjects tests, see
+    //ObjectTraits.h.
+    const float ROCKET_TIP_X = TableTraits<TABLE_ROCKETS>::HIT_X;
+    const float ROCKET_TIP_Y = TableTraits<TABLE_ROCKETS>::HIT_Y;
+    const float BOMB_TIP_X = TableTraits<TABLE_BOMBS>::HIT_X;
+    const float BOMB_TIP_Y = TableTraits<TABLE_BOMBS>::HIT_Y;
+    const float BOMB_BOX_LEFT = TableTraits<TABLE_BOMBS>::BOX_LEFT;
+    const float BOMB_BOX_TOP = TableTraits<TABLE_BOMBS>::BOX_TOP;
+    const float BOMB_BOX_RIGHT = TableTraits<TABLE_BOMBS>::BOX_RIGHT;
+    const float BOMB_BOX_BOTTOM = TableTraits<TABLE_BOMBS>::BOX_BOTTOM;
+
+    //Seconds until something distance away and closing at speed gets
+    //within POSITION_MARGIN of it.
+    float TimeToCover(float distance, float speed)
+    {
+        return (distance - POSITION_MARGIN) / speed;
+    }
+
+    bool SameKeys(const IDiceInvaders::KeyStatus& a, const IDiceInvaders::KeyStatus& b)
+    {
+        return a.fire == b.fire && a.left == b.left && a.right == b.right;
+    }
+}
+
+float NextGameEventTime(const GameState& state,
+                        const IDiceInvaders::KeyStatus& keys)
+{
+    const float now = state.mLastTime;
+    const SceneTables& scene = state.mScene;
+    const ObjectTable& aliens = scene.mTables[TABLE_ALIENS];
+    const ObjectTable& bombs = scene.mTables[TABLE_BOMBS];
+    const ObjectTable& rockets = scene.mTables[TABLE_ROCKETS];
+
+    //No aliens means a new wave spawns on the next frame, and objects
+    //hit on the last frame are deleted by the next CullObjects. Aliens
+    //spawned since the last Animate change sprite and step on the next
+    //frame.
+    const ObjectType alienType = TableSprite<TABLE_ALIENS>(state.mFloorLastTime);
+    if(!state.mPlayerLives || scene.mTables[TABLE_PLAYER].mPositions.empty() ||
+        aliens.mPositions.empty() || !scene.mDestroyed.mPositions.empty() ||
+        aliens.mType != alienType)
+    {
+        return now;
+    }
+
+    //Animate and AliensRandomFire act when the whole second changes.
+    float eventTime = static_cast<float>(state.mFloorLastTime + 1);
+
+    if(keys.fire)
+    {
+        if(!state.mFireKeyWasDown)
+        {
+            return now;
+        }
+        eventTime = std::min(eventTime, state.mTimeOfLastFire + ROCKET_RATE_OF_FIRE);
+    }
+
+    //The player stops at the edges of the window.
+    const Position& player = scene.mTables[TABLE_PLAYER].mPositions[0];
+    const float maxPlayerX = state.mWindowWidth - F_SPRITE_SIZE;
+    float playerVelocity = (static_cast<float>(keys.right) - static_cast<float>(keys.left)) * PLAYER_SPEED;
+    if((playerVelocity > 0.0f && player.x() >= maxPlayerX) ||
+        (playerVelocity < 0.0f && player.x() <= 0.0f))
+    {
+        playerVelocity = 0.0f;
+    }
+    else if(playerVelocity > 0.0f)
+    {
+        eventTime = std::min(eventTime, now + TimeToCover(maxPlayerX - player.x(), playerVelocity));
+    }
+    else if(playerVelocity < 0.0f)
+    {
+        eventTime = std::min(eventTime, now + TimeToCover(player.x(), -playerVelocity));
+    }
+
+    //Every alien moves the same way between walls.
+    const float alienVelocity = aliens.mVelocity.x();
+    const float width = static_cast<float>(state.mWindowWidth);
+    const float height = static_cast<float>(state.mWindowHeight - state.HudWidth);
+    float alienLeft = width;
+    float alienRight = 0.0f;
+    for(size_t index = 0; index < aliens.mPositions.size(); ++index)
+    {
+        alienLeft = std::min(alienLeft, aliens.mPositions[index].x());
+        alienRight = std::max(alienRight, aliens.mPositions[index].x() + F_SPRITE_SIZE);
+    }
+
+    if(alienLeft <= 0.0f || alienRight >= width)
+    {
+        return now;
+    }
+    if(alienVelocity < 0.0f)
+    {
+        eventTime = std::min(eventTime, now + TimeToCover(alienLeft, -alienVelocity));
+    }
+    else if(alienVelocity > 0.0f)
+    {
+        eventTime = std::min(eventTime, now + TimeToCover(width - alienRight, alienVelocity));
+    }
+
+    //Anything already outside is culled on the next frame. Projectiles
+    //only move vertically.
+    for(uint32_t table = TABLE_ALIENS; table < NUM_TABLES; ++table)
+    {
+        const ObjectTable& objects = scene.mTables[table];
+        const float velocity = (table == TABLE_ALIENS) ? 0.0f : objects.mVelocity.y();
+        for(size_t index = 0; index < objects.mPositions.size(); ++index)
+        {
+            const Position& position = objects.mPositions[index];
+            if(position.x() < -1.0f || position.x() > width + 1.0f ||
+                position.y() < -1.0f || position.y() > height + 1.0f)
+            {
+                return now;
+            }
+
+            if(velocity < 0.0f)
+            {
+                eventTime = std::min(eventTime, now + TimeToCover(position.y() + 1.0f, -velocity));
+            }
+            else if(velocity > 0.0f)
+            {
+                eventTime = std::min(eventTime, now + TimeToCover(height + 1.0f - position.y(), velocity));
+            }
+        }
+    }
+
+    //Collisions last, when the horizon is known. Targets can drift
+    //sideways by their speed times the horizon, so anything within that
+    //distance of a projectile's column counts as in its path.
+    const float horizon = eventTime - now;
+    const float alienDrift = std::fabs(alienVelocity) * horizon + 1.0f;
+    const float playerDrift = std::fabs(playerVelocity) * horizon + 1.0f;
+
+    const float rocketSpeed = -rockets.mVelocity.y();
+    for(size_t index = 0; index < rockets.mPositions.size(); ++index)
+    {
+        const float tipX = rockets.mPositions[index].x() + ROCKET_TIP_X;
+        const float tipY = rockets.mPositions[index].y() + ROCKET_TIP_Y;
+        for(size_t alien = 0; alien < aliens.mPositions.size(); ++alien)
+        {
+            const Position& position = aliens.mPositions[alien];
+            if(tipX <= position.x() - alienDrift ||
+                tipX >= position.x() + F_SPRITE_SIZE + alienDrift ||
+                tipY <= position.y())
+            {
+                continue;
+            }
+            eventTime = std::min(eventTime, now + TimeToCover(tipY - (position.y() + F_SPRITE_SIZE), rocketSpeed));
+        }
+
+        //Bombs fall straight at the rockets.
+        for(size_t bomb = 0; bomb < bombs.mPositions.size(); ++bomb)
+        {
+            const Position& position = bombs.mPositions[bomb];
+            if(tipX <= position.x() + BOMB_BOX_LEFT - 1.0f ||
+                tipX >= position.x() + BOMB_BOX_RIGHT + 1.0f ||
+                tipY <= position.y() + BOMB_BOX_TOP)
+            {
+                continue;
+            }
+            eventTime = std::min(eventTime, now + TimeToCover(tipY - (position.y() + BOMB_BOX_BOTTOM),
+                rocketSpeed + bombs.mVelocity.y()));
+        }
+    }
+
+    for(size_t index = 0; index < bombs.mPositions.size(); ++index)
+    {
+        const float tipX = bombs.mPositions[index].x() + BOMB_TIP_X;
+        const float tipY = bombs.mPositions[index].y() + BOMB_TIP_Y;
+        if(tipX <= player.x() - playerDrift ||
+            tipX >= player.x() + F_SPRITE_SIZE + playerDrift ||
+            tipY >= player.y() + F_SPRITE_SIZE)
+        {
+            continue;
+        }
+        eventTime = std::min(eventTime, now + TimeToCover(player.y() - tipY, bombs.mVelocity.y()));
+    }
+
+    return std::max(now, eventTime - TIME_MARGIN);
+}
+
+FastForward::FastForward(GameState& state, FastForwardMode mode) : mState(state),
+    mMode(mode),
+    mEventTime(state.mLastTime),
+    mTimestamped(false),
+    mPending(false),
+    mFrames(0),
+    mSteps(0)
+{
+    mKeys.fire = false;
+    mKeys.left = false;
+    mKeys.right = false;
+}
+
+void FastForward::simulate(const FrameInput& input)
+{
+    ++mFrames;
+
+    if(!isQuiet(input))
+    {
+        flush();
+
+        //Timestamped frames hold the keys of the last event.
+        mKeys = input.mTimestamped ? mState.mHeldKeys : input.mKeys;
+        mTimestamped = input.mTimestamped;
+        mEventTime = mState.mLastTime;
+        if(mState.mPlayerLives)
+        {
+            mEventTime = NextGameEventTime(mState, mKeys);
+        }
+
+        if(!isQuiet(input))
+        {
+            if(mState.mPlayerLives)
+            {
+                SimulateGame(mState, input);
+                ++mSteps;
+            }
+            mEventTime = mState.mLastTime;
+            return;
+        }
+    }
+
+    if(mMode == FAST_FORWARD_JUMP)
+    {
+        mPendingInput = input;
+        mPending = true;
+    }
+    else
+    {
+        //All that SimulateGame would do.
+        const float lastTime = mState.mLastTime;
+        mState.mLastTime = input.mTime;
+        MoveObjects(mState.mScene, lastTime, input.mTime);
+        if(input.mTimestamped)
+        {
+            ProcessInputEvents(mState, input, lastTime);
+        }
+        else
+        {
+            ProcessKeyboardInput(mState, input.mKeys, lastTime, input.mTime);
+        }
+    }
+}
+
+void FastForward::flush()
+{
+    if(mPending)
+    {
+        mPending = false;
+        SimulateGame(mState, mPendingInput);
+        ++mSteps;
+    }
+}
+
+uint32_t FastForward::getFrameCount() const
+{
+    return mFrames;
+}
+
+uint32_t FastForward::getStepCount() const
+{
+    return mSteps;
+}
+
+bool FastForward::isQuiet(const FrameInput& input) const
+{
+    if(input.mTimestamped != mTimestamped || input.mTime >= mEventTime)
+    {
+        return false;
+    }
+    return input.mTimestamped ? input.mNumEvents == 0 : SameKeys(input.mKeys, mKeys);
+}
@@ -0,0 +1,66 @@
+#ifndef FAST_FORWARD_H
+#define FAST_FORWARD_H
+
+#include "Game.h"
+
+//Earliest time after state.mLastTime at which holding keys could make
+//SimulateGame do anything but move objects in straight lines: a collision,
+//a cull, the aliens reaching a wall, the player reaching an edge, a rocket
+//auto-repeating, or a whole second passing (Animate and AliensRandomFire).
+//Returns state.mLastTime if something happens straight away.
+float NextGameEventTime(const GameState& state,
+                        const IDiceInvaders::KeyStatus& keys);
+
+enum FastForwardMode
+{
+    //Quiet frames only move objects, each by its own frame's delta, so the
+    //game is bit for bit the one SimulateGame plays. For replays.
+    FAST_FORWARD_EXACT,
+
+    //A run of quiet frames is simulated as one step to the last frame's
+    //time. Every event happens on the frame it would have given the same
+    //positions, but one long move rounds differently from many short ones.
+    //The alien wall test is sensitive enough to that for long games to
+    //drift apart, so this is for soak runs, not for checking replays.
+    FAST_FORWARD_JUMP,
+};
+
+//Feeds frames to SimulateGame like a replay would, skipping the work of
+//every frame that ends before NextGameEventTime with the keys unchanged.
+//A timestamped frame with key events is always simulated in full.
+class FastForward
+{
+public:
+    FastForward(GameState& state, FastForwardMode mode);
+
+    void simulate(const FrameInput& input);
+
+    //Finish a held back jump. Call before looking at the state.
+    void flush();
+
+    uint32_t getFrameCount() const;
+    uint32_t getStepCount() const;//Frames given to SimulateGame.
+
+private:
+    FastForward(const FastForward&);
+    FastForward& operator=(const FastForward&);
+
+    bool isQuiet(const FrameInput& input) const;
+
+private:
+    GameState& mState;
+    FastForwardMode mMode;
+
+    //The next event and the keys it was worked out for.
+    float mEventTime;
+    IDiceInvaders::KeyStatus mKeys;
+    bool mTimestamped;
+
+    bool mPending;//FAST_FORWARD_JUMP has held frames back.
+    FrameInput mPendingInput;
+
+    uint32_t mFrames;
+    uint32_t mSteps;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "FixedPoint.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FIXED_POINT_SSE2
+#include <emmintrin.h>
+#endif
+
+void AddFixedStep(FixedVec2* positions, const uint32_t count, const FixedVec2& step)
+{
+    uint32_t index = 0;
+
+#if defined(FIXED_POINT_SSE2)
+    //x in the low half of each 32 bit lane, y in the high half.
+    const __m128i steps = _mm_set1_epi32(static_cast<int>(
+        static_cast<uint32_t>(static_cast<uint16_t>(step.rawY())) << 16 |
+        static_cast<uint16_t>(step.rawX())));
+    for(; index + 4 <= count; index += 4)
+    {
+        __m128i* four = reinterpret_cast<__m128i*>(&positions[index]);
+        _mm_storeu_si128(four, _mm_adds_epi16(_mm_loadu_si128(four), steps));
+    }
+#endif
+
+    for(; index < count; ++index)
+    {
+        positions[index] += step;
+    }
+}
+
+uint32_t FixedHitMask(const int tipX, const int tipY,
+                      const FixedVec2* targets,
+                      const uint32_t count,
+                      const int width,
+                      const int height)
+{
+    uint32_t mask = 0;
+    uint32_t index = 0;
+
+#if defined(FIXED_POINT_SSE2)
+    //The tip is inside when 0 < dx < width and 0 < dy < height, with dx,
+    //dy the tip less the corner. Lanes are widened to 32 bits so the
+    //differences cannot overflow.
+    const __m128i tipXs = _mm_set1_epi32(tipX);
+    const __m128i tipYs = _mm_set1_epi32(tipY);
+    const __m128i widths = _mm_set1_epi32(width);
+    const __m128i heights = _mm_set1_epi32(height);
+    const __m128i zero = _mm_setzero_si128();
+    for(; index + 4 <= count; index += 4)
+    {
+        const __m128i four = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&targets[index]));
+        const __m128i xs = _mm_srai_epi32(_mm_slli_epi32(four, 16), 16);
+        const __m128i ys = _mm_srai_epi32(four, 16);
+        const __m128i dx = _mm_sub_epi32(tipXs, xs);
+        const __m128i dy = _mm_sub_epi32(tipYs, ys);
+        const __m128i inside = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi32(dx, zero), _mm_cmpgt_epi32(widths, dx)),
+            _mm_and_si128(_mm_cmpgt_epi32(dy, zero), _mm_cmpgt_epi32(heights, dy)));
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(inside))) << index;
+    }
+#endif
+
+    for(; index < count; ++index)
+    {
+        const int dx = tipX - targets[index].rawX();
+        const int dy = tipY - targets[index].rawY();
+        if(dx > 0 && dx < width && dy > 0 && dy < height)
+        {
+            mask |= 1u << index;
+        }
+    }
+    return mask;
+}
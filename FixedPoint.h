@@ -0,0 +1,129 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <algorithm>
+#include <cmath>
+#include "pstdint.h"
+#include "Vec2.h"
+
+//Steps per pixel of FixedVec2.
+const int FIXED_FRACTION_BITS = 3;
+const int FIXED_ONE = 1 << FIXED_FRACTION_BITS;
+
+//Pixels a FixedVec2 covers: -4096 to 4095.875.
+const float FIXED_MIN = -32768.0f / FIXED_ONE;
+const float FIXED_MAX = 32767.0f / FIXED_ONE;
+
+//Nearest step to value, clamped to the range.
+inline int16_t ToFixed(const float value)
+{
+    const float clamped = std::min(std::max(value, FIXED_MIN), FIXED_MAX);
+    return static_cast<int16_t>(std::floor(clamped * FIXED_ONE + 0.5f));
+}
+
+//Steps from where velocity takes something by lastTime to where it takes
+//it by newTime, both from time 0 and rounded to the nearest step. The
+//steps of consecutive frames add up to the rounded distance over all of
+//them, whatever the frames' lengths. Rounding each frame's velocity times
+//its length would lose or gain up to half a step every frame.
+inline int16_t FixedStepBetween(const float velocity, const float lastTime, const float newTime)
+{
+    const double stepsPerSec = static_cast<double>(velocity) * FIXED_ONE;
+    const double steps = std::floor(stepsPerSec * newTime + 0.5) - std::floor(stepsPerSec * lastTime + 0.5);
+    return static_cast<int16_t>(std::min(std::max(steps, -32768.0), 32767.0));
+}
+
+//A position in 1/8 pixel steps, half the size of a Vec2. Sums of these
+//are integer sums, the same on every compiler and CPU, and every value
+//is exact as a float, so x() and y() compare the same as the integers.
+//Floats are rounded to the nearest step on the way in. Sums saturate at
+//the ends of the range, which is far outside any window, so objects
+//that get there are culled.
+class FixedVec2
+{
+public:
+    FixedVec2() : mX(0), mY(0) {}
+    FixedVec2(const Vec2& rhs) : mX(ToFixed(rhs.x())), mY(ToFixed(rhs.y())) {}
+
+    static FixedVec2 FromRaw(const int16_t x, const int16_t y)
+    {
+        FixedVec2 value;
+        value.mX = x;
+        value.mY = y;
+        return value;
+    }
+
+    operator Vec2() const
+    {
+        return Vec2(x(), y());
+    }
+
+    const Vec2 operator - (const Vec2& rhs) const
+    {
+        return Vec2(x() - rhs.x(), y() - rhs.y());
+    }
+
+    const Vec2 operator + (const Vec2& rhs) const
+    {
+        return Vec2(x() + rhs.x(), y() + rhs.y());
+    }
+
+    FixedVec2& operator += (const FixedVec2& rhs)
+    {
+        mX = Saturate(mX + rhs.mX);
+        mY = Saturate(mY + rhs.mY);
+        return *this;
+    }
+
+    void moveX(const float delta)
+    {
+        mX = ToFixed(x() + delta);
+    }
+    void moveY(const float delta)
+    {
+        mY = ToFixed(y() + delta);
+    }
+
+    void clampX(const float min, const float max)
+    {
+        mX = ToFixed(std::min(std::max(x(), min), max));
+    }
+
+    float x() const {
+        return static_cast<float>(mX) / FIXED_ONE;
+    }
+    float y() const {
+        return static_cast<float>(mY) / FIXED_ONE;
+    }
+
+    int16_t rawX() const {
+        return mX;
+    }
+    int16_t rawY() const {
+        return mY;
+    }
+
+private:
+    static int16_t Saturate(const int value)
+    {
+        return static_cast<int16_t>(std::min(std::max(value, -32768), 32767));
+    }
+
+    int16_t mX;
+    int16_t mY;
+};
+
+//positions[0, count) += step, four at a time with SSE2 where the build
+//has it. The same sums as FixedVec2's +=.
+void AddFixedStep(FixedVec2* positions, const uint32_t count, const FixedVec2& step);
+
+//Bit n of the result is set if the pixel tip, in steps, is strictly
+//inside the width x height box at targets[n], for n < count <= 32. Four
+//targets at a time with SSE2 where the build has it.
+uint32_t FixedHitMask(const int tipX, const int tipY,
+                      const FixedVec2* targets,
+                      const uint32_t count,
+                      const int width,
+                      const int height);
+
+#endif
@@ -0,0 +1,116 @@
+#include "FrameArena.h"
+#include "Log.h"
+#include <algorithm>
+#include <new>
+
+FrameArena::FrameArena() : mBlock(0),
+    mCapacity(0),
+    mUsed(0),
+    mFrameBytes(0),
+    mWanted(0),
+    mHighWater(0),
+    mOverflow(0),
+    mOverflows(0)
+{
+}
+
+FrameArena::FrameArena(const FrameArena& other) : mBlock(0),
+    mCapacity(0),
+    mUsed(0),
+    mFrameBytes(0),
+    mWanted(std::max(other.mCapacity, other.mWanted)),
+    mHighWater(0),
+    mOverflow(0),
+    mOverflows(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    releaseOverflow();
+    AlignedFree(mBlock);
+}
+
+FrameArena& FrameArena::operator=(const FrameArena&)
+{
+    return *this;
+}
+
+void FrameArena::reset()
+{
+    mHighWater = std::max(mHighWater, mFrameBytes);
+    if(mOverflow)
+    {
+        releaseOverflow();
+        mOverflows++;
+        mWanted = std::max(mWanted, mFrameBytes);
+    }
+    mUsed = 0;
+    mFrameBytes = 0;
+
+    if(mWanted > mCapacity)
+    {
+        AlignedFree(mBlock);
+        mBlock = static_cast<char*>(AlignedMalloc(mWanted, CACHE_LINE_SIZE));
+        if(!mBlock)
+        {
+            throw std::bad_alloc();
+        }
+        mCapacity = mWanted;
+    }
+}
+
+void FrameArena::reserve(size_t bytes)
+{
+    mWanted = std::max(mWanted, bytes);
+    if(!mFrameBytes)
+    {
+        reset();
+    }
+}
+
+void* FrameArena::allocateBytes(size_t bytes)
+{
+    //A copy takes its memory when first used.
+    if(!mBlock && !mFrameBytes && mWanted)
+    {
+        reset();
+    }
+
+    mFrameBytes += bytes;
+    if(mUsed + bytes <= mCapacity)
+    {
+        void* memory = mBlock + mUsed;
+        mUsed += bytes;
+        return memory;
+    }
+
+    //The block's first line links it to the others of the frame.
+    char* block = static_cast<char*>(AlignedMalloc(CACHE_LINE_SIZE + bytes, CACHE_LINE_SIZE));
+    if(!block)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<void**>(block) = mOverflow;
+    mOverflow = block;
+    return block + CACHE_LINE_SIZE;
+}
+
+void FrameArena::releaseOverflow()
+{
+    while(mOverflow)
+    {
+        void* next = *static_cast<void**>(mOverflow);
+        AlignedFree(mOverflow);
+        mOverflow = next;
+    }
+}
+
+void FrameArena::logStats(const char* name) const
+{
+    LogMessage("%s: %.1f KB at most in a frame, %.1f KB capacity, %u frames overflowed",
+        name,
+        std::max(mHighWater, mFrameBytes) / 1024.0,
+        mCapacity / 1024.0,
+        mOverflows);
+}
@@ -0,0 +1,139 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include "AlignedAllocator.h"
+#include "pstdint.h"
+
+//count Ts of a FrameArena. The memory is the arena's and only lasts until
+//its next reset.
+template<class T>
+class ArenaSpan
+{
+public:
+    ArenaSpan() : mData(0),
+        mSize(0)
+    {
+    }
+
+    ArenaSpan(T* data, uint32_t size) : mData(data),
+        mSize(size)
+    {
+    }
+
+    T& operator[](const uint32_t index)
+    {
+        assert(index < mSize);
+        return mData[index];
+    }
+    const T& operator[](const uint32_t index) const
+    {
+        assert(index < mSize);
+        return mData[index];
+    }
+
+    T* begin() { return mData; }
+    T* end() { return mData + mSize; }
+    const T* begin() const { return mData; }
+    const T* end() const { return mData + mSize; }
+
+    uint32_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+private:
+    T* mData;
+    uint32_t mSize;
+};
+
+//A block of memory handed out front to back and taken back all at once,
+//for the buffers a frame fills and drops again. reset() at the start of a
+//frame hands out the whole block again, so once it is big enough a frame
+//allocates nothing. A frame that needs more gets the rest from the heap,
+//and the next reset replaces the block with one as big as the most any
+//frame has needed.
+//
+//Every allocation starts a cache line, so spans filled by different
+//threads never share one. Memory is not constructed or destroyed: spans
+//are of plain data only. Not thread safe; a pass that wants one per
+//thread keeps one per thread.
+//
+//What is in an arena is never part of the state that owns it. A copy
+//starts empty and takes the same capacity when first used; assignment
+//leaves an arena as it is.
+class FrameArena
+{
+public:
+    FrameArena();
+    FrameArena(const FrameArena& other);
+    ~FrameArena();
+    FrameArena& operator=(const FrameArena& other);
+
+    //Take back everything handed out since the last reset.
+    void reset();
+
+    //Room for at least bytes between resets, from the next reset if
+    //anything is handed out now.
+    void reserve(size_t bytes);
+
+    //What count Ts take of an arena, to add up for reserve.
+    template<class T>
+    static size_t bytesFor(const uint32_t count)
+    {
+        return (count * sizeof(T) + CACHE_LINE_SIZE - 1) & ~static_cast<size_t>(CACHE_LINE_SIZE - 1);
+    }
+
+    //count Ts, uninitialised.
+    template<class T>
+    ArenaSpan<T> allocate(const uint32_t count)
+    {
+        return ArenaSpan<T>(static_cast<T*>(allocateBytes(bytesFor<T>(count))), count);
+    }
+
+    //count Ts set to value.
+    template<class T>
+    ArenaSpan<T> allocate(const uint32_t count, const T& value)
+    {
+        ArenaSpan<T> span = allocate<T>(count);
+        for(uint32_t index = 0; index < count; ++index)
+        {
+            span[index] = value;
+        }
+        return span;
+    }
+
+    size_t getCapacity() const
+    {
+        return mCapacity;
+    }
+
+    //The most bytes handed out between two resets.
+    size_t getHighWater() const
+    {
+        return mHighWater;
+    }
+
+    //Resets after which a frame had taken from the heap.
+    uint32_t getOverflows() const
+    {
+        return mOverflows;
+    }
+
+    //High water mark, capacity and overflows.
+    void logStats(const char* name) const;
+
+private:
+    void* allocateBytes(size_t bytes);
+    void releaseOverflow();
+
+    char* mBlock;
+    size_t mCapacity;
+    size_t mUsed;//Of mBlock.
+    size_t mFrameBytes;//Handed out since the reset, overflow included.
+    size_t mWanted;//Capacity for the next reset.
+    size_t mHighWater;
+    void* mOverflow;//Heap blocks of this frame, linked through their heads.
+    uint32_t mOverflows;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "FrameLimiter.h"
+#include "Log.h"
+#include "Threading.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+
+const float FrameLimiter::SPIN_TIME = 0.002f;
+
+FrameLimiter::FrameLimiter(IDiceInvaders* system, float framesPerSecond) : mSystem(system),
+    mFrameTime(framesPerSecond > 0.0f ? 1.0f / framesPerSecond : 0.0f),
+    mFrames(0),
+    mFrameTimeSum(0.0),
+    mFrameTimeSquareSum(0.0),
+    mMaxFrameTime(0.0f),
+    mStartWallTime(GetTimeNanoseconds()),
+    mStartCpuTime(GetProcessCpuNanoseconds())
+{
+    mLastFrameTime = mSystem->getElapsedTime();
+    mNextFrameTime = mLastFrameTime + mFrameTime;
+
+    if(mFrameTime > 0.0f)
+    {
+        BeginHighResolutionSleep();
+    }
+}
+
+FrameLimiter::~FrameLimiter()
+{
+    if(mFrameTime > 0.0f)
+    {
+        EndHighResolutionSleep();
+    }
+}
+
+void FrameLimiter::wait()
+{
+    float now = mSystem->getElapsedTime();
+
+    if(mFrameTime > 0.0f)
+    {
+        float remaining = mNextFrameTime - now;
+        while(remaining > SPIN_TIME)
+        {
+            ThreadSleep(static_cast<uint32_t>((remaining - SPIN_TIME) * 1000000.0f));
+            now = mSystem->getElapsedTime();
+            remaining = mNextFrameTime - now;
+        }
+
+        while(now < mNextFrameTime)
+        {
+            ThreadYield();
+            now = mSystem->getElapsedTime();
+        }
+
+        //Keep to the schedule after a short overrun, but start over after a
+        //long stall rather than run a burst of frames to catch up.
+        mNextFrameTime += mFrameTime;
+        if(mNextFrameTime < now)
+        {
+            mNextFrameTime = now + mFrameTime;
+        }
+    }
+
+    const float frameTime = now - mLastFrameTime;
+    mLastFrameTime = now;
+
+    mFrames++;
+    mFrameTimeSum += frameTime;
+    mFrameTimeSquareSum += static_cast<double>(frameTime) * frameTime;
+    mMaxFrameTime = std::max(mMaxFrameTime, frameTime);
+}
+
+void FrameLimiter::logStats(const char* name) const
+{
+    if(!mFrames)
+    {
+        return;
+    }
+
+    const double mean = mFrameTimeSum / mFrames;
+    const double variance = std::max(0.0, mFrameTimeSquareSum / mFrames - mean * mean);
+
+    const uint64_t wallTime = GetTimeNanoseconds() - mStartWallTime;
+    const uint64_t cpuTime = GetProcessCpuNanoseconds() - mStartCpuTime;
+
+    //CPU use is of one core, so it can pass 100% with worker threads.
+    LogMessage("%s: %u frames, %.3f ms mean, %.3f ms jitter, %.3f ms worst, %.1f%% CPU",
+        name,
+        mFrames,
+        mean * 1000.0,
+        std::sqrt(variance) * 1000.0,
+        mMaxFrameTime * 1000.0f,
+        wallTime ? cpuTime * 100.0 / wallTime : 0.0);
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include "DiceInvaders.h"
+#include "pstdint.h"
+
+//Frame rate for screens with nothing moving, such as the final score.
+const float IDLE_FRAME_RATE = 10.0f;
+
+//Paces a loop that calls system->update() to a target frame rate instead
+//of letting it spin a core. The wait sleeps while the next frame is more
+//than SPIN_TIME away, since a sleep can overshoot by up to a scheduler
+//tick, and yields in a loop for the rest. Times come from
+//getElapsedTime so the pacing follows the same clock as the game.
+//
+//Frame time and CPU statistics are gathered whether or not a rate is set,
+//so an unlimited run gives the numbers to compare against.
+class FrameLimiter
+{
+public:
+    //framesPerSecond 0 leaves the loop unlimited.
+    FrameLimiter(IDiceInvaders* system, float framesPerSecond);
+    ~FrameLimiter();
+
+    //Call once per frame after update(). Returns when the next frame is due.
+    void wait();
+
+    //Log frame count, mean frame time, jitter (standard deviation and worst
+    //frame) and process CPU use since construction.
+    void logStats(const char* name) const;
+
+private:
+    FrameLimiter(const FrameLimiter&);
+    FrameLimiter& operator=(const FrameLimiter&);
+
+private:
+    static const float SPIN_TIME;
+
+    IDiceInvaders* mSystem;
+    float mFrameTime;//0 when unlimited.
+    float mNextFrameTime;
+    float mLastFrameTime;
+
+    uint32_t mFrames;
+    double mFrameTimeSum;
+    double mFrameTimeSquareSum;
+    float mMaxFrameTime;
+    uint64_t mStartWallTime;
+    uint64_t mStartCpuTime;
+};
+
+#endif
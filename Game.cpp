@@ -0,0 +1,562 @@
+#include "Game.h"
+#include "AllocationTracker.h"
+#include "InputSampler.h"
+#include "Latency.h"
+#include "LiveState.h"
+#include "Log.h"
+#include "ParallelObjects.h"
+#include "Replay.h"
+#include "StartupTimeline.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+void SampleFrameInput(IDiceInvaders* system,
+                      InputSampler* sampler,
+                      FrameInput& input)
+{
+    input.mTime = system->getElapsedTime();
+    input.mNumEvents = 0;
+    input.mTimestamped = sampler != 0;
+
+    if(sampler)
+    {
+        sampler->collectEvents(input);
+    }
+    else
+    {
+        system->getKeyStatus(input.mKeys);
+    }
+
+    LatencyMark(LATENCY_SAMPLED);
+}
+
+//How far the player goes holding a direction key from startTime to
+//endTime. In whole steps with FIXED_POSITIONS, so it adds up the same at
+//any frame rate, see MoveRows.
+static float PlayerMove(const float startTime,
+                        const float endTime)
+{
+#if defined(FIXED_POSITIONS)
+    return static_cast<float>(FixedStepBetween(PLAYER_SPEED, startTime, endTime)) / FIXED_ONE;
+#else
+    return (endTime - startTime) * PLAYER_SPEED;
+#endif
+}
+
+void ProcessKeyboardInput(GameState& state,
+                          const IDiceInvaders::KeyStatus& keys,
+                          const float lastTime,
+                          const float currentTime)
+{
+    LatencyMark(LATENCY_PROCESSED);
+
+    const float move = PlayerMove(lastTime, currentTime);
+
+    Position& player = state.mScene.mTables[TABLE_PLAYER].mPositions[0];
+
+    player.moveX((keys.right * move) + (-move * keys.left));
+    player.clampX(0.0f, state.mWindowWidth-F_SPRITE_SIZE);
+
+    if(keys.fire)
+    {
+        if(!state.mFireKeyWasDown ||
+            (currentTime-state.mTimeOfLastFire > ROCKET_RATE_OF_FIRE))
+        {
+            //Fire rocket upwards from just above the player position.
+            CreateObjects(state.mScene.mTables[TABLE_ROCKETS], 1, player - Vec2(0, SPRITE_SIZE/2), Vec2(0, 0));
+
+            state.mTimeOfLastFire = currentTime;
+        }
+    }
+    state.mFireKeyWasDown = keys.fire;
+}
+
+//Launch a rocket from the player at fireTime and move it on to frameEndTime.
+static void FireRocket(GameState& state,
+                       const float fireTime,
+                       const float frameEndTime)
+{
+    //Fire rocket upwards from just above the player position.
+    ObjectTable& rockets = state.mScene.mTables[TABLE_ROCKETS];
+    Vec2 position = state.mScene.mTables[TABLE_PLAYER].mPositions[0] - Vec2(0, SPRITE_SIZE/2);
+    position += rockets.mVelocity * (frameEndTime - fireTime);
+    CreateObjects(rockets, 1, position, Vec2(0, 0));
+
+    state.mTimeOfLastFire = fireTime;
+}
+
+//Hold keys from startTime to endTime, auto-repeating fire.
+static void ProcessKeySegment(GameState& state,
+                              const IDiceInvaders::KeyStatus& keys,
+                              float startTime,
+                              const float endTime,
+                              const float frameEndTime)
+{
+    Position& player = state.mScene.mTables[TABLE_PLAYER].mPositions[0];
+
+    if(keys.fire)
+    {
+        while(state.mTimeOfLastFire + ROCKET_RATE_OF_FIRE < endTime)
+        {
+            const float fireTime = std::max(startTime, state.mTimeOfLastFire + ROCKET_RATE_OF_FIRE);
+
+            const float move = PlayerMove(startTime, fireTime);
+            player.moveX((keys.right * move) + (-move * keys.left));
+            player.clampX(0.0f, state.mWindowWidth-F_SPRITE_SIZE);
+
+            FireRocket(state, fireTime, frameEndTime);
+            startTime = fireTime;
+        }
+    }
+
+    const float move = PlayerMove(startTime, endTime);
+    player.moveX((keys.right * move) + (-move * keys.left));
+    player.clampX(0.0f, state.mWindowWidth-F_SPRITE_SIZE);
+}
+
+void ProcessInputEvents(GameState& state,
+                        const FrameInput& input,
+                        const float frameStartTime)
+{
+    LatencyMark(LATENCY_PROCESSED);
+
+    IDiceInvaders::KeyStatus keys = state.mHeldKeys;
+    float segmentStart = frameStartTime;
+
+    for(uint32_t index = 0; index < input.mNumEvents; ++index)
+    {
+        const InputEvent& event = input.mEvents[index];
+        const float eventTime = std::min(std::max(event.mTime, segmentStart), input.mTime);
+
+        ProcessKeySegment(state, keys, segmentStart, eventTime, input.mTime);
+
+        //A press always fires, however soon after the last rocket.
+        if(event.mKeys.fire && !keys.fire)
+        {
+            FireRocket(state, eventTime, input.mTime);
+        }
+
+        keys = event.mKeys;
+        segmentStart = eventTime;
+    }
+
+    ProcessKeySegment(state, keys, segmentStart, input.mTime, input.mTime);
+
+    state.mHeldKeys = keys;
+    state.mFireKeyWasDown = keys.fire;
+}
+
+void ResultScreen(IDiceInvaders* system,
+                GameState& state)
+{
+    UpdateFinalScoreText(state.mHud, state.mPlayerScore);
+    system->drawText(state.mWindowWidth/3, state.mWindowHeight/2, state.mHud.mFinalScoreText);
+}
+
+void UpdateHud(GameState& state,
+               const float deltaTimeInSecs)
+{
+    UpdateScoreText(state.mHud, state.mPlayerScore);
+
+#if defined(SHOW_STATS)
+    UpdateStatsText(state.mHud, NumObjects(state.mScene), deltaTimeInSecs);
+#endif
+}
+
+void DrawGame(IDiceInvaders* system,
+              ISprite* sprites[NUM_OBJECT_TYPES],
+              const int windowWidth,
+              const int windowHeight,
+              const SceneTables& scene,
+              const HudText& hud,
+              const int playerLives)
+{
+    system->drawText(0, windowHeight-SPRITE_SIZE, hud.mScoreText);
+
+#if defined(SHOW_STATS)
+    system->drawText(0, windowHeight-64, hud.mStatsText);
+#endif
+
+    DrawObjects(scene,
+        sprites);
+
+    //Health. 1 player sprite for each life.
+    for(int i=0; i<playerLives; ++i)
+    {
+        const int x = windowWidth-(SPRITE_SIZE*GameState::MaxLives) + SPRITE_SIZE*i;
+        const int y = windowHeight-SPRITE_SIZE;
+        sprites[PLAYER]->draw(x, y);
+    }
+}
+
+void BeginSimulation(SimulationFrame& frame,
+                     GameState& state,
+                     const FrameInput& input)
+{
+    frame.mState = &state;
+    frame.mInput = &input;
+    frame.mLastTime = state.mLastTime;
+    frame.mDeltaTime = input.mTime - state.mLastTime;
+    frame.mFloorNewTime = static_cast<int>(std::floor(input.mTime));
+    for(int i=0; i<NUM_OBJECT_TYPES;++i)
+    {
+        frame.mHitCounts[i] = 0;
+    }
+    frame.mPool = 0;
+
+    //Loops that simulate without GameScreen start their frames here.
+    state.mArena.reset();
+}
+
+void AlienWallPhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+
+    Box mAlienBBox;//Bounding box of ALL aliens
+    ParallelCalcAlienBBox(frame.mPool, state.mScene, state.mArena, mAlienBBox);
+
+    bool hitLeft =  mAlienBBox.mLeft <= 0;
+    bool hitRight = mAlienBBox.mRight >= (state.mWindowWidth);
+    if(hitLeft || hitRight)
+        AliensChangeDirection(state.mScene, mAlienBBox, 0, state.mWindowWidth-F_SPRITE_SIZE-1.0f, frame.mDeltaTime);
+}
+
+void MovePhase(SimulationFrame& frame,
+               const uint32_t begin,
+               const uint32_t end)
+{
+    ParallelMoveObjects(frame.mPool, frame.mState->mScene, std::max(begin, FIRST_GENERIC_OBJECT), end,
+        frame.mLastTime, frame.mInput->mTime);
+}
+
+void CullPhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+
+    int cullCounts[NUM_OBJECT_TYPES];
+    for(int i=0; i<NUM_OBJECT_TYPES;++i)
+    {
+        cullCounts[i] = 0;
+    }
+    ParallelCullObjects(frame.mPool, state.mScene, state.mArena, state.mWindowWidth, state.mWindowHeight-state.HudWidth, cullCounts);
+
+    if(cullCounts[ENEMY1] || cullCounts[ENEMY2])
+    {
+        //Alien reached the bottom of the window
+        state.mPlayerLives = 0;
+    }
+}
+
+void AnimatePhase(SimulationFrame& frame,
+                  const uint32_t begin,
+                  const uint32_t end)
+{
+    ParallelAnimate(frame.mPool, frame.mState->mScene, std::max(begin, FIRST_GENERIC_OBJECT), end, frame.mFloorNewTime);
+}
+
+void SpritePhase(SimulationFrame& frame)
+{
+    AnimateSprites(frame.mState->mScene, frame.mFloorNewTime);
+}
+
+void CollidePhase(SimulationFrame& frame)
+{
+    CollideObjects(frame.mState->mScene, frame.mState->mBroadphase, frame.mState->mArena, frame.mHitCounts);
+}
+
+void ScorePhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+
+    state.mPlayerScore += frame.mHitCounts[ENEMY1];
+    state.mPlayerScore += frame.mHitCounts[ENEMY2];
+    state.mPlayerLives -= frame.mHitCounts[PLAYER];
+
+    state.mPlayerScore = std::min(state.mPlayerScore, MAX_SCORE);
+}
+
+void RandomFirePhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+    AliensRandomFire(state.mScene, state.mFloorLastTime, frame.mFloorNewTime, state.mRandom);
+}
+
+void InputPhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+    const FrameInput& input = *frame.mInput;
+
+    if(input.mTimestamped)
+    {
+        ProcessInputEvents(state, input, frame.mLastTime);
+    }
+    else
+    {
+        ProcessKeyboardInput(state,
+            input.mKeys,
+            frame.mLastTime,
+            input.mTime);
+    }
+}
+
+void SpawnPhase(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+
+    //Check for no more aliens. A new wave waits while the player is the
+    //only object.
+    if(state.mScene.mTables[TABLE_ALIENS].mPositions.empty() && NumObjects(state.mScene) > 1)
+        SpawnAliens(state.mScene, state.mWindowWidth);
+}
+
+void EndSimulation(SimulationFrame& frame)
+{
+    GameState& state = *frame.mState;
+
+    state.mLastTime = frame.mInput->mTime;
+    state.mFloorLastTime = frame.mFloorNewTime;
+
+    //Wait until the end to free all objects so preceding
+    //code and safely assume there is at least 1 object in vector.
+    if(!state.mPlayerLives)
+    {
+        ResetScene(state.mScene);
+    }
+}
+
+void SimulateGame(GameState& state,
+                  const FrameInput& input)
+{
+    SimulateGame(state, input, 0);
+}
+
+const char* const SIMULATION_PHASE_NAMES[NUM_SIMULATION_PHASES] =
+{
+    "AlienWall",
+    "Move",
+    "Cull",
+    "Animate",
+    "Sprite",
+    "Collide",
+    "Score",
+    "RandomFire",
+    "Input",
+    "Spawn",
+};
+
+//Nanoseconds from one lap to the next into times, if there are any.
+class PhaseClock
+{
+public:
+    explicit PhaseClock(uint32_t* times) : mTimes(times),
+        mLastTime(times ? GetTimeNanoseconds() : 0)
+    {
+    }
+
+    void lap(const SimulationPhase phase)
+    {
+        if(mTimes)
+        {
+            const uint64_t now = GetTimeNanoseconds();
+            mTimes[phase] = static_cast<uint32_t>(now - mLastTime);
+            mLastTime = now;
+        }
+    }
+
+private:
+    uint32_t* mTimes;
+    uint64_t mLastTime;
+};
+
+void SimulateGame(GameState& state,
+                  const FrameInput& input,
+                  ThreadPool* pool)
+{
+    SimulateGame(state, input, pool, 0);
+}
+
+void SimulateGame(GameState& state,
+                  const FrameInput& input,
+                  ThreadPool* pool,
+                  uint32_t phaseTimes[NUM_SIMULATION_PHASES])
+{
+    SimulationFrame frame;
+    BeginSimulation(frame, state, input);
+    frame.mPool = pool;
+
+    PhaseClock clock(phaseTimes);
+    AlienWallPhase(frame);
+    clock.lap(PHASE_ALIEN_WALL);
+    MovePhase(frame, 0, NumObjects(state.mScene));
+    clock.lap(PHASE_MOVE);
+    CullPhase(frame);
+    clock.lap(PHASE_CULL);
+    AnimatePhase(frame, 0, NumObjects(state.mScene));
+    clock.lap(PHASE_ANIMATE);
+    SpritePhase(frame);
+    clock.lap(PHASE_SPRITE);
+    CollidePhase(frame);
+    clock.lap(PHASE_COLLIDE);
+    ScorePhase(frame);
+    clock.lap(PHASE_SCORE);
+    RandomFirePhase(frame);
+    clock.lap(PHASE_RANDOM_FIRE);
+    InputPhase(frame);
+    clock.lap(PHASE_INPUT);
+    SpawnPhase(frame);
+    clock.lap(PHASE_SPAWN);
+
+    EndSimulation(frame);
+}
+
+void GameScreen(IDiceInvaders* system,
+                InputSampler* sampler,
+                ReplayWriter* recorder,
+                LiveStateWriter* exporter,
+                GameState& state)
+{
+    AllocationFrameBegin();
+    state.mArena.reset();
+
+    FrameInput input;
+    SampleFrameInput(system, sampler, input);
+
+    UpdateHud(state, input.mTime - state.mLastTime);
+
+    DrawGame(system,
+        state.mSprites,
+        state.mWindowWidth,
+        state.mWindowHeight,
+        state.mScene,
+        state.mHud,
+        state.mPlayerLives);
+
+    if(recorder)
+    {
+        recorder->record(state, input);
+    }
+
+    if(exporter)
+    {
+        uint32_t phaseTimes[NUM_SIMULATION_PHASES];
+        SimulateGame(state, input, 0, phaseTimes);
+        exporter->publish(state, phaseTimes);
+    }
+    else
+    {
+        SimulateGame(state, input);
+    }
+
+    AllocationFrameEnd();
+}
+
+void ResetLevel(GameState& gameState, const float time)
+{
+    const float fWindowWidth = static_cast<float>(gameState.mWindowWidth);
+    const float fWindowHeight = static_cast<float>(gameState.mWindowHeight);
+    const float fHudWidth = static_cast<float>(gameState.HudWidth);
+
+    ResetScene(gameState.mScene);
+    uint32_t rows[NUM_TABLES];
+    MaxTableRows(gameState.mWindowWidth, gameState.mWindowHeight, rows);
+    ReserveScene(gameState.mScene, rows);
+    gameState.mBroadphase.reserve(rows);
+    gameState.mArena.reserve(CullArenaBytes(rows) + CollideArenaBytes(rows));
+    gameState.mPlayerScore = 0;
+    gameState.mPlayerLives = GameState::MaxLives;
+    gameState.mFireKeyWasDown = 0;
+    gameState.mHeldKeys.fire = false;
+    gameState.mHeldKeys.left = false;
+    gameState.mHeldKeys.right = false;
+
+    CreateObjects(gameState.mScene.mTables[TABLE_PLAYER], 1, Vec2(fWindowWidth/2.0f, fWindowHeight-fHudWidth), Vec2(0, 0));
+
+    SpawnAliens(gameState.mScene, gameState.mWindowWidth);
+
+    gameState.mLastTime = time;
+    gameState.mFloorLastTime = static_cast<int>(std::floor(time));
+    gameState.mTimeOfLastFire = time;
+}
+
+const char* const SPRITE_PATHS[NUM_OBJECT_TYPES] =
+{
+    "data/player.bmp",
+    "data/enemy1.bmp",
+    "data/enemy2.bmp",
+    "data/bomb.bmp",
+    "data/rocket.bmp",
+    "data/null.bmp",
+};
+
+void InitLevel(IDiceInvaders* system, GameState& gameState)
+{
+    const uint64_t spriteStartTime = GetTimeNanoseconds();
+    for(uint32_t index = 0; index < NUM_OBJECT_TYPES; ++index)
+    {
+        StartupSpan span("createSprite", SPRITE_PATHS[index]);
+        gameState.mSprites[index] = system->createSprite(SPRITE_PATHS[index]);
+    }
+    LogMessage("InitLevel: %d sprites created in %.3f ms", NUM_OBJECT_TYPES,
+        NanosecondsToMilliseconds(GetTimeNanoseconds() - spriteStartTime));
+
+    ResetLevel(gameState, system->getElapsedTime());
+}
+
+//FNV-1a over 32-bit words.
+static void HashWord(uint32_t word, uint32_t& hash)
+{
+    for(uint32_t byte = 0; byte < 4; ++byte)
+    {
+        hash = (hash ^ ((word >> (byte * 8)) & 0xff)) * 16777619u;
+    }
+}
+
+static void HashFloat(float value, uint32_t& hash)
+{
+    uint32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    HashWord(word, hash);
+}
+
+uint32_t ChecksumGameState(const GameState& state)
+{
+    uint32_t hash = 2166136261u;
+    HashWord(state.mPlayerScore, hash);
+    HashWord(state.mPlayerLives, hash);
+    HashFloat(state.mLastTime, hash);
+    HashWord(state.mFloorLastTime, hash);
+    HashFloat(state.mTimeOfLastFire, hash);
+    HashWord(state.mFireKeyWasDown, hash);
+    HashWord(state.mHeldKeys.fire, hash);
+    HashWord(state.mHeldKeys.left, hash);
+    HashWord(state.mHeldKeys.right, hash);
+    HashWord(state.mRandom, hash);
+
+    //In scene order, as FlattenScene lists the objects.
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        const ObjectTable& source = state.mScene.mTables[table];
+        for(size_t row = 0; row < source.mPositions.size(); ++row)
+        {
+            HashWord(source.mType, hash);
+            HashFloat(source.mPositions[row].x(), hash);
+            HashFloat(source.mPositions[row].y(), hash);
+            HashFloat(source.mVelocity.x(), hash);
+            HashFloat(source.mVelocity.y(), hash);
+        }
+    }
+
+    const DestroyedTable& destroyed = state.mScene.mDestroyed;
+    for(size_t row = 0; row < destroyed.mPositions.size(); ++row)
+    {
+        HashWord(NULL_OBJECT, hash);
+        HashFloat(destroyed.mPositions[row].x(), hash);
+        HashFloat(destroyed.mPositions[row].y(), hash);
+        HashFloat(destroyed.mVelocities[row].x(), hash);
+        HashFloat(destroyed.mVelocities[row].y(), hash);
+    }
+    return hash;
+}
@@ -0,0 +1,207 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "Broadphase.h"
+#include "DiceInvaders.h"
+#include "Hud.h"
+#include "SceneObject.h"
+
+struct GameState
+{
+    static const int HudWidth = 32;
+    static const int MaxLives = 3;
+
+    GameState(int windowW, int windowH) : mWindowWidth(windowW),
+        mWindowHeight(windowH),
+        mPlayerScore(0),
+        mPlayerLives(MaxLives),
+        mFireKeyWasDown(0),
+        mRandom(1)
+    {
+        mHeldKeys.fire = false;
+        mHeldKeys.left = false;
+        mHeldKeys.right = false;
+        ResetScene(mScene);
+    }
+
+    int mWindowWidth;
+    int mWindowHeight;
+    int mPlayerScore;
+    int mPlayerLives;
+    float mLastTime;//Time values are in seconds.
+    int mFloorLastTime;
+    float mTimeOfLastFire;
+    int mFireKeyWasDown;
+    IDiceInvaders::KeyStatus mHeldKeys;//Keys down at mLastTime. Timestamped input only.
+    uint32_t mRandom;//NextRandom state.
+    SceneTables mScene;
+    SweepAndPrune mBroadphase;//Only speeds up CollidePhase, see Broadphase.h.
+    FrameArena mArena;//A frame's transient buffers. Reset by GameScreen and
+                      //BeginSimulation, not part of the game.
+    ISprite* mSprites[NUM_OBJECT_TYPES];
+    HudText mHud;
+};
+
+//A change of key state seen by the input thread.
+struct InputEvent
+{
+    float mTime;
+    IDiceInvaders::KeyStatus mKeys;//State from mTime on.
+};
+
+const uint32_t MAX_FRAME_INPUT_EVENTS = 32;
+
+//Everything the simulation reads from the system for one frame. Sampled
+//once at the start of the frame so a frame can be simulated away from
+//the thread that owns the window.
+//
+//Polled input applies mKeys to the whole frame. Timestamped input instead
+//starts from the keys held at the end of the last frame and applies each
+//event at its own time, so taps shorter than a frame are not lost.
+struct FrameInput
+{
+    float mTime;//getElapsedTime() in seconds.
+    IDiceInvaders::KeyStatus mKeys;
+    bool mTimestamped;
+    uint32_t mNumEvents;
+    InputEvent mEvents[MAX_FRAME_INPUT_EVENTS];//Sorted by time, all <= mTime.
+};
+
+class InputSampler;
+class LiveStateWriter;
+class ReplayWriter;
+class ThreadPool;
+
+//sampler may be null in which case the keys are polled now.
+void SampleFrameInput(IDiceInvaders* system,
+                      InputSampler* sampler,
+                      FrameInput& input);
+
+//Apply keys held over the frame [lastTime, currentTime].
+void ProcessKeyboardInput(GameState& state,
+                          const IDiceInvaders::KeyStatus& keys,
+                          const float lastTime,
+                          const float currentTime);
+
+//Apply timestamped key changes over the frame [frameStartTime, input.mTime].
+//Rockets are launched at the exact time of the key press (or of the
+//auto-repeat) and moved on by the rest of the frame.
+void ProcessInputEvents(GameState& state,
+                        const FrameInput& input,
+                        const float frameStartTime);
+
+//Refresh the HUD strings for the state about to be drawn.
+void UpdateHud(GameState& state,
+               const float deltaTimeInSecs);
+
+void DrawGame(IDiceInvaders* system,
+              ISprite* sprites[NUM_OBJECT_TYPES],
+              const int windowWidth,
+              const int windowHeight,
+              const SceneTables& scene,
+              const HudText& hud,
+              const int playerLives);
+
+//Advance the game to input.mTime. Does not touch the system so it can
+//run on any thread.
+void SimulateGame(GameState& state,
+                  const FrameInput& input);
+
+//SimulateGame with the per-object passes split across pool's threads once
+//the scene is big enough, see ParallelObjects.h. Plays out the same.
+void SimulateGame(GameState& state,
+                  const FrameInput& input,
+                  ThreadPool* pool);
+
+//The phases of SimulateGame below, in the order it runs them.
+enum SimulationPhase
+{
+    PHASE_ALIEN_WALL,
+    PHASE_MOVE,
+    PHASE_CULL,
+    PHASE_ANIMATE,
+    PHASE_SPRITE,
+    PHASE_COLLIDE,
+    PHASE_SCORE,
+    PHASE_RANDOM_FIRE,
+    PHASE_INPUT,
+    PHASE_SPAWN,
+    NUM_SIMULATION_PHASES,
+};
+
+extern const char* const SIMULATION_PHASE_NAMES[NUM_SIMULATION_PHASES];
+
+//SimulateGame that also times each phase, if phaseTimes is not null.
+//The clock is only read when it is.
+void SimulateGame(GameState& state,
+                  const FrameInput& input,
+                  ThreadPool* pool,
+                  uint32_t phaseTimes[NUM_SIMULATION_PHASES]);
+
+//SimulateGame is these phases run in order over one SimulationFrame, from
+//BeginSimulation to EndSimulation. GameJobs schedules them by the columns
+//of the state each one touches. The state's clock only moves on in
+//EndSimulation, so until then it still reads as the frame being drawn.
+struct SimulationFrame
+{
+    GameState* mState;
+    const FrameInput* mInput;
+    float mLastTime;
+    float mDeltaTime;
+    int mFloorNewTime;
+    int mHitCounts[NUM_OBJECT_TYPES];//Written by CollidePhase.
+    ThreadPool* mPool;//For the per-object passes. Null by default; GameJobs
+                      //keeps it null as its pool is running the phase.
+};
+
+void BeginSimulation(SimulationFrame& frame,
+                     GameState& state,
+                     const FrameInput& input);
+void AlienWallPhase(SimulationFrame& frame);
+//MovePhase and AnimatePhase take a range of scene indices, so disjoint
+//ranges can run on different threads. The player is skipped.
+void MovePhase(SimulationFrame& frame,
+               const uint32_t begin,
+               const uint32_t end);
+void CullPhase(SimulationFrame& frame);
+void AnimatePhase(SimulationFrame& frame,
+                  const uint32_t begin,
+                  const uint32_t end);
+//After every AnimatePhase range.
+void SpritePhase(SimulationFrame& frame);
+void CollidePhase(SimulationFrame& frame);
+void ScorePhase(SimulationFrame& frame);
+void RandomFirePhase(SimulationFrame& frame);
+void InputPhase(SimulationFrame& frame);
+void SpawnPhase(SimulationFrame& frame);
+void EndSimulation(SimulationFrame& frame);
+
+//One serial frame: sample input, draw the current state then simulate.
+//sampler may be null to poll the keys once per frame. recorder, if not
+//null, gets every frame's input. exporter, if not null, gets every
+//frame's state and phase times once it is simulated.
+void GameScreen(IDiceInvaders* system,
+                InputSampler* sampler,
+                ReplayWriter* recorder,
+                LiveStateWriter* exporter,
+                GameState& state);
+
+void ResultScreen(IDiceInvaders* system,
+                GameState& state);
+
+//Start a new game at time: full lives, no score, the player and the first
+//wave of aliens. Leaves the sprites alone so it needs no system.
+void ResetLevel(GameState& gameState, const float time);
+
+//The file each object type's sprite is created from, in ObjectType order.
+extern const char* const SPRITE_PATHS[NUM_OBJECT_TYPES];
+
+//Create the sprites from SPRITE_PATHS, each a span on the startup
+//timeline, and ResetLevel.
+void InitLevel(IDiceInvaders* system, GameState& gameState);
+
+//Hash of everything SimulateGame reads or writes. Equal checksums after
+//the same frames mean two simulations have not diverged.
+uint32_t ChecksumGameState(const GameState& state);
+
+#endif
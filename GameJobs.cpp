@@ -0,0 +1,161 @@
+#include "GameJobs.h"
+#include "LiveState.h"
+#include "Replay.h"
+
+namespace
+{
+    //Moving or animating an object takes nanoseconds, so chunks have to
+    //be big to be worth a thread.
+    const uint32_t OBJECT_GRAIN = 1024;
+}
+
+GameJobs::GameJobs(uint32_t numWorkers) : mPool(numWorkers),
+    mSystem(0),
+    mRecorder(0),
+    mState(0)
+{
+    //In the order GameScreen runs them.
+    mGraph.addJob("UpdateHud", UpdateHudJob, this,
+        COLUMN_SCORE | COLUMN_ROWS | COLUMN_CLOCK, COLUMN_HUD, false);
+    mGraph.addJob("DrawGame", DrawJob, this,
+        COLUMN_OBJECTS | COLUMN_PLAYER | COLUMN_SCORE | COLUMN_HUD, COLUMN_SCREEN, true);
+    mGraph.addJob("Record", RecordJob, this,
+        COLUMN_GAME, COLUMN_RECORDING, false);
+    mGraph.addJob("AlienWall", AlienWallJob, this,
+        COLUMN_ROWS | COLUMN_TYPES | COLUMN_POSITIONS, COLUMN_POSITIONS | COLUMN_VELOCITIES | COLUMN_ARENA, false);
+    mGraph.addParallelJob("Move", MoveJob, CountObjects, this,
+        COLUMN_ROWS | COLUMN_VELOCITIES, COLUMN_POSITIONS, OBJECT_GRAIN);
+    mGraph.addJob("Cull", CullJob, this,
+        COLUMN_OBJECTS, COLUMN_OBJECTS | COLUMN_SCORE | COLUMN_ARENA, false);
+    mGraph.addParallelJob("Animate", AnimateJob, CountObjects, this,
+        COLUMN_ROWS | COLUMN_TYPES | COLUMN_VELOCITIES, COLUMN_POSITIONS, OBJECT_GRAIN);
+    mGraph.addJob("Sprites", SpritesJob, this,
+        COLUMN_TYPES, COLUMN_TYPES, false);
+    mGraph.addJob("Collide", CollideJob, this,
+        COLUMN_OBJECTS | COLUMN_PLAYER, COLUMN_OBJECTS | COLUMN_HITS | COLUMN_ARENA, false);
+    mGraph.addJob("Score", ScoreJob, this,
+        COLUMN_HITS | COLUMN_SCORE, COLUMN_SCORE, false);
+    mGraph.addJob("RandomFire", RandomFireJob, this,
+        COLUMN_OBJECTS | COLUMN_CLOCK | COLUMN_RANDOM, COLUMN_OBJECTS | COLUMN_RANDOM, false);
+    mGraph.addJob("Input", InputJob, this,
+        COLUMN_OBJECTS | COLUMN_PLAYER | COLUMN_KEYS, COLUMN_OBJECTS | COLUMN_PLAYER | COLUMN_KEYS, false);
+    mGraph.addJob("Spawn", SpawnJob, this,
+        COLUMN_OBJECTS, COLUMN_OBJECTS, false);
+    mGraph.addJob("End", EndJob, this,
+        COLUMN_SCORE, COLUMN_OBJECTS | COLUMN_PLAYER | COLUMN_CLOCK, false);
+    mGraph.build();
+}
+
+void GameJobs::runFrame(IDiceInvaders* system,
+                        InputSampler* sampler,
+                        ReplayWriter* recorder,
+                        LiveStateWriter* exporter,
+                        GameState& state)
+{
+    mSystem = system;
+    mRecorder = recorder;
+    mState = &state;
+
+    SampleFrameInput(system, sampler, mInput);
+    BeginSimulation(mFrame, state, mInput);
+
+    mGraph.run(mPool);
+
+    if(exporter)
+    {
+        exporter->publish(state, 0);
+    }
+}
+
+void GameJobs::logSchedule() const
+{
+    mGraph.logSchedule("GameJobs");
+}
+
+void GameJobs::UpdateHudJob(void* context, uint32_t, uint32_t)
+{
+    GameJobs* jobs = static_cast<GameJobs*>(context);
+    UpdateHud(*jobs->mState, jobs->mFrame.mDeltaTime);
+}
+
+void GameJobs::DrawJob(void* context, uint32_t, uint32_t)
+{
+    GameJobs* jobs = static_cast<GameJobs*>(context);
+    GameState& state = *jobs->mState;
+    DrawGame(jobs->mSystem,
+        state.mSprites,
+        state.mWindowWidth,
+        state.mWindowHeight,
+        state.mScene,
+        state.mHud,
+        state.mPlayerLives);
+}
+
+void GameJobs::RecordJob(void* context, uint32_t, uint32_t)
+{
+    GameJobs* jobs = static_cast<GameJobs*>(context);
+    if(jobs->mRecorder)
+    {
+        jobs->mRecorder->record(*jobs->mState, jobs->mInput);
+    }
+}
+
+void GameJobs::AlienWallJob(void* context, uint32_t, uint32_t)
+{
+    AlienWallPhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::MoveJob(void* context, uint32_t begin, uint32_t end)
+{
+    MovePhase(static_cast<GameJobs*>(context)->mFrame, begin, end);
+}
+
+void GameJobs::CullJob(void* context, uint32_t, uint32_t)
+{
+    CullPhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::AnimateJob(void* context, uint32_t begin, uint32_t end)
+{
+    AnimatePhase(static_cast<GameJobs*>(context)->mFrame, begin, end);
+}
+
+void GameJobs::SpritesJob(void* context, uint32_t, uint32_t)
+{
+    SpritePhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::CollideJob(void* context, uint32_t, uint32_t)
+{
+    CollidePhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::ScoreJob(void* context, uint32_t, uint32_t)
+{
+    ScorePhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::RandomFireJob(void* context, uint32_t, uint32_t)
+{
+    RandomFirePhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::InputJob(void* context, uint32_t, uint32_t)
+{
+    InputPhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::SpawnJob(void* context, uint32_t, uint32_t)
+{
+    SpawnPhase(static_cast<GameJobs*>(context)->mFrame);
+}
+
+void GameJobs::EndJob(void* context, uint32_t, uint32_t)
+{
+    EndSimulation(static_cast<GameJobs*>(context)->mFrame);
+}
+
+uint32_t GameJobs::CountObjects(void* context)
+{
+    return NumObjects(static_cast<GameJobs*>(context)->mState->mScene);
+}
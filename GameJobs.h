@@ -0,0 +1,90 @@
+#ifndef GAME_JOBS_H
+#define GAME_JOBS_H
+
+#include "Game.h"
+#include "JobGraph.h"
+#include "ThreadPool.h"
+
+//Columns of a frame for JobGraph. Object columns cover every object after
+//the player; types and velocities are those each table shares. Anything
+//that adds or removes objects writes COLUMN_ROWS and with it every object
+//column, since rows move.
+enum GameColumn
+{
+    COLUMN_ROWS = 1 << 0,//Which objects exist and their order.
+    COLUMN_TYPES = 1 << 1,
+    COLUMN_POSITIONS = 1 << 2,
+    COLUMN_VELOCITIES = 1 << 3,
+    COLUMN_PLAYER = 1 << 4,//Object 0.
+    COLUMN_SCORE = 1 << 5,//Score and lives.
+    COLUMN_CLOCK = 1 << 6,//mLastTime and mFloorLastTime.
+    COLUMN_KEYS = 1 << 7,//Fire state and held keys.
+    COLUMN_RANDOM = 1 << 8,
+    COLUMN_HITS = 1 << 9,//SimulationFrame::mHitCounts.
+    COLUMN_HUD = 1 << 10,
+    COLUMN_SCREEN = 1 << 11,
+    COLUMN_RECORDING = 1 << 12,
+    COLUMN_ARENA = 1 << 13,//GameState::mArena. Taking from it writes it.
+
+    COLUMN_OBJECTS = COLUMN_ROWS | COLUMN_TYPES | COLUMN_POSITIONS | COLUMN_VELOCITIES,
+    COLUMN_GAME = COLUMN_OBJECTS | COLUMN_PLAYER | COLUMN_SCORE | COLUMN_CLOCK | COLUMN_KEYS | COLUMN_RANDOM,
+};
+
+//GameScreen as a JobGraph: the HUD update, drawing, recording and every
+//SimulateGame phase are jobs with the columns they touch, and MovePhase
+//and AnimatePhase split into chunks. The game plays out exactly as with
+//GameScreen.
+//
+//In this game the phases share positions and object rows, so the graph
+//comes out close to a chain. Drawing reads the positions the first phase
+//writes; overlapping them takes the second copy of the state that
+//RunPipelinedGame keeps. logSchedule shows what does overlap.
+class GameJobs
+{
+public:
+    //numWorkers threads help the calling thread, which also draws.
+    explicit GameJobs(uint32_t numWorkers);
+
+    //One frame like GameScreen. The phases overlap, so exporter, if not
+    //null, gets the frame without phase times.
+    void runFrame(IDiceInvaders* system,
+                  InputSampler* sampler,
+                  ReplayWriter* recorder,
+                  LiveStateWriter* exporter,
+                  GameState& state);
+
+    void logSchedule() const;
+
+private:
+    GameJobs(const GameJobs&);
+    GameJobs& operator=(const GameJobs&);
+
+    static void UpdateHudJob(void* context, uint32_t begin, uint32_t end);
+    static void DrawJob(void* context, uint32_t begin, uint32_t end);
+    static void RecordJob(void* context, uint32_t begin, uint32_t end);
+    static void AlienWallJob(void* context, uint32_t begin, uint32_t end);
+    static void MoveJob(void* context, uint32_t begin, uint32_t end);
+    static void CullJob(void* context, uint32_t begin, uint32_t end);
+    static void AnimateJob(void* context, uint32_t begin, uint32_t end);
+    static void SpritesJob(void* context, uint32_t begin, uint32_t end);
+    static void CollideJob(void* context, uint32_t begin, uint32_t end);
+    static void ScoreJob(void* context, uint32_t begin, uint32_t end);
+    static void RandomFireJob(void* context, uint32_t begin, uint32_t end);
+    static void InputJob(void* context, uint32_t begin, uint32_t end);
+    static void SpawnJob(void* context, uint32_t begin, uint32_t end);
+    static void EndJob(void* context, uint32_t begin, uint32_t end);
+    static uint32_t CountObjects(void* context);
+
+private:
+    ThreadPool mPool;
+    JobGraph mGraph;
+
+    //The frame being run.
+    IDiceInvaders* mSystem;
+    ReplayWriter* mRecorder;
+    GameState* mState;
+    FrameInput mInput;
+    SimulationFrame mFrame;
+};
+
+#endif
@@ -0,0 +1,516 @@
+#include "GameServer.h"
+#include "Log.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace
+{
+    //Sessions simulated per parallelFor chunk.
+    const uint32_t SESSION_BATCH = 64;
+
+    //Kernel buffer asked for in each direction. Counted in the budget.
+    const int SOCKET_BUFFER_SIZE = 4096;
+
+    const int MAX_EPOLL_EVENTS = 256;
+
+    //Gives the epoll events for the listen socket and the timer a
+    //non-null tag that no session pointer can have.
+    char gListenTag;
+    char gTimerTag;
+}
+
+struct ServerSession
+{
+    explicit ServerSession(int socket) : mState(SERVER_WINDOW_WIDTH, SERVER_WINDOW_HEIGHT),
+        mSocket(socket),
+        mInputSequence(0),
+        mInputBytes(0),
+        mOutputBytes(0),
+        mOutputSent(0),
+        mGameTicks(0),
+        mGames(0),
+        mDroppedStates(0),
+        mClosed(false)
+    {
+        UnpackKeys(0, mKeys);
+    }
+
+    GameState mState;
+    int mSocket;
+
+    //Written by the event loop between ticks, read by the tick.
+    IDiceInvaders::KeyStatus mKeys;
+    uint32_t mInputSequence;
+    uint8_t mInput[sizeof(InputMessage)];
+    uint32_t mInputBytes;
+
+    //A state the socket only took part of. Finished before the next one.
+    uint8_t mOutput[sizeof(StateMessage)];
+    uint32_t mOutputBytes;
+    uint32_t mOutputSent;
+
+    //Ticks since this game started. Its clock starts at 0 with every game,
+    //so float time stays as fine as a fresh server's however long the
+    //server has been up.
+    uint32_t mGameTicks;
+    uint32_t mGames;
+    uint32_t mDroppedStates;
+    bool mClosed;//Set by the tick, acted on by the event loop.
+};
+
+//Game memory owned by a session. Socket buffers are fixed by setsockopt.
+static uint32_t SessionMemory(const ServerSession& session)
+{
+    return static_cast<uint32_t>(sizeof(ServerSession) +
+        SceneMemory(session.mState.mScene) +
+        session.mState.mArena.getCapacity() +
+        SOCKET_BUFFER_SIZE * 2);
+}
+
+//Send what is left of the pending state. False if the socket is broken.
+static bool FlushOutput(ServerSession& session)
+{
+    while(session.mOutputSent < session.mOutputBytes)
+    {
+        const ssize_t sent = send(session.mSocket,
+            session.mOutput + session.mOutputSent,
+            session.mOutputBytes - session.mOutputSent,
+            MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(sent < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        session.mOutputSent += static_cast<uint32_t>(sent);
+    }
+    return true;
+}
+
+GameServer::GameServer(const ServerConfig& config) : mConfig(config),
+    mPool(config.mNumThreads > 1 ? config.mNumThreads - 1 : 0),
+    mEpoll(-1),
+    mListenSocket(-1),
+    mTimer(-1),
+    mStop(0),
+    mTick(0),
+    mStatsWallTime(0),
+    mStatsCpuTime(0),
+    mStatsTicks(0),
+    mStatsSessionTicks(0),
+    mMissedTicks(0),
+    mDroppedStates(0),
+    mOverBudget(0)
+{
+}
+
+GameServer::~GameServer()
+{
+    for(size_t index = 0; index < mSessions.size(); ++index)
+    {
+        close(mSessions[index]->mSocket);
+        delete mSessions[index];
+    }
+
+    if(mTimer >= 0)
+    {
+        close(mTimer);
+    }
+    if(mListenSocket >= 0)
+    {
+        close(mListenSocket);
+    }
+    if(mEpoll >= 0)
+    {
+        close(mEpoll);
+    }
+}
+
+bool GameServer::init()
+{
+    mEpoll = epoll_create1(0);
+    if(mEpoll < 0)
+    {
+        LogMessage("GameServer: epoll_create1 failed (%s)", std::strerror(errno));
+        return false;
+    }
+
+    mListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(mListenSocket < 0)
+    {
+        LogMessage("GameServer: socket failed (%s)", std::strerror(errno));
+        return false;
+    }
+
+    const int reuse = 1;
+    setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(mConfig.mPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(mListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(mListenSocket, SOMAXCONN) != 0)
+    {
+        LogMessage("GameServer: cannot listen on port %u (%s)", mConfig.mPort, std::strerror(errno));
+        return false;
+    }
+
+    mTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if(mTimer < 0)
+    {
+        LogMessage("GameServer: timerfd_create failed (%s)", std::strerror(errno));
+        return false;
+    }
+
+    if(mConfig.mExportName && !mExport.open(mConfig.mExportName, SERVER_WINDOW_WIDTH, SERVER_WINDOW_HEIGHT))
+    {
+        LogMessage("GameServer: cannot export to shared memory %s (%s)", mConfig.mExportName, std::strerror(errno));
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &gListenTag;
+    epoll_ctl(mEpoll, EPOLL_CTL_ADD, mListenSocket, &event);
+    event.data.ptr = &gTimerTag;
+    epoll_ctl(mEpoll, EPOLL_CTL_ADD, mTimer, &event);
+
+    LogMessage("GameServer: listening on 127.0.0.1:%u, %u threads, %u ticks/s, %u byte session budget",
+        mConfig.mPort, mPool.getNumThreads(), mConfig.mTickRate, mConfig.mSessionBudget);
+    return true;
+}
+
+void GameServer::stop()
+{
+    mStop = 1;
+}
+
+void GameServer::run()
+{
+    const uint64_t period = 1000000000ull / std::max(mConfig.mTickRate, 1u);
+    const uint64_t startTime = GetTimeNanoseconds();
+    uint64_t nextTickTime = startTime + period;
+
+    mStatsWallTime = startTime;
+    mStatsCpuTime = GetProcessCpuNanoseconds();
+
+    //Absolute on the same clock as GetTimeNanoseconds so the lateness of
+    //every tick can be measured against its due time.
+    itimerspec schedule;
+    schedule.it_interval.tv_sec = period / 1000000000ull;
+    schedule.it_interval.tv_nsec = period % 1000000000ull;
+    schedule.it_value.tv_sec = nextTickTime / 1000000000ull;
+    schedule.it_value.tv_nsec = nextTickTime % 1000000000ull;
+    timerfd_settime(mTimer, TFD_TIMER_ABSTIME, &schedule, 0);
+
+    epoll_event events[MAX_EPOLL_EVENTS];
+    while(!mStop)
+    {
+        const int count = epoll_wait(mEpoll, events, MAX_EPOLL_EVENTS, 1000);
+        if(count < 0 && errno != EINTR)
+        {
+            LogMessage("GameServer: epoll_wait failed (%s)", std::strerror(errno));
+            break;
+        }
+
+        //Sessions the tick closes are still in the epoll set, and may have
+        //events further down this batch, so none is freed until the batch
+        //is done.
+        bool bTicked = false;
+        for(int index = 0; index < count; ++index)
+        {
+            void* tag = events[index].data.ptr;
+            if(tag == &gListenTag)
+            {
+                acceptSessions();
+            }
+            else if(tag == &gTimerTag)
+            {
+                uint64_t expirations = 0;
+                if(read(mTimer, &expirations, sizeof(expirations)) != sizeof(expirations))
+                {
+                    continue;
+                }
+
+                //Ticks that were due while the last one ran are skipped,
+                //not run back to back.
+                mMissedTicks += static_cast<uint32_t>(expirations - 1);
+                nextTickTime += period * expirations;
+
+                tick();
+                mTickTimes.push_back(GetTimeNanoseconds() - (nextTickTime - period));
+                bTicked = true;
+            }
+            else
+            {
+                ServerSession& session = *static_cast<ServerSession*>(tag);
+                if(events[index].events & (EPOLLHUP | EPOLLERR))
+                {
+                    session.mClosed = true;
+                }
+                else
+                {
+                    readInput(session);
+                }
+
+                //Stop polling now. The session is freed after the next tick.
+                if(session.mClosed)
+                {
+                    epoll_ctl(mEpoll, EPOLL_CTL_DEL, session.mSocket, 0);
+                }
+            }
+        }
+
+        if(bTicked)
+        {
+            closeSessions();
+        }
+
+        const uint64_t now = GetTimeNanoseconds();
+        if(now - mStatsWallTime >= 1000000000ull)
+        {
+            logStats();
+        }
+
+        if(mConfig.mSeconds && now - startTime >= mConfig.mSeconds * 1000000000ull)
+        {
+            break;
+        }
+    }
+
+    logStats();
+}
+
+void GameServer::acceptSessions()
+{
+    for(;;)
+    {
+        const int socket = accept4(mListenSocket, 0, 0, SOCK_NONBLOCK);
+        if(socket < 0)
+        {
+            return;
+        }
+
+        if(mSessions.size() >= mConfig.mMaxSessions)
+        {
+            close(socket);
+            continue;
+        }
+
+        const int noDelay = 1;
+        const int bufferSize = SOCKET_BUFFER_SIZE;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+        setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+        ServerSession* session = new ServerSession(socket);
+        ResetLevel(session->mState, 0.0f);
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = session;
+        epoll_ctl(mEpoll, EPOLL_CTL_ADD, socket, &event);
+
+        mSessions.push_back(session);
+    }
+}
+
+void GameServer::readInput(ServerSession& session)
+{
+    for(;;)
+    {
+        const ssize_t received = recv(session.mSocket,
+            session.mInput + session.mInputBytes,
+            sizeof(session.mInput) - session.mInputBytes,
+            MSG_DONTWAIT);
+        if(received <= 0)
+        {
+            //0 is an orderly shutdown by the client.
+            if(received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                session.mClosed = true;
+            }
+            return;
+        }
+
+        session.mInputBytes += static_cast<uint32_t>(received);
+        if(session.mInputBytes == sizeof(InputMessage))
+        {
+            InputMessage message;
+            std::memcpy(&message, session.mInput, sizeof(message));
+            UnpackKeys(message.mKeys, session.mKeys);
+            session.mInputSequence = message.mSequence;
+            session.mInputBytes = 0;
+        }
+    }
+}
+
+void GameServer::TickSessions(void* context, uint32_t begin, uint32_t end)
+{
+    GameServer& server = *static_cast<GameServer*>(context);
+    const float tickRate = static_cast<float>(server.mConfig.mTickRate);
+
+    for(uint32_t index = begin; index < end; ++index)
+    {
+        ServerSession& session = *server.mSessions[index];
+        if(session.mClosed)
+        {
+            continue;
+        }
+
+        session.mGameTicks++;
+        FrameInput input;
+        input.mTime = session.mGameTicks / tickRate;
+        input.mKeys = session.mKeys;
+        input.mTimestamped = false;
+        input.mNumEvents = 0;
+        if(index == 0 && server.mExport.isOpen())
+        {
+            uint32_t phaseTimes[NUM_SIMULATION_PHASES];
+            SimulateGame(session.mState, input, 0, phaseTimes);
+            server.mExport.publish(session.mState, phaseTimes);
+        }
+        else
+        {
+            SimulateGame(session.mState, input);
+        }
+
+        if(!session.mState.mPlayerLives)
+        {
+            session.mGames++;
+            session.mGameTicks = 0;
+            ResetLevel(session.mState, 0.0f);
+        }
+
+        if(SessionMemory(session) > server.mConfig.mSessionBudget)
+        {
+            session.mClosed = true;
+            continue;
+        }
+
+        if(!FlushOutput(session))
+        {
+            session.mClosed = true;
+            continue;
+        }
+
+        //The client is not keeping up. It gets the next state instead.
+        if(session.mOutputSent < session.mOutputBytes)
+        {
+            session.mDroppedStates++;
+            continue;
+        }
+
+        StateMessage message;
+        message.mTick = server.mTick;
+        message.mInputSequence = session.mInputSequence;
+        message.mScore = session.mState.mPlayerScore;
+        message.mNumObjects = static_cast<uint16_t>(std::min<uint32_t>(NumObjects(session.mState.mScene), 0xffff));
+        message.mLives = static_cast<uint8_t>(session.mState.mPlayerLives);
+        message.mGames = static_cast<uint8_t>(session.mGames);
+
+        std::memcpy(session.mOutput, &message, sizeof(message));
+        session.mOutputBytes = sizeof(message);
+        session.mOutputSent = 0;
+        if(!FlushOutput(session))
+        {
+            session.mClosed = true;
+        }
+    }
+}
+
+void GameServer::tick()
+{
+    mTick++;
+
+    const uint32_t numSessions = static_cast<uint32_t>(mSessions.size());
+    mPool.parallelFor(numSessions, SESSION_BATCH, TickSessions, this);
+
+    mStatsTicks++;
+    mStatsSessionTicks += numSessions;
+}
+
+void GameServer::closeSessions()
+{
+    for(size_t index = 0; index < mSessions.size(); )
+    {
+        ServerSession* session = mSessions[index];
+        mDroppedStates += session->mDroppedStates;
+        session->mDroppedStates = 0;
+
+        if(!session->mClosed)
+        {
+            ++index;
+            continue;
+        }
+
+        if(SessionMemory(*session) > mConfig.mSessionBudget)
+        {
+            mOverBudget++;
+        }
+
+        //Closing the socket also removes it from the epoll set.
+        close(session->mSocket);
+        delete session;
+
+        //Order does not matter, so fill the hole from the back.
+        mSessions[index] = mSessions.back();
+        mSessions.pop_back();
+    }
+}
+
+void GameServer::logStats()
+{
+    const uint64_t now = GetTimeNanoseconds();
+    const uint64_t cpuTime = GetProcessCpuNanoseconds();
+    const uint64_t wallTime = now - mStatsWallTime;
+
+    uint64_t memory = 0;
+    for(size_t index = 0; index < mSessions.size(); ++index)
+    {
+        memory += SessionMemory(*mSessions[index]);
+    }
+
+    std::sort(mTickTimes.begin(), mTickTimes.end());
+    const size_t last = mTickTimes.empty() ? 0 : mTickTimes.size() - 1;
+    const double p50 = mTickTimes.empty() ? 0.0 : NanosecondsToMilliseconds(mTickTimes[last / 2]);
+    const double p99 = mTickTimes.empty() ? 0.0 : NanosecondsToMilliseconds(mTickTimes[last * 99 / 100]);
+    const double worst = mTickTimes.empty() ? 0.0 : NanosecondsToMilliseconds(mTickTimes[last]);
+
+    //CPU per session tick tells how many sessions one core could keep at
+    //the tick rate.
+    const uint64_t cpuUsed = cpuTime - mStatsCpuTime;
+    const double sessionsPerCore = cpuUsed && mStatsSessionTicks ?
+        1000000000.0 / (static_cast<double>(cpuUsed) / mStatsSessionTicks) / mConfig.mTickRate : 0.0;
+
+    LogMessage("GameServer: %u sessions, %u ticks, tick latency p50 %.3f p99 %.3f max %.3f ms, "
+        "%u missed, %u states dropped, %u over budget, %u bytes/session, %.1f%% CPU, %.0f sessions/core",
+        static_cast<uint32_t>(mSessions.size()),
+        mStatsTicks,
+        p50, p99, worst,
+        mMissedTicks,
+        mDroppedStates,
+        mOverBudget,
+        mSessions.empty() ? 0 : static_cast<uint32_t>(memory / mSessions.size()),
+        wallTime ? cpuUsed * 100.0 / wallTime : 0.0,
+        sessionsPerCore);
+
+    mTickTimes.clear();
+    mStatsWallTime = now;
+    mStatsCpuTime = cpuTime;
+    mStatsTicks = 0;
+    mStatsSessionTicks = 0;
+    mMissedTicks = 0;
+    mDroppedStates = 0;
+    mOverBudget = 0;
+}
@@ -0,0 +1,95 @@
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+#include <vector>
+#include "Game.h"
+#include "LiveState.h"
+#include "ServerProtocol.h"
+#include "ThreadPool.h"
+
+struct ServerConfig
+{
+    ServerConfig() : mPort(SERVER_DEFAULT_PORT),
+        mNumThreads(1),
+        mTickRate(60),
+        mSessionBudget(32 * 1024),
+        mMaxSessions(16384),
+        mSeconds(0),
+        mExportName(0)
+    {
+    }
+
+    uint16_t mPort;
+    uint32_t mNumThreads;//Workers plus the event loop thread.
+    uint32_t mTickRate;//Ticks per second.
+    uint32_t mSessionBudget;//Bytes of game and socket memory per session.
+    uint32_t mMaxSessions;
+    uint32_t mSeconds;//Run time, 0 runs until stop().
+    const char* mExportName;//Shared memory for LiveStateWriter, or null.
+};
+
+struct ServerSession;
+
+//Hosts many games on one Linux box. Clients connect over TCP and each
+//connection gets its own GameState. One thread runs an epoll loop that
+//accepts connections, reads input and wakes up for ticks from a timerfd.
+//Every tick the sessions are simulated in batches on a ThreadPool, each
+//session with SimulateGame and the keys its client last sent, and every
+//client is sent a StateMessage. Nothing is drawn.
+//
+//A session is closed when its game state and socket buffers grow past
+//mSessionBudget. Finished games restart straight away. Each game counts
+//its time from its own first tick, not from server start. Tick timing, CPU
+//use and the sessions one core could sustain are logged every second.
+//
+//With mExportName the first session in the table is published every
+//tick, with its phase times, for LiveReader. When it closes the one
+//that takes its place is published instead.
+class GameServer
+{
+public:
+    explicit GameServer(const ServerConfig& config);
+    ~GameServer();
+
+    bool init();
+    void run();
+
+    //Safe to call from a signal handler.
+    void stop();
+
+private:
+    GameServer(const GameServer&);
+    GameServer& operator=(const GameServer&);
+
+    static void TickSessions(void* context, uint32_t begin, uint32_t end);
+
+    void acceptSessions();
+    void readInput(ServerSession& session);
+    void tick();
+    void closeSessions();
+    void logStats();
+
+private:
+    const ServerConfig mConfig;
+    ThreadPool mPool;
+    LiveStateWriter mExport;
+    int mEpoll;
+    int mListenSocket;
+    int mTimer;
+    volatile int mStop;
+
+    std::vector<ServerSession*> mSessions;
+    uint32_t mTick;
+
+    //Per second statistics.
+    std::vector<uint64_t> mTickTimes;//Nanoseconds from due to sent.
+    uint64_t mStatsWallTime;
+    uint64_t mStatsCpuTime;
+    uint32_t mStatsTicks;
+    uint64_t mStatsSessionTicks;
+    uint32_t mMissedTicks;
+    uint32_t mDroppedStates;
+    uint32_t mOverBudget;
+};
+
+#endif
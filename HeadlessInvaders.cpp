@@ -0,0 +1,175 @@
+#include "HeadlessInvaders.h"
+#include "Latency.h"
+#include "Timer.h"
+#include <cassert>
+
+class HeadlessSprite : public ISprite
+{
+public:
+    explicit HeadlessSprite(HeadlessInvaders& system) : mSystem(system)
+    {
+    }
+
+    virtual void destroy()
+    {
+        delete this;
+    }
+
+    virtual void draw(int x, int y)
+    {
+        mSystem.mDraws++;
+    }
+
+private:
+    //Only destroy() deletes a sprite. Private so nothing derives from it,
+    //virtual as ISprite's destructor is not.
+    virtual ~HeadlessSprite()
+    {
+    }
+
+    HeadlessSprite(const HeadlessSprite&);
+    HeadlessSprite& operator=(const HeadlessSprite&);
+
+private:
+    HeadlessInvaders& mSystem;
+};
+
+HeadlessInvaders::HeadlessInvaders(float framesPerSecond, uint32_t maxFrames) : mStartTime(0),
+    mFrameInterval(framesPerSecond > 0.0f ? static_cast<uint64_t>(1000000000.0 / framesPerSecond) : 0),
+    mbSteppedClock(false),
+    mNextFrameTime(0),
+    mFrame(0),
+    mMaxFrames(maxFrames),
+    mDraws(0),
+    mNextKeyChange(0)
+{
+    mKeys.fire = false;
+    mKeys.left = false;
+    mKeys.right = false;
+}
+
+void HeadlessInvaders::injectKeys(float time, const KeyStatus& keys)
+{
+    ScopedLock lock(mKeyLock);
+    assert(mKeyChanges.empty() || mKeyChanges.back().mTime <= time);
+
+    KeyChange change;
+    change.mTime = time;
+    change.mKeys = keys;
+    mKeyChanges.push_back(change);
+}
+
+void HeadlessInvaders::injectRandomKeys(uint32_t seed, uint32_t count, float time, float interval)
+{
+    //Own generator so the script does not depend on the game.
+    uint32_t random = seed;
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        random = random * 1664525u + 1013904223u;
+        const uint32_t bits = random >> 24;
+
+        KeyStatus keys;
+        keys.fire = (bits & 1) != 0;
+        keys.left = (bits & 2) != 0;
+        keys.right = !keys.left && (bits & 4) != 0;
+        injectKeys(time, keys);
+
+        time += interval * (0.5f + (bits >> 3) / 31.0f);
+    }
+}
+
+void HeadlessInvaders::useSteppedClock()
+{
+    assert(mFrameInterval);
+    mbSteppedClock = true;
+}
+
+HeadlessInvaders::~HeadlessInvaders()
+{
+}
+
+uint32_t HeadlessInvaders::getFrameCount() const
+{
+    return mFrame;
+}
+
+uint64_t HeadlessInvaders::getDrawCount() const
+{
+    return mDraws;
+}
+
+void HeadlessInvaders::destroy()
+{
+    delete this;
+}
+
+bool HeadlessInvaders::init(int width, int height)
+{
+    mStartTime = GetTimeNanoseconds();
+    mNextFrameTime = mStartTime + mFrameInterval;
+    return true;
+}
+
+bool HeadlessInvaders::update()
+{
+    mFrame++;
+
+    if(mFrameInterval && !mbSteppedClock)
+    {
+        const uint64_t now = GetTimeNanoseconds();
+        if(now < mNextFrameTime)
+        {
+            ThreadSleep(static_cast<uint32_t>((mNextFrameTime - now) / 1000));
+            mNextFrameTime += mFrameInterval;
+        }
+        else
+        {
+            //Missed the frame. Like vsync, wait for the next boundary.
+            mNextFrameTime += ((now - mNextFrameTime) / mFrameInterval + 1) * mFrameInterval;
+        }
+    }
+
+    return mFrame < mMaxFrames;
+}
+
+ISprite* HeadlessInvaders::createSprite(const char* name)
+{
+    return new HeadlessSprite(*this);
+}
+
+void HeadlessInvaders::drawText(int x, int y, const char* msg)
+{
+    mDraws++;
+}
+
+float HeadlessInvaders::getElapsedTime()
+{
+    if(mbSteppedClock)
+    {
+        return static_cast<float>(mFrame * mFrameInterval / 1000000000.0);
+    }
+    return static_cast<float>((GetTimeNanoseconds() - mStartTime) / 1000000000.0);
+}
+
+void HeadlessInvaders::getKeyStatus(KeyStatus& keys)
+{
+    const float now = getElapsedTime();
+
+    ScopedLock lock(mKeyLock);
+    while(mNextKeyChange < mKeyChanges.size() && mKeyChanges[mNextKeyChange].mTime <= now)
+    {
+        const KeyChange& change = mKeyChanges[mNextKeyChange++];
+        const bool firePressed = change.mKeys.fire && !mKeys.fire;
+
+        //A script line can repeat the keys already held. That is no change.
+        if(change.mKeys.fire != mKeys.fire ||
+            change.mKeys.left != mKeys.left || change.mKeys.right != mKeys.right)
+        {
+            const uint64_t changeTime = mStartTime + static_cast<uint64_t>(change.mTime * 1000000000.0);
+            LatencyKeyChanged(changeTime, firePressed);
+        }
+        mKeys = change.mKeys;
+    }
+
+    keys = mKeys;
+}
@@ -0,0 +1,77 @@
+#ifndef HEADLESS_INVADERS_H
+#define HEADLESS_INVADERS_H
+
+#include <vector>
+#include "DiceInvaders.h"
+#include "Threading.h"
+#include "pstdint.h"
+
+//IDiceInvaders without a window for automated runs on any platform.
+//Sprites and text are counted and dropped. Time is the real clock and
+//update() waits for the next frame boundary the way vsync would, unless
+//the clock is stepped. Keys come from a script of timed changes instead
+//of the keyboard, and each change is reported to the latency tracker at
+//its scripted time.
+class HeadlessInvaders : public IDiceInvaders
+{
+public:
+    //framesPerSecond 0 runs frames back to back. update() returns false
+    //once maxFrames frames have been submitted.
+    HeadlessInvaders(float framesPerSecond, uint32_t maxFrames);
+
+    //Queue a change to keys at time seconds after init. Changes must be
+    //queued in time order.
+    void injectKeys(float time, const KeyStatus& keys);
+
+    //Queue count pseudo random key changes starting at time, spaced
+    //between 0.5 and 1.5 times interval seconds apart.
+    void injectRandomKeys(uint32_t seed, uint32_t count, float time, float interval);
+
+    //Time advances exactly one frame interval per update() instead of
+    //following the real clock, and update() stops waiting. The game sees
+    //framesPerSecond however fast the machine runs it. Call before init.
+    void useSteppedClock();
+
+    uint32_t getFrameCount() const;
+    uint64_t getDrawCount() const;
+
+    virtual void destroy();
+    virtual bool init(int width, int height);
+    virtual bool update();
+    virtual ISprite* createSprite(const char* name);
+    virtual void drawText(int x, int y, const char* msg);
+    virtual float getElapsedTime();
+    virtual void getKeyStatus(KeyStatus& keys);
+
+private:
+    //Only destroy() deletes it. Private so nothing derives from it,
+    //virtual as IDiceInvaders' destructor is not.
+    virtual ~HeadlessInvaders();
+
+    HeadlessInvaders(const HeadlessInvaders&);
+    HeadlessInvaders& operator=(const HeadlessInvaders&);
+
+    friend class HeadlessSprite;
+
+private:
+    struct KeyChange
+    {
+        float mTime;
+        KeyStatus mKeys;
+    };
+
+    uint64_t mStartTime;
+    uint64_t mFrameInterval;//Nanoseconds, 0 when unpaced.
+    bool mbSteppedClock;
+    uint64_t mNextFrameTime;
+    uint32_t mFrame;
+    uint32_t mMaxFrames;
+    uint64_t mDraws;
+
+    Mutex mKeyLock;//getKeyStatus may run on the input thread.
+    std::vector<KeyChange> mKeyChanges;
+    size_t mNextKeyChange;
+    KeyStatus mKeys;
+};
+
+#endif
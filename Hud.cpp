@@ -0,0 +1,132 @@
+#include "Hud.h"
+#include <cassert>
+#include <cstring>
+
+//Copy a literal and return the position after it.
+static char* AppendString(char* buffer, const char* text)
+{
+    const size_t length = std::strlen(text);
+    std::memcpy(buffer, text, length + 1);
+    return buffer + length;
+}
+
+uint32_t FormatInt(int32_t value, char* buffer)
+{
+    char digits[10];
+    uint32_t numDigits = 0;
+
+    //Work with the magnitude as unsigned so INT_MIN does not overflow.
+    uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    do
+    {
+        digits[numDigits++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude);
+
+    uint32_t length = 0;
+    if(value < 0)
+    {
+        buffer[length++] = '-';
+    }
+    while(numDigits)
+    {
+        buffer[length++] = digits[--numDigits];
+    }
+    buffer[length] = 0;
+    return length;
+}
+
+uint32_t FormatFixed(float value, uint32_t decimals, char* buffer)
+{
+    assert(decimals <= 6);
+
+    uint32_t scale = 1;
+    for(uint32_t i = 0; i < decimals; ++i)
+    {
+        scale *= 10;
+    }
+
+    uint32_t length = 0;
+    if(value < 0)
+    {
+        buffer[length++] = '-';
+        value = -value;
+    }
+
+    //Round once in fixed point so 0.99996 becomes 1.0000 not 0.10000.
+    const double scaled = static_cast<double>(value) * scale + 0.5;
+    const uint32_t whole = static_cast<uint32_t>(scaled / scale);
+    uint32_t fraction = static_cast<uint32_t>(scaled - static_cast<double>(whole) * scale);
+
+    length += FormatInt(static_cast<int32_t>(whole), buffer + length);
+    if(decimals)
+    {
+        buffer[length++] = '.';
+        for(uint32_t i = decimals; i > 0; --i)
+        {
+            buffer[length + i - 1] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        length += decimals;
+        buffer[length] = 0;
+    }
+    return length;
+}
+
+HudText::HudText() : mScore(-1),
+    mFinalScore(-1),
+    mAccumTime(0),
+    mFrames(0),
+    mAvgFrameTime(0),
+    mStatsObjects(0),
+    mStatsFrameTime(-1)
+{
+    mScoreText[0] = 0;
+    mFinalScoreText[0] = 0;
+    mStatsText[0] = 0;
+}
+
+void UpdateScoreText(HudText& hud, int score)
+{
+    if(score != hud.mScore)
+    {
+        FormatInt(score, AppendString(hud.mScoreText, "Score: "));
+        hud.mScore = score;
+    }
+}
+
+void UpdateFinalScoreText(HudText& hud, int score)
+{
+    if(score != hud.mFinalScore)
+    {
+        FormatInt(score, AppendString(hud.mFinalScoreText, "Final score is "));
+        hud.mFinalScore = score;
+    }
+}
+
+void UpdateStatsText(HudText& hud,
+                     uint32_t numObjects,
+                     float deltaTimeInSecs)
+{
+    if(hud.mAccumTime > 1)//Reset approx each second
+    {
+        hud.mAvgFrameTime = hud.mAccumTime/hud.mFrames;
+        hud.mAccumTime = 0;
+        hud.mFrames = 0;
+    }
+
+    hud.mFrames++;
+    hud.mAccumTime += deltaTimeInSecs;
+
+    if(numObjects != hud.mStatsObjects || hud.mAvgFrameTime != hud.mStatsFrameTime)
+    {
+        char* text = hud.mStatsText;
+        text += FormatInt(static_cast<int32_t>(numObjects), text);
+        text = AppendString(text, " objects; ");
+        text += FormatFixed(hud.mAvgFrameTime * 1000.0f, 4, text);
+        AppendString(text, " ms");
+
+        hud.mStatsObjects = numObjects;
+        hud.mStatsFrameTime = hud.mAvgFrameTime;
+    }
+}
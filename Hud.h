@@ -0,0 +1,47 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include "pstdint.h"
+
+//Longest string any HUD line can hold, including the terminator.
+const int MAX_HUD_TEXT = 48;
+
+//Write value in decimal followed by a terminator. buffer needs room for
+//12 characters. Returns the number of characters written.
+uint32_t FormatInt(int32_t value, char* buffer);
+
+//Write value rounded to the given number of decimals (at most 6). Returns
+//the number of characters written.
+uint32_t FormatFixed(float value, uint32_t decimals, char* buffer);
+
+//Text drawn by the HUD. Each string is only reformatted when the value it
+//shows changes, so a steady HUD costs nothing per frame and the renderer
+//sees the same string pointer and contents every frame.
+struct HudText
+{
+    HudText();
+
+    int mScore;//Value shown by mScoreText.
+    char mScoreText[MAX_HUD_TEXT];
+
+    int mFinalScore;
+    char mFinalScoreText[MAX_HUD_TEXT];
+
+    //Average milliseconds per frame over a 1 second period.
+    float mAccumTime;
+    int mFrames;
+    float mAvgFrameTime;
+    uint32_t mStatsObjects;
+    float mStatsFrameTime;
+    char mStatsText[MAX_HUD_TEXT];
+};
+
+void UpdateScoreText(HudText& hud, int score);
+
+void UpdateFinalScoreText(HudText& hud, int score);
+
+void UpdateStatsText(HudText& hud,
+                     uint32_t numObjects,
+                     float deltaTimeInSecs);
+
+#endif
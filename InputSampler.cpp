@@ -0,0 +1,113 @@
+#include "InputSampler.h"
+#include "Timer.h"
+#include <algorithm>
+
+static bool KeysEqual(const IDiceInvaders::KeyStatus& a,
+                      const IDiceInvaders::KeyStatus& b)
+{
+    return a.fire == b.fire && a.left == b.left && a.right == b.right;
+}
+
+InputSampler::InputSampler(IDiceInvaders* system) : mSystem(system),
+    mIntervalMicros(1000000 / DEFAULT_INPUT_RATE),
+    mQuit(0),
+    mRunning(false)
+{
+    mCollectedKeys.fire = false;
+    mCollectedKeys.left = false;
+    mCollectedKeys.right = false;
+}
+
+InputSampler::~InputSampler()
+{
+    stop();
+}
+
+bool InputSampler::start(uint32_t samplesPerSecond)
+{
+    mIntervalMicros = 1000000 / std::max(samplesPerSecond, 1u);
+    AtomicStore(&mQuit, 0);
+    mRunning = mThread.start(SamplerThread, this);
+    return mRunning;
+}
+
+void InputSampler::stop()
+{
+    if(mRunning)
+    {
+        AtomicStore(&mQuit, 1);
+        mThread.join();
+        mRunning = false;
+    }
+}
+
+void InputSampler::collectEvents(FrameInput& input)
+{
+    while(input.mNumEvents < MAX_FRAME_INPUT_EVENTS)
+    {
+        const InputEvent* event = mEvents.front();
+        if(!event || event->mTime > input.mTime)
+        {
+            break;
+        }
+
+        input.mEvents[input.mNumEvents++] = *event;
+        mCollectedKeys = event->mKeys;
+        mEvents.pop();
+    }
+
+    input.mKeys = mCollectedKeys;
+}
+
+void InputSampler::SamplerThread(void* context)
+{
+    static_cast<InputSampler*>(context)->run();
+}
+
+void InputSampler::run()
+{
+    BeginHighResolutionSleep();
+
+    const uint64_t interval = static_cast<uint64_t>(mIntervalMicros) * 1000;
+    uint64_t nextSampleTime = GetTimeNanoseconds();
+
+    IDiceInvaders::KeyStatus lastKeys;
+    lastKeys.fire = false;
+    lastKeys.left = false;
+    lastKeys.right = false;
+
+    while(!AtomicLoad(&mQuit))
+    {
+        IDiceInvaders::KeyStatus keys;
+        mSystem->getKeyStatus(keys);
+
+        if(!KeysEqual(keys, lastKeys))
+        {
+            //Keep lastKeys when the queue is full so the change is seen
+            //again on the next sample rather than lost.
+            InputEvent* event = mEvents.beginPush();
+            if(event)
+            {
+                event->mTime = mSystem->getElapsedTime();
+                event->mKeys = keys;
+                mEvents.endPush();
+                lastKeys = keys;
+            }
+        }
+
+        //Fixed rate from the first sample. When a sleep overshoots the
+        //schedule restarts from now rather than sampling in a burst.
+        nextSampleTime += interval;
+        const uint64_t now = GetTimeNanoseconds();
+        if(nextSampleTime > now)
+        {
+            ThreadSleep(static_cast<uint32_t>((nextSampleTime - now) / 1000));
+        }
+        else
+        {
+            nextSampleTime = now;
+        }
+    }
+
+    EndHighResolutionSleep();
+}
@@ -0,0 +1,49 @@
+#ifndef INPUT_SAMPLER_H
+#define INPUT_SAMPLER_H
+
+#include "Game.h"
+#include "SpscQueue.h"
+#include "Threading.h"
+
+const uint32_t DEFAULT_INPUT_RATE = 1000;//Samples per second.
+
+//Polls the keys on its own thread at a fixed rate, independent of the
+//frame rate, and queues each change with the time it was seen. The
+//backend's getKeyStatus and getElapsedTime are called from that thread so
+//they must not depend on the window thread. The software backend reads
+//GetAsyncKeyState and the performance counter which are both safe.
+class InputSampler
+{
+public:
+    explicit InputSampler(IDiceInvaders* system);
+    ~InputSampler();
+
+    bool start(uint32_t samplesPerSecond);
+    void stop();
+
+    //Consumer: move the events up to input.mTime into input and set
+    //input.mKeys to the keys held at that time. Later events, and any
+    //beyond MAX_FRAME_INPUT_EVENTS, stay queued for the next frame.
+    void collectEvents(FrameInput& input);
+
+private:
+    InputSampler(const InputSampler&);
+    InputSampler& operator=(const InputSampler&);
+
+    static void SamplerThread(void* context);
+    void run();
+
+private:
+    IDiceInvaders* mSystem;
+    Thread mThread;
+    uint32_t mIntervalMicros;
+    volatile int32_t mQuit;
+    bool mRunning;
+    IDiceInvaders::KeyStatus mCollectedKeys;//Consumer side only.
+
+    //Enough for a quarter of a second of changes at 1kHz. If the consumer
+    //falls further behind the change is pushed on a later sample instead.
+    SpscQueue<InputEvent, 256> mEvents;
+};
+
+#endif
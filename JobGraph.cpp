@@ -0,0 +1,172 @@
+#include "JobGraph.h"
+#include "Log.h"
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+JobGraph::JobGraph()
+{
+}
+
+void JobGraph::addJob(const char* name,
+                      JobFunc func,
+                      void* context,
+                      ColumnSet reads,
+                      ColumnSet writes,
+                      bool bCallingThread)
+{
+    Job job;
+    job.mName = name;
+    job.mFunc = func;
+    job.mCountFunc = 0;
+    job.mContext = context;
+    job.mReads = reads;
+    job.mWrites = writes;
+    job.mGrainSize = 1;
+    job.mCallingThread = bCallingThread;
+    job.mWave = 0;
+    mJobs.push_back(job);
+}
+
+void JobGraph::addParallelJob(const char* name,
+                              JobFunc func,
+                              JobCountFunc countFunc,
+                              void* context,
+                              ColumnSet reads,
+                              ColumnSet writes,
+                              uint32_t grainSize)
+{
+    Job job;
+    job.mName = name;
+    job.mFunc = func;
+    job.mCountFunc = countFunc;
+    job.mContext = context;
+    job.mReads = reads;
+    job.mWrites = writes;
+    job.mGrainSize = std::max(grainSize, 1u);
+    job.mCallingThread = false;
+    job.mWave = 0;
+    mJobs.push_back(job);
+}
+
+void JobGraph::build()
+{
+    uint32_t numWaves = 0;
+    for(size_t index = 0; index < mJobs.size(); ++index)
+    {
+        Job& job = mJobs[index];
+        job.mWave = 0;
+        for(size_t earlier = 0; earlier < index; ++earlier)
+        {
+            const Job& other = mJobs[earlier];
+            if((other.mWrites & (job.mReads | job.mWrites)) || (other.mReads & job.mWrites))
+            {
+                job.mWave = std::max(job.mWave, other.mWave + 1);
+            }
+        }
+        numWaves = std::max(numWaves, job.mWave + 1);
+    }
+
+    mOrder.clear();
+    mWaveStarts.clear();
+    for(uint32_t wave = 0; wave < numWaves; ++wave)
+    {
+        mWaveStarts.push_back(static_cast<uint32_t>(mOrder.size()));
+        for(size_t index = 0; index < mJobs.size(); ++index)
+        {
+            if(mJobs[index].mWave == wave)
+            {
+                mOrder.push_back(static_cast<uint32_t>(index));
+            }
+        }
+    }
+    mWaveStarts.push_back(static_cast<uint32_t>(mOrder.size()));
+}
+
+void JobGraph::run(ThreadPool& pool)
+{
+    assert(!mWaveStarts.empty() || mJobs.empty());
+
+    for(size_t wave = 0; wave + 1 < mWaveStarts.size(); ++wave)
+    {
+        //Split the wave into chunks for the pool. Jobs for the calling
+        //thread are left out and run while the workers get on with the rest.
+        mChunks.clear();
+        for(uint32_t order = mWaveStarts[wave]; order < mWaveStarts[wave + 1]; ++order)
+        {
+            const Job& job = mJobs[mOrder[order]];
+            if(job.mCallingThread)
+            {
+                continue;
+            }
+
+            Chunk chunk;
+            chunk.mJob = mOrder[order];
+            if(!job.mCountFunc)
+            {
+                chunk.mBegin = 0;
+                chunk.mEnd = 1;
+                mChunks.push_back(chunk);
+                continue;
+            }
+
+            const uint32_t count = job.mCountFunc(job.mContext);
+            for(uint32_t begin = 0; begin < count; begin += job.mGrainSize)
+            {
+                chunk.mBegin = begin;
+                chunk.mEnd = std::min(begin + job.mGrainSize, count);
+                mChunks.push_back(chunk);
+            }
+        }
+
+        pool.beginParallelFor(static_cast<uint32_t>(mChunks.size()), 1, RunChunks, this);
+
+        for(uint32_t order = mWaveStarts[wave]; order < mWaveStarts[wave + 1]; ++order)
+        {
+            const Job& job = mJobs[mOrder[order]];
+            if(job.mCallingThread)
+            {
+                job.mFunc(job.mContext, 0, 1);
+            }
+        }
+
+        pool.endParallelFor();
+    }
+}
+
+void JobGraph::logSchedule(const char* name) const
+{
+    for(size_t wave = 0; wave + 1 < mWaveStarts.size(); ++wave)
+    {
+        std::string jobs;
+        for(uint32_t order = mWaveStarts[wave]; order < mWaveStarts[wave + 1]; ++order)
+        {
+            const Job& job = mJobs[mOrder[order]];
+            if(!jobs.empty())
+            {
+                jobs += ", ";
+            }
+            jobs += job.mName;
+            if(job.mCountFunc)
+            {
+                jobs += " (parallel)";
+            }
+            else if(job.mCallingThread)
+            {
+                jobs += " (calling thread)";
+            }
+        }
+        LogMessage("%s: wave %u: %s", name, static_cast<uint32_t>(wave), jobs.c_str());
+    }
+}
+
+void JobGraph::RunChunks(void* context, uint32_t begin, uint32_t end)
+{
+    JobGraph* graph = static_cast<JobGraph*>(context);
+    for(uint32_t index = begin; index < end; ++index)
+    {
+        const Chunk& chunk = graph->mChunks[index];
+        const Job& job = graph->mJobs[chunk.mJob];
+        job.mFunc(job.mContext, chunk.mBegin, chunk.mEnd);
+    }
+}
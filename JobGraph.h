@@ -0,0 +1,94 @@
+#ifndef JOB_GRAPH_H
+#define JOB_GRAPH_H
+
+#include <vector>
+#include "pstdint.h"
+#include "ThreadPool.h"
+
+//One bit per column of data a job reads or writes. What a column is is up
+//to whoever declares the jobs, see GameColumn.
+typedef uint32_t ColumnSet;
+
+//Called with a half open range [begin, end) of the job's items. Jobs added
+//with addJob have the single item 0.
+typedef void (*JobFunc)(void* context, uint32_t begin, uint32_t end);
+
+//Number of items of a parallel job, asked when the job is about to run.
+typedef uint32_t (*JobCountFunc)(void* context);
+
+//Jobs declared in the order they would run on one thread, each with the
+//columns it reads and writes. build() works out which jobs depend on
+//which and groups them into waves of jobs that do not conflict, so run()
+//can start every job of a wave at once on a ThreadPool. The result is the
+//same as running the jobs one after another in the order they were added.
+class JobGraph
+{
+public:
+    JobGraph();
+
+    //Add a job that runs as a whole. bCallingThread keeps it on the thread
+    //that calls run(), for work such as drawing that belongs to the
+    //window's thread.
+    void addJob(const char* name,
+                JobFunc func,
+                void* context,
+                ColumnSet reads,
+                ColumnSet writes,
+                bool bCallingThread);
+
+    //Add a job whose items can run in parallel with each other, in chunks
+    //of grainSize. Jobs with fewer items than grainSize run as one chunk.
+    void addParallelJob(const char* name,
+                        JobFunc func,
+                        JobCountFunc countFunc,
+                        void* context,
+                        ColumnSet reads,
+                        ColumnSet writes,
+                        uint32_t grainSize);
+
+    //Put every job in the wave after the last earlier job it conflicts
+    //with: one of the two writes a column the other reads or writes. Call
+    //after the last addJob and before run.
+    void build();
+
+    void run(ThreadPool& pool);
+
+    //Log the waves with the jobs in each.
+    void logSchedule(const char* name) const;
+
+private:
+    JobGraph(const JobGraph&);
+    JobGraph& operator=(const JobGraph&);
+
+    static void RunChunks(void* context, uint32_t begin, uint32_t end);
+
+private:
+    struct Job
+    {
+        const char* mName;
+        JobFunc mFunc;
+        JobCountFunc mCountFunc;//Null for a job run as a whole.
+        void* mContext;
+        ColumnSet mReads;
+        ColumnSet mWrites;
+        uint32_t mGrainSize;
+        bool mCallingThread;
+        uint32_t mWave;
+    };
+
+    struct Chunk
+    {
+        uint32_t mJob;
+        uint32_t mBegin;
+        uint32_t mEnd;
+    };
+
+    std::vector<Job> mJobs;
+    std::vector<uint32_t> mOrder;//Jobs sorted by wave.
+    std::vector<uint32_t> mWaveStarts;//Into mOrder, one past the end last.
+
+    //Chunks of the wave being run, handed to the pool.
+    std::vector<Chunk> mChunks;
+};
+
+#endif
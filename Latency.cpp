@@ -0,0 +1,174 @@
+#include "Latency.h"
+#include "Log.h"
+#include "Threading.h"
+#include "Timer.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    //Changes that have not reached the screen yet. More than this means
+    //frames are not being presented and the oldest change is dropped.
+    const uint32_t MAX_CHANGES_IN_FLIGHT = 64;
+
+    struct KeyChange
+    {
+        uint64_t mTime;
+        uint64_t mStageTimes[NUM_LATENCY_STAGES];
+        int32_t mStage;//Last stage reached, -1 for none.
+        bool mFirePressed;
+    };
+
+    struct LatencyTracker
+    {
+        LatencyTracker() : mEnabled(false), mDropped(0)
+        {
+        }
+
+        bool mEnabled;//Set before any other thread starts.
+        Mutex mLock;//Keys can be read on the input thread.
+        std::vector<KeyChange> mInFlight;
+        std::vector<uint64_t> mSamples[NUM_LATENCY_STAGES];
+        uint32_t mDropped;
+    };
+
+    LatencyTracker gTracker;
+}
+
+const char* const LATENCY_STAGE_NAMES[NUM_LATENCY_STAGES] =
+{
+    "sampled",
+    "processed",
+    "created",
+    "drawn",
+    "presented",
+};
+
+//Stage a change must be at for mark to apply to it.
+static bool CanAdvance(const KeyChange& change, LatencyStage stage)
+{
+    switch(stage)
+    {
+    case LATENCY_CREATED:
+        return change.mFirePressed && change.mStage == LATENCY_PROCESSED;
+    case LATENCY_DRAWN:
+        //Not every change creates an object.
+        return change.mStage == LATENCY_PROCESSED || change.mStage == LATENCY_CREATED;
+    default:
+        return change.mStage == static_cast<int32_t>(stage) - 1;
+    }
+}
+
+void EnableLatencyTracking()
+{
+    gTracker.mEnabled = true;
+}
+
+bool IsLatencyTrackingEnabled()
+{
+    return gTracker.mEnabled;
+}
+
+void LatencyKeyChanged(uint64_t timeNanoseconds, bool firePressed)
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+
+    ScopedLock lock(gTracker.mLock);
+
+    if(gTracker.mInFlight.size() == MAX_CHANGES_IN_FLIGHT)
+    {
+        gTracker.mInFlight.erase(gTracker.mInFlight.begin());
+        gTracker.mDropped++;
+    }
+
+    KeyChange change;
+    change.mTime = timeNanoseconds;
+    change.mStage = -1;
+    change.mFirePressed = firePressed;
+    gTracker.mInFlight.push_back(change);
+}
+
+void LatencyMark(LatencyStage stage)
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+
+    const uint64_t now = GetTimeNanoseconds();
+
+    ScopedLock lock(gTracker.mLock);
+
+    std::vector<KeyChange>& inFlight = gTracker.mInFlight;
+    for(size_t index = 0; index < inFlight.size(); )
+    {
+        KeyChange& change = inFlight[index];
+        if(!CanAdvance(change, stage))
+        {
+            ++index;
+            continue;
+        }
+
+        change.mStageTimes[stage] = now;
+        change.mStage = stage;
+
+        if(stage != LATENCY_PRESENTED)
+        {
+            ++index;
+            continue;
+        }
+
+        //On screen. Record the time to every stage it passed.
+        for(int32_t passed = 0; passed < NUM_LATENCY_STAGES; ++passed)
+        {
+            if(passed != LATENCY_CREATED || change.mFirePressed)
+            {
+                gTracker.mSamples[passed].push_back(change.mStageTimes[passed] - change.mTime);
+            }
+        }
+        inFlight.erase(inFlight.begin() + index);
+    }
+}
+
+uint32_t LatencySampleCount(LatencyStage stage)
+{
+    ScopedLock lock(gTracker.mLock);
+    return static_cast<uint32_t>(gTracker.mSamples[stage].size());
+}
+
+void LogLatencyReport()
+{
+    if(!gTracker.mEnabled)
+    {
+        return;
+    }
+
+    ScopedLock lock(gTracker.mLock);
+
+    LogMessage("Input latency in ms from key change (%u changes in flight, %u dropped):",
+        static_cast<uint32_t>(gTracker.mInFlight.size()), gTracker.mDropped);
+
+    for(uint32_t stage = 0; stage < NUM_LATENCY_STAGES; ++stage)
+    {
+        std::vector<uint64_t> samples(gTracker.mSamples[stage]);
+        if(samples.empty())
+        {
+            LogMessage("  %-10s no samples", LATENCY_STAGE_NAMES[stage]);
+            continue;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        const size_t last = samples.size() - 1;
+        LogMessage("  %-10s n=%u min %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f",
+            LATENCY_STAGE_NAMES[stage],
+            static_cast<uint32_t>(samples.size()),
+            NanosecondsToMilliseconds(samples[0]),
+            NanosecondsToMilliseconds(samples[last / 2]),
+            NanosecondsToMilliseconds(samples[last * 95 / 100]),
+            NanosecondsToMilliseconds(samples[last * 99 / 100]),
+            NanosecondsToMilliseconds(samples[last]));
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "pstdint.h"
+
+//Points a key change passes on its way to the screen, in order.
+enum LatencyStage
+{
+    LATENCY_SAMPLED,//Read by SampleFrameInput.
+    LATENCY_PROCESSED,//Consumed by ProcessKeyboardInput/ProcessInputEvents.
+    LATENCY_CREATED,//Rocket created by CreateObjects. Fire presses only.
+    LATENCY_DRAWN,//DrawObjects drew a frame containing the change.
+    LATENCY_PRESENTED,//system->update() returned after submitting that frame.
+    NUM_LATENCY_STAGES,
+};
+
+extern const char* const LATENCY_STAGE_NAMES[NUM_LATENCY_STAGES];
+
+//Follows key changes from the moment they happen through the stages above
+//and collects the time from the change to each stage. Tracking is off by
+//default and every call returns straight away until it is enabled.
+//
+//Changes are reported by the backend (only HeadlessInvaders knows the
+//true time of a change). Stage marks advance every change in flight that
+//has reached the previous stage, so the numbers are exact for the serial
+//loop. In the pipelined loop the simulation runs one frame behind the
+//sampling and processed times can be attributed a frame early.
+void EnableLatencyTracking();
+bool IsLatencyTrackingEnabled();
+
+void LatencyKeyChanged(uint64_t timeNanoseconds, bool firePressed);
+void LatencyMark(LatencyStage stage);
+
+//Samples collected for stage so far. Changes count once they are
+//presented, so every stage they passed gets its sample then.
+uint32_t LatencySampleCount(LatencyStage stage);
+
+//Log count, min, median, 95th, 99th percentile and max for every stage.
+void LogLatencyReport();
+
+#endif
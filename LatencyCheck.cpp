@@ -0,0 +1,92 @@
+//Checks that scripted key changes make it through the input latency
+//stages to the screen.
+//Usage: LatencyCheck [-seconds N] [-seed N]
+//Plays -seconds N (default 2) of GameScreen on a HeadlessInvaders paced
+//at 60Hz with random key changes from -seed N every tenth of a second,
+//marking each frame presented after update() the way the game loop does.
+//Logs the latency report and exits 1 if no change reached the presented
+//stage.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Game.h"
+#include "HeadlessInvaders.h"
+#include "Latency.h"
+
+namespace
+{
+    const int WINDOW_WIDTH = 1280;
+    const int WINDOW_HEIGHT = 720;
+    const float FRAMES_PER_SECOND = 60.0f;
+
+    //Seconds between scripted key changes on average, and before the
+    //first.
+    const float KEY_INTERVAL = 0.1f;
+}
+
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t numSeconds = GetOptionInt(argc, argv, "-seconds", 2);
+    const uint32_t seed = GetOptionInt(argc, argv, "-seed", 1);
+    const uint32_t numFrames = static_cast<uint32_t>(numSeconds * FRAMES_PER_SECOND);
+
+    EnableLatencyTracking();
+
+    HeadlessInvaders* system = new HeadlessInvaders(FRAMES_PER_SECOND, numFrames);
+    system->injectRandomKeys(seed, static_cast<uint32_t>(numSeconds / KEY_INTERVAL), KEY_INTERVAL, KEY_INTERVAL);
+    system->init(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    GameState* state = new GameState(WINDOW_WIDTH, WINDOW_HEIGHT);
+    InitLevel(system, *state);
+
+    bool bRunning = true;
+    while(bRunning)
+    {
+        if(!state->mPlayerLives)
+        {
+            ResetLevel(*state, system->getElapsedTime());
+        }
+
+        GameScreen(system, 0, 0, 0, *state);
+        bRunning = system->update();
+        LatencyMark(LATENCY_PRESENTED);
+    }
+
+    LogLatencyReport();
+    std::printf("%u frames,", system->getFrameCount());
+    for(uint32_t stage = 0; stage < NUM_LATENCY_STAGES; ++stage)
+    {
+        std::printf(" %u %s", LatencySampleCount(static_cast<LatencyStage>(stage)), LATENCY_STAGE_NAMES[stage]);
+    }
+    std::printf("\n");
+    const uint32_t numPresented = LatencySampleCount(LATENCY_PRESENTED);
+
+    for(uint32_t index = 0; index < NUM_OBJECT_TYPES; ++index)
+    {
+        state->mSprites[index]->destroy();
+    }
+    delete state;
+    system->destroy();
+
+    if(!numPresented)
+    {
+        std::printf("FAILED: no key change reached the presented stage\n");
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
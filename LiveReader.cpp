@@ -0,0 +1,136 @@
+//Samples the live state a game publishes with -export NAME, see
+//LiveState.h.
+//Usage: LiveReader -name NAME [-samples N] [-interval MS] [-wait S]
+//
+//Attaches to NAME, waiting up to -wait S seconds (default 10) for it to
+//appear, then takes -samples N samples (default 10) -interval MS
+//milliseconds apart (default 500). Each prints the frame, score, lives,
+//objects of each table and where the player is. At the end the phase
+//times are averaged over the samples, with the frames the samples
+//skipped and the copies thrown away because the writer got there first.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "LiveState.h"
+#include "Threading.h"
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+//Returns the argument following option in argv or null.
+static const char* GetOptionString(int argc, char** argv, const char* option)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return argv[index + 1];
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = GetOptionString(argc, argv, "-name");
+    if(!name)
+    {
+        std::printf("Usage: LiveReader -name NAME [-samples N] [-interval MS] [-wait S]\n");
+        return 1;
+    }
+    const int numSamples = GetOptionInt(argc, argv, "-samples", 10);
+    const uint32_t interval = static_cast<uint32_t>(GetOptionInt(argc, argv, "-interval", 500));
+    const int waitSeconds = GetOptionInt(argc, argv, "-wait", 10);
+
+    LiveStateReader reader;
+    for(int wait = 0; !reader.open(name); ++wait)
+    {
+        if(wait >= waitSeconds * 10)
+        {
+            std::printf("Cannot attach to %s\n", name);
+            return 1;
+        }
+        ThreadSleep(100000);
+    }
+
+    const LiveStateHeader& header = *reader.getHeader();
+    std::printf("%s: %dx%d window, %u slots of %u bytes, room for %u objects\n",
+        name, header.mWindowWidth, header.mWindowHeight,
+        header.mNumSlots, header.mSlotSize, header.mMaxObjects);
+
+    LiveFrame frame;
+    std::vector<Position> positions;
+    uint64_t phaseTotals[NUM_SIMULATION_PHASES] = {0};
+    uint32_t samples = 0;
+    uint32_t retries = 0;
+    uint32_t skipped = 0;
+    uint32_t lastFrame = 0;
+    for(int sample = 0; sample < numSamples; ++sample)
+    {
+        if(sample)
+        {
+            ThreadSleep(interval * 1000);
+        }
+
+        if(!reader.read(frame, positions, retries))
+        {
+            std::printf("No frame\n");
+            continue;
+        }
+
+        if(samples && frame.mFrame > lastFrame)
+        {
+            skipped += frame.mFrame - lastFrame - 1;
+        }
+        lastFrame = frame.mFrame;
+        samples++;
+
+        for(uint32_t phase = 0; phase < NUM_SIMULATION_PHASES; ++phase)
+        {
+            phaseTotals[phase] += frame.mPhaseTimes[phase];
+        }
+
+        std::printf("frame %u at %.2fs: score %d, lives %d, objects",
+            frame.mFrame, frame.mTime, frame.mScore, frame.mLives);
+        for(uint32_t table = 0; table <= NUM_TABLES; ++table)
+        {
+            std::printf(" %u", frame.mNumRows[table]);
+        }
+        if(frame.mNumDropped)
+        {
+            std::printf(" (%u left out)", frame.mNumDropped);
+        }
+        if(frame.mNumRows[TABLE_PLAYER])
+        {
+            const Vec2 player = positions[0];
+            std::printf(", player at %.1f,%.1f", player.x(), player.y());
+        }
+        std::printf("\n");
+    }
+
+    if(samples)
+    {
+        std::printf("Mean phase times over %u samples (us):", samples);
+        for(uint32_t phase = 0; phase < NUM_SIMULATION_PHASES; ++phase)
+        {
+            std::printf(" %s %.1f", SIMULATION_PHASE_NAMES[phase], phaseTotals[phase] / 1000.0 / samples);
+        }
+        std::printf("\n");
+    }
+    std::printf("%u frames between samples, %u copies retried\n", skipped, retries);
+    return samples ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+#include "LiveState.h"
+#include "Atomics.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //Copies a reader starts before giving up on a writer that stopped
+    //halfway through a frame. A live writer is never in a slot that long.
+    const uint32_t MAX_READ_ATTEMPTS = 1000;
+}
+
+static size_t RoundToCacheLine(const size_t bytes)
+{
+    return (bytes + CACHE_LINE_SIZE - 1) & ~static_cast<size_t>(CACHE_LINE_SIZE - 1);
+}
+
+//Where the first slot starts.
+static size_t LiveHeaderSize()
+{
+    return RoundToCacheLine(sizeof(LiveStateHeader));
+}
+
+size_t LiveFramePositions()
+{
+    return RoundToCacheLine(sizeof(LiveFrame));
+}
+
+static LiveFrame& SlotAt(LiveStateHeader& header, const uint32_t slot)
+{
+    return *reinterpret_cast<LiveFrame*>(reinterpret_cast<char*>(&header) +
+        LiveHeaderSize() + slot * header.mSlotSize);
+}
+
+static const LiveFrame& SlotAt(const LiveStateHeader& header, const uint32_t slot)
+{
+    return *reinterpret_cast<const LiveFrame*>(reinterpret_cast<const char*>(&header) +
+        LiveHeaderSize() + slot * header.mSlotSize);
+}
+
+//Everything the header says the memory holds.
+static size_t LiveStateSize(const LiveStateHeader& header)
+{
+    return LiveHeaderSize() + static_cast<size_t>(header.mNumSlots) * header.mSlotSize;
+}
+
+LiveStateWriter::LiveStateWriter() : mHeader(0),
+    mSize(0),
+    mPublished(0)
+#if defined(_WIN32)
+    , mMapping(0)
+#endif
+{
+    mName[0] = 0;
+}
+
+LiveStateWriter::~LiveStateWriter()
+{
+    close();
+}
+
+bool LiveStateWriter::open(const char* name, const int windowWidth, const int windowHeight)
+{
+    close();
+
+    //Every row a game can have at once, and as many again destroyed.
+    uint32_t rows[NUM_TABLES];
+    MaxTableRows(windowWidth, windowHeight, rows);
+    uint32_t maxObjects = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        maxObjects += rows[table];
+    }
+    maxObjects *= 2;
+
+    LiveStateHeader layout;
+    std::memset(&layout, 0, sizeof(layout));
+    layout.mNumSlots = LIVE_STATE_SLOTS;
+    layout.mSlotSize = static_cast<uint32_t>(RoundToCacheLine(LiveFramePositions() + maxObjects * sizeof(Position)));
+    const size_t size = LiveStateSize(layout);
+
+#if defined(_WIN32)
+    std::strncpy(mName, name, sizeof(mName) - 1);
+    mName[sizeof(mName) - 1] = 0;
+
+    mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, static_cast<DWORD>(size), mName);
+    if(!mMapping)
+    {
+        return false;
+    }
+
+    void* data = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if(!data)
+    {
+        close();
+        return false;
+    }
+    std::memset(data, 0, size);
+#else
+    mName[0] = '/';
+    std::strncpy(mName + (name[0] != '/'), name, sizeof(mName) - 2);
+    mName[sizeof(mName) - 1] = 0;
+
+    //Whatever a writer that died left under the name is thrown away.
+    const int fd = shm_open(mName, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    if(ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(mName);
+        return false;
+    }
+
+    //The mapping keeps its own reference to the memory.
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+        shm_unlink(mName);
+        return false;
+    }
+#endif
+
+    mHeader = static_cast<LiveStateHeader*>(data);
+    mSize = size;
+    mPublished = 0;
+
+    mHeader->mVersion = LIVE_STATE_VERSION;
+    mHeader->mNumSlots = layout.mNumSlots;
+    mHeader->mSlotSize = layout.mSlotSize;
+    mHeader->mMaxObjects = maxObjects;
+    mHeader->mPositionSize = sizeof(Position);
+    mHeader->mWindowWidth = windowWidth;
+    mHeader->mWindowHeight = windowHeight;
+    mHeader->mPublished = 0;
+
+    //A reader that attaches now sees no magic until the rest is there.
+    AtomicFence();
+    mHeader->mMagic = LIVE_STATE_MAGIC;
+    return true;
+}
+
+void LiveStateWriter::close()
+{
+#if defined(_WIN32)
+    if(mHeader)
+    {
+        UnmapViewOfFile(mHeader);
+    }
+    if(mMapping)
+    {
+        CloseHandle(mMapping);
+        mMapping = 0;
+    }
+#else
+    if(mHeader)
+    {
+        munmap(mHeader, mSize);
+        shm_unlink(mName);
+    }
+#endif
+
+    mHeader = 0;
+    mSize = 0;
+    mName[0] = 0;
+}
+
+void LiveStateWriter::publish(const GameState& state,
+                              const uint32_t phaseTimes[NUM_SIMULATION_PHASES])
+{
+    if(!mHeader)
+    {
+        return;
+    }
+
+    LiveFrame& frame = SlotAt(*mHeader, static_cast<uint32_t>(mPublished) % mHeader->mNumSlots);
+    const int32_t sequence = frame.mSequence;
+    AtomicStore(&frame.mSequence, sequence + 1);
+    AtomicFence();
+
+    frame.mFrame = static_cast<uint32_t>(mPublished);
+    frame.mTime = state.mLastTime;
+    frame.mScore = state.mPlayerScore;
+    frame.mLives = state.mPlayerLives;
+    for(uint32_t phase = 0; phase < NUM_SIMULATION_PHASES; ++phase)
+    {
+        frame.mPhaseTimes[phase] = phaseTimes ? phaseTimes[phase] : 0;
+    }
+
+    //Straight from the tables, which are already in scene order. Each
+    //table is an array of its own, so it is one copy per table.
+    Position* positions = reinterpret_cast<Position*>(reinterpret_cast<char*>(&frame) + LiveFramePositions());
+    const uint32_t maxObjects = mHeader->mMaxObjects;
+    uint32_t numObjects = 0;
+    frame.mNumDropped = 0;
+    for(uint32_t table = 0; table <= NUM_TABLES; ++table)
+    {
+        const PositionVector& rows = table < NUM_TABLES ?
+            state.mScene.mTables[table].mPositions : state.mScene.mDestroyed.mPositions;
+        const uint32_t numRows = static_cast<uint32_t>(rows.size());
+        const uint32_t count = std::min(numRows, maxObjects - numObjects);
+        if(count)
+        {
+            std::memcpy(static_cast<void*>(positions + numObjects), &rows[0], count * sizeof(Position));
+        }
+        if(table < NUM_TABLES)
+        {
+            frame.mTypes[table] = state.mScene.mTables[table].mType;
+        }
+        frame.mNumRows[table] = count;
+        frame.mNumDropped += numRows - count;
+        numObjects += count;
+    }
+
+    AtomicStore(&frame.mSequence, sequence + 2);
+    mPublished++;
+    AtomicStore(&mHeader->mPublished, mPublished);
+}
+
+LiveStateReader::LiveStateReader() : mHeader(0),
+    mSize(0)
+#if defined(_WIN32)
+    , mMapping(0)
+#endif
+{
+}
+
+LiveStateReader::~LiveStateReader()
+{
+    close();
+}
+
+bool LiveStateReader::open(const char* name)
+{
+    close();
+
+#if defined(_WIN32)
+    mMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if(!mMapping)
+    {
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if(!data)
+    {
+        close();
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION region;
+    const size_t size = VirtualQuery(data, &region, sizeof(region)) ? region.RegionSize : 0;
+#else
+    char path[64];
+    path[0] = '/';
+    std::strncpy(path + (name[0] != '/'), name, sizeof(path) - 2);
+    path[sizeof(path) - 1] = 0;
+
+    const int fd = shm_open(path, O_RDONLY, 0);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    const void* data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+#endif
+
+    mHeader = static_cast<const LiveStateHeader*>(data);
+    mSize = size;
+
+    if(mSize < LiveHeaderSize() ||
+        mHeader->mMagic != LIVE_STATE_MAGIC ||
+        mHeader->mVersion != LIVE_STATE_VERSION ||
+        mHeader->mPositionSize != sizeof(Position) ||
+        !mHeader->mNumSlots ||
+        mHeader->mSlotSize < LiveFramePositions() + mHeader->mMaxObjects * sizeof(Position) ||
+        mSize < LiveStateSize(*mHeader))
+    {
+        close();
+        return false;
+    }
+    AtomicFence();
+    return true;
+}
+
+void LiveStateReader::close()
+{
+#if defined(_WIN32)
+    if(mHeader)
+    {
+        UnmapViewOfFile(mHeader);
+    }
+    if(mMapping)
+    {
+        CloseHandle(mMapping);
+        mMapping = 0;
+    }
+#else
+    if(mHeader)
+    {
+        munmap(const_cast<LiveStateHeader*>(mHeader), mSize);
+    }
+#endif
+
+    mHeader = 0;
+    mSize = 0;
+}
+
+bool LiveStateReader::read(LiveFrame& frame,
+                           std::vector<Position>& positions,
+                           uint32_t& retries)
+{
+    if(!mHeader)
+    {
+        return false;
+    }
+
+    for(uint32_t attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+    {
+        const int32_t published = AtomicLoad(&mHeader->mPublished);
+        if(!published)
+        {
+            return false;
+        }
+
+        const LiveFrame& shared = SlotAt(*mHeader, static_cast<uint32_t>(published - 1) % mHeader->mNumSlots);
+        const int32_t sequence = AtomicLoad(&shared.mSequence);
+        if(sequence & 1)
+        {
+            retries++;
+            continue;
+        }
+
+        std::memcpy(&frame, &shared, sizeof(frame));
+
+        //Counts from a torn copy can be anything, so they are clamped
+        //before they size the copy. The copy is thrown away anyway.
+        uint32_t numObjects = 0;
+        for(uint32_t table = 0; table <= NUM_TABLES; ++table)
+        {
+            numObjects += std::min(frame.mNumRows[table], mHeader->mMaxObjects);
+        }
+        numObjects = std::min(numObjects, mHeader->mMaxObjects);
+        positions.resize(numObjects);
+        if(numObjects)
+        {
+            std::memcpy(static_cast<void*>(&positions[0]), reinterpret_cast<const char*>(&shared) + LiveFramePositions(),
+                numObjects * sizeof(Position));
+        }
+
+        AtomicFence();
+        if(AtomicLoad(&shared.mSequence) == sequence)
+        {
+            return true;
+        }
+        retries++;
+    }
+    return false;
+}
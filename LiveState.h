@@ -0,0 +1,130 @@
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include <cstddef>
+#include <vector>
+#include "Game.h"
+#include "pstdint.h"
+
+//Live state of a running game in named shared memory, for profilers and
+//visualizers in other processes. The writer never waits for them: the
+//memory is a ring of LIVE_STATE_SLOTS frames, each behind a sequence
+//number that is odd while the writer is in the slot. A reader copies
+//the newest slot and keeps the copy only if the sequence was even and
+//had not changed by the end, so a reader that is lapped tries again and
+//the writer never knows it is there.
+//
+//A frame is the score, lives, object counts, phase times and the raw
+//Positions of every table in scene order. Publishing one copies about
+//what a snapshot of the tables is, with no conversion.
+
+const uint32_t LIVE_STATE_MAGIC = 0x4556494c;//"LIVE"
+const uint32_t LIVE_STATE_VERSION = 1;
+const uint32_t LIVE_STATE_SLOTS = 4;
+
+//Start of the shared memory.
+struct LiveStateHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mNumSlots;
+    uint32_t mSlotSize;//Bytes from one LiveFrame to the next.
+    uint32_t mMaxObjects;//Positions a slot holds.
+    uint32_t mPositionSize;//sizeof(Position) of the writer's build.
+    int32_t mWindowWidth;
+    int32_t mWindowHeight;
+    volatile int32_t mPublished;//Frames so far. Frame N is in slot N % mNumSlots.
+};
+
+//One slot of the ring. mMaxObjects Positions follow it, from
+//LiveFramePositions.
+struct LiveFrame
+{
+    volatile int32_t mSequence;//Odd while the writer is in the slot.
+    uint32_t mFrame;
+    float mTime;
+    int32_t mScore;
+    int32_t mLives;
+    int32_t mTypes[NUM_TABLES];//Sprite of each table.
+    uint32_t mNumRows[NUM_TABLES + 1];//Last are the destroyed objects.
+    uint32_t mNumDropped;//Objects past mMaxObjects, left out.
+    uint32_t mPhaseTimes[NUM_SIMULATION_PHASES];//Nanoseconds, 0 if not timed.
+};
+
+//Where a slot's Positions start.
+size_t LiveFramePositions();
+
+//Publishes a game's frames. Not thread safe: one thread publishes.
+class LiveStateWriter
+{
+public:
+    LiveStateWriter();
+    ~LiveStateWriter();
+
+    //Create the shared memory name with room for a game in a window of
+    //width by height, see MaxTableRows. POSIX names get a leading '/' if
+    //they have none.
+    bool open(const char* name, const int windowWidth, const int windowHeight);
+    //Also removes the name.
+    void close();
+
+    bool isOpen() const
+    {
+        return mHeader != 0;
+    }
+
+    //Copy the state into the next slot. phaseTimes may be null.
+    void publish(const GameState& state,
+                 const uint32_t phaseTimes[NUM_SIMULATION_PHASES]);
+
+private:
+    LiveStateWriter(const LiveStateWriter&);
+    LiveStateWriter& operator=(const LiveStateWriter&);
+
+private:
+    LiveStateHeader* mHeader;
+    size_t mSize;
+    int32_t mPublished;
+    char mName[64];
+#if defined(_WIN32)
+    void* mMapping;
+#endif
+};
+
+//Samples what a LiveStateWriter publishes, read only.
+class LiveStateReader
+{
+public:
+    LiveStateReader();
+    ~LiveStateReader();
+
+    //False if there is no such memory or it was written by a version or a
+    //Position type other than this build's.
+    bool open(const char* name);
+    void close();
+
+    const LiveStateHeader* getHeader() const
+    {
+        return mHeader;
+    }
+
+    //Copy the newest frame. False if none has been published yet or the
+    //writer stopped halfway through one. retries counts the copies
+    //thrown away because the writer got to the slot first.
+    bool read(LiveFrame& frame,
+              std::vector<Position>& positions,
+              uint32_t& retries);
+
+private:
+    LiveStateReader(const LiveStateReader&);
+    LiveStateReader& operator=(const LiveStateReader&);
+
+private:
+    const LiveStateHeader* mHeader;
+    size_t mSize;
+#if defined(_WIN32)
+    void* mMapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,296 @@
+//Load generator for GameServer. Opens many loopback connections from one
+//thread and plays each with a scripted random sequence of key changes.
+//Reports how long the server takes to acknowledge an input in a state
+//message and how many states arrive.
+//
+//-churn MS kills a random client every MS milliseconds, with a reset so
+//the server sees it mid-stream, and connects a new one in its place.
+//Usage: LoadGenerator [-port N] [-clients N] [-seconds N] [-interval MS]
+//                     [-churn MS]
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ServerProtocol.h"
+#include "Timer.h"
+
+namespace
+{
+    //Connections opened per loop so the listen backlog is not overrun.
+    const uint32_t CONNECT_BATCH = 128;
+
+    const int MAX_EPOLL_EVENTS = 256;
+
+    struct Client
+    {
+        int mSocket;
+        uint32_t mRandom;
+        uint64_t mNextChangeTime;
+
+        uint32_t mSequence;
+        uint64_t mSendTime;//Of mSequence, 0 once acknowledged.
+
+        uint8_t mState[sizeof(StateMessage)];
+        uint32_t mStateBytes;
+        uint32_t mLastTick;
+    };
+}
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+static uint32_t NextRandom(uint32_t& random)
+{
+    random = random * 1664525u + 1013904223u;
+    return random >> 8;
+}
+
+static bool Connect(uint16_t port, Client& client)
+{
+    client.mSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(client.mSocket < 0)
+    {
+        return false;
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(client.mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(client.mSocket);
+        return false;
+    }
+
+    const int noDelay = 1;
+    setsockopt(client.mSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+}
+
+//Connect client and poll it. seed starts its key script.
+static bool StartClient(int epoll, uint16_t port, Client& client, uint32_t seed, uint64_t now, uint64_t interval)
+{
+    if(!Connect(port, client))
+    {
+        return false;
+    }
+
+    client.mRandom = seed * 2654435761u + 1;
+    client.mNextChangeTime = now + NextRandom(client.mRandom) % interval;
+    client.mSequence = 0;
+    client.mSendTime = 0;
+    client.mStateBytes = 0;
+    client.mLastTick = 0;
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &client;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, client.mSocket, &event);
+    return true;
+}
+
+//Close with a reset instead of a FIN, like a client that crashed. The
+//server's next send to it fails, and it may be told of the hang-up in
+//the same epoll batch as its tick.
+static void KillClient(int epoll, Client& client)
+{
+    linger abort;
+    abort.l_onoff = 1;
+    abort.l_linger = 0;
+    setsockopt(client.mSocket, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+    epoll_ctl(epoll, EPOLL_CTL_DEL, client.mSocket, 0);
+    close(client.mSocket);
+}
+
+//Send the next scripted key change. Messages are 8 bytes so a loopback
+//socket with room takes them whole.
+static bool SendInput(Client& client, uint64_t now, uint64_t interval)
+{
+    InputMessage message;
+    std::memset(&message, 0, sizeof(message));
+    message.mSequence = ++client.mSequence;
+    message.mKeys = static_cast<uint8_t>(NextRandom(client.mRandom) & (INPUT_FIRE | INPUT_LEFT | INPUT_RIGHT));
+
+    if(send(client.mSocket, &message, sizeof(message), MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(message))
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+
+    //Only the newest input is timed. An older one still in flight is
+    //acknowledged by the same state.
+    client.mSendTime = now;
+    client.mNextChangeTime = now + interval / 2 + NextRandom(client.mRandom) % interval;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const uint16_t port = static_cast<uint16_t>(GetOptionInt(argc, argv, "-port", SERVER_DEFAULT_PORT));
+    const uint32_t numClients = std::max(GetOptionInt(argc, argv, "-clients", 1000), 1);
+    const uint64_t seconds = std::max(GetOptionInt(argc, argv, "-seconds", 10), 1);
+    const uint64_t interval = std::max(GetOptionInt(argc, argv, "-interval", 100), 1) * 1000000ull;
+    const uint64_t churn = std::max(GetOptionInt(argc, argv, "-churn", 0), 0) * 1000000ull;
+
+    rlimit files;
+    if(getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    const int epoll = epoll_create1(0);
+    if(epoll < 0)
+    {
+        std::perror("epoll_create1");
+        return 1;
+    }
+
+    std::vector<Client> clients(numClients);
+    std::vector<uint64_t> latencies;
+    uint64_t statesReceived = 0;
+    uint64_t ticksSkipped = 0;
+    uint32_t connected = 0;
+    uint32_t disconnected = 0;
+    uint32_t killed = 0;
+    uint32_t killRandom = 1;
+
+    const uint64_t startTime = GetTimeNanoseconds();
+    const uint64_t endTime = startTime + seconds * 1000000000ull;
+    uint64_t nextKillTime = startTime + churn;
+
+    epoll_event events[MAX_EPOLL_EVENTS];
+    for(uint64_t now = startTime; now < endTime; now = GetTimeNanoseconds())
+    {
+        for(uint32_t batch = 0; batch < CONNECT_BATCH && connected < numClients; ++batch)
+        {
+            if(!StartClient(epoll, port, clients[connected], connected, now, interval))
+            {
+                std::fprintf(stderr, "LoadGenerator: connect %u failed (%s)\n", connected, std::strerror(errno));
+                return 1;
+            }
+            connected++;
+        }
+
+        //Events already waiting for a killed client are dropped with it,
+        //so none in the batch below can name its old socket.
+        if(churn && connected && now >= nextKillTime)
+        {
+            const uint32_t victim = NextRandom(killRandom) % connected;
+            KillClient(epoll, clients[victim]);
+            killed++;
+            if(!StartClient(epoll, port, clients[victim], numClients + killed, now, interval))
+            {
+                std::fprintf(stderr, "LoadGenerator: reconnect %u failed (%s)\n", victim, std::strerror(errno));
+                return 1;
+            }
+            nextKillTime += churn;
+        }
+
+        const int count = epoll_wait(epoll, events, MAX_EPOLL_EVENTS, 1);
+        now = GetTimeNanoseconds();
+        for(int index = 0; index < count; ++index)
+        {
+            Client& client = *static_cast<Client*>(events[index].data.ptr);
+            for(;;)
+            {
+                const ssize_t received = recv(client.mSocket,
+                    client.mState + client.mStateBytes,
+                    sizeof(client.mState) - client.mStateBytes,
+                    MSG_DONTWAIT);
+                if(received <= 0)
+                {
+                    if(received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                    {
+                        epoll_ctl(epoll, EPOLL_CTL_DEL, client.mSocket, 0);
+                        disconnected++;
+                    }
+                    break;
+                }
+
+                client.mStateBytes += static_cast<uint32_t>(received);
+                if(client.mStateBytes < sizeof(StateMessage))
+                {
+                    continue;
+                }
+
+                StateMessage message;
+                std::memcpy(&message, client.mState, sizeof(message));
+                client.mStateBytes = 0;
+                statesReceived++;
+
+                if(client.mLastTick && message.mTick > client.mLastTick + 1)
+                {
+                    ticksSkipped += message.mTick - client.mLastTick - 1;
+                }
+                client.mLastTick = message.mTick;
+
+                if(client.mSendTime && message.mInputSequence == client.mSequence)
+                {
+                    latencies.push_back(now - client.mSendTime);
+                    client.mSendTime = 0;
+                }
+            }
+        }
+
+        for(uint32_t index = 0; index < connected; ++index)
+        {
+            Client& client = clients[index];
+            if(now >= client.mNextChangeTime && !SendInput(client, now, interval))
+            {
+                client.mNextChangeTime = endTime;
+            }
+        }
+    }
+
+    for(uint32_t index = 0; index < connected; ++index)
+    {
+        close(clients[index].mSocket);
+    }
+    close(epoll);
+
+    std::printf("LoadGenerator: %u clients, %u disconnected, %u killed, %.0f states/s, %llu ticks skipped\n",
+        connected, disconnected, killed,
+        statesReceived / static_cast<double>(seconds),
+        static_cast<unsigned long long>(ticksSkipped));
+
+    if(latencies.empty())
+    {
+        std::printf("LoadGenerator: no inputs acknowledged\n");
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const size_t last = latencies.size() - 1;
+    std::printf("LoadGenerator: input to state latency n=%u p50 %.3f p95 %.3f p99 %.3f max %.3f ms\n",
+        static_cast<uint32_t>(latencies.size()),
+        NanosecondsToMilliseconds(latencies[last / 2]),
+        NanosecondsToMilliseconds(latencies[last * 95 / 100]),
+        NanosecondsToMilliseconds(latencies[last * 99 / 100]),
+        NanosecondsToMilliseconds(latencies[last]));
+    return 0;
+}
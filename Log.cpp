@@ -0,0 +1,26 @@
+#include "Log.h"
+#include <cstdarg>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+void LogMessage(const char* format, ...)
+{
+    char message[512];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+#if defined(_WIN32)
+    OutputDebugStringA(message);
+    OutputDebugStringA("\n");
+#else
+    std::fputs(message, stderr);
+    std::fputc('\n', stderr);
+#endif
+}
@@ -0,0 +1,8 @@
+#ifndef LOG_H
+#define LOG_H
+
+//printf style diagnostics. Goes to the debugger output on Windows since
+//the game has no console, and to stderr elsewhere.
+void LogMessage(const char* format, ...);
+
+#endif
@@ -0,0 +1,137 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile() : mData(0),
+    mSize(0),
+    mFile(INVALID_HANDLE_VALUE),
+    mMapping(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(mFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0);
+    if(!mMapping)
+    {
+        close();
+        return false;
+    }
+
+    mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if(!mData)
+    {
+        close();
+        return false;
+    }
+
+    mSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData)
+    {
+        UnmapViewOfFile(mData);
+        mData = 0;
+    }
+
+    if(mMapping)
+    {
+        CloseHandle(mMapping);
+        mMapping = 0;
+    }
+
+    if(mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+    }
+
+    mSize = 0;
+}
+
+#else
+
+MappedFile::MappedFile() : mData(0),
+    mSize(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    //The mapping keeps its own reference to the file.
+    void* data = mmap(0, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mData = static_cast<const uint8_t*>(data);
+    mSize = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData)
+    {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+        mData = 0;
+    }
+    mSize = 0;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include "pstdint.h"
+
+//Read-only memory mapping of a whole file. The view is page aligned.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char* path);
+    void close();
+
+    const uint8_t* getData() const
+    {
+        return mData;
+    }
+
+    size_t getSize() const
+    {
+        return mSize;
+    }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+#if defined(_WIN32)
+    void* mFile;
+    void* mMapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "Narrowphase.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NARROWPHASE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    //ShotHits for pair index of block.
+    bool PairHits(const PairBlock& block, const uint32_t index, const HitGeometry& geometry)
+    {
+#if defined(FIXED_POSITIONS)
+        const int dx = block.mShotX[index] + (geometry.mHitX - geometry.mBoxLeft) * FIXED_ONE - block.mTargetX[index];
+        const int dy = block.mShotY[index] + (geometry.mHitY - geometry.mBoxTop) * FIXED_ONE - block.mTargetY[index];
+        return dx > 0 && dx < (geometry.mBoxRight - geometry.mBoxLeft) * FIXED_ONE &&
+            dy > 0 && dy < (geometry.mBoxBottom - geometry.mBoxTop) * FIXED_ONE;
+#else
+        const float rx = block.mShotX[index] + static_cast<float>(geometry.mHitX);
+        const float ry = block.mShotY[index] + static_cast<float>(geometry.mHitY);
+
+        const float left = block.mTargetX[index] + static_cast<float>(geometry.mBoxLeft);
+        const float top = block.mTargetY[index] + static_cast<float>(geometry.mBoxTop);
+        const float right = block.mTargetX[index] + static_cast<float>(geometry.mBoxRight);
+        const float bottom = block.mTargetY[index] + static_cast<float>(geometry.mBoxBottom);
+
+        return (rx > left) && (rx < right) && (ry < bottom) && (ry > top);
+#endif
+    }
+}
+
+void PairHitMasks(const PairBlock& block,
+                  const HitGeometry& geometry,
+                  uint32_t masks[NARROWPHASE_MASK_WORDS])
+{
+    for(uint32_t word = 0; word < (block.mCount + 31) / 32; ++word)
+    {
+        masks[word] = 0;
+    }
+
+    uint32_t index = 0;
+
+#if defined(NARROWPHASE_SSE2) && defined(FIXED_POSITIONS)
+    const __m128i toTipX = _mm_set1_epi32((geometry.mHitX - geometry.mBoxLeft) * FIXED_ONE);
+    const __m128i toTipY = _mm_set1_epi32((geometry.mHitY - geometry.mBoxTop) * FIXED_ONE);
+    const __m128i widths = _mm_set1_epi32((geometry.mBoxRight - geometry.mBoxLeft) * FIXED_ONE);
+    const __m128i heights = _mm_set1_epi32((geometry.mBoxBottom - geometry.mBoxTop) * FIXED_ONE);
+    const __m128i zero = _mm_setzero_si128();
+    for(; index + 4 <= block.mCount; index += 4)
+    {
+        const __m128i shotX = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&block.mShotX[index]));
+        const __m128i shotY = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&block.mShotY[index]));
+        const __m128i targetX = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&block.mTargetX[index]));
+        const __m128i targetY = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&block.mTargetY[index]));
+        const __m128i dx = _mm_sub_epi32(_mm_add_epi32(shotX, toTipX), targetX);
+        const __m128i dy = _mm_sub_epi32(_mm_add_epi32(shotY, toTipY), targetY);
+        const __m128i inside = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi32(dx, zero), _mm_cmpgt_epi32(widths, dx)),
+            _mm_and_si128(_mm_cmpgt_epi32(dy, zero), _mm_cmpgt_epi32(heights, dy)));
+        masks[index / 32] |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(inside))) << (index % 32);
+    }
+#elif defined(NARROWPHASE_SSE2)
+    const __m128 hitX = _mm_set1_ps(static_cast<float>(geometry.mHitX));
+    const __m128 hitY = _mm_set1_ps(static_cast<float>(geometry.mHitY));
+    const __m128 boxLeft = _mm_set1_ps(static_cast<float>(geometry.mBoxLeft));
+    const __m128 boxTop = _mm_set1_ps(static_cast<float>(geometry.mBoxTop));
+    const __m128 boxRight = _mm_set1_ps(static_cast<float>(geometry.mBoxRight));
+    const __m128 boxBottom = _mm_set1_ps(static_cast<float>(geometry.mBoxBottom));
+    for(; index + 4 <= block.mCount; index += 4)
+    {
+        const __m128 targetX = _mm_loadu_ps(&block.mTargetX[index]);
+        const __m128 targetY = _mm_loadu_ps(&block.mTargetY[index]);
+        const __m128 rx = _mm_add_ps(_mm_loadu_ps(&block.mShotX[index]), hitX);
+        const __m128 ry = _mm_add_ps(_mm_loadu_ps(&block.mShotY[index]), hitY);
+        const __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmpgt_ps(rx, _mm_add_ps(targetX, boxLeft)),
+                       _mm_cmplt_ps(rx, _mm_add_ps(targetX, boxRight))),
+            _mm_and_ps(_mm_cmplt_ps(ry, _mm_add_ps(targetY, boxBottom)),
+                       _mm_cmpgt_ps(ry, _mm_add_ps(targetY, boxTop))));
+        masks[index / 32] |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << (index % 32);
+    }
+#endif
+
+    for(; index < block.mCount; ++index)
+    {
+        if(PairHits(block, index, geometry))
+        {
+            masks[index / 32] |= 1u << (index % 32);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include "ObjectTraits.h"
+
+//Pairs the hit test gathers and tests at a time. Their coordinates fill
+//4KB, which stays in L1 from the gather to the test.
+const uint32_t NARROWPHASE_BLOCK = 256;
+
+//A position's coordinates as the hit test takes them: fixed point steps
+//widened to 32 bits so differences cannot overflow, or floats.
+#if defined(FIXED_POSITIONS)
+typedef int32_t Coordinate;
+
+inline Coordinate CoordinateX(const Position& position)
+{
+    return position.rawX();
+}
+inline Coordinate CoordinateY(const Position& position)
+{
+    return position.rawY();
+}
+#else
+typedef float Coordinate;
+
+inline Coordinate CoordinateX(const Position& position)
+{
+    return position.x();
+}
+inline Coordinate CoordinateY(const Position& position)
+{
+    return position.y();
+}
+#endif
+
+//The pixel a rule's projectiles test and the box of its targets they
+//have to be strictly inside, from their positions, in pixels.
+struct HitGeometry
+{
+    int mHitX;
+    int mHitY;
+    int mBoxLeft;
+    int mBoxTop;
+    int mBoxRight;
+    int mBoxBottom;
+};
+
+template<CollisionRule RULE>
+inline HitGeometry RuleGeometry()
+{
+    typedef TableTraits<RuleTraits<RULE>::SHOTS> Shots;
+    typedef TableTraits<RuleTraits<RULE>::TARGETS> Targets;
+
+    HitGeometry geometry;
+    geometry.mHitX = Shots::HIT_X;
+    geometry.mHitY = Shots::HIT_Y;
+    geometry.mBoxLeft = Targets::BOX_LEFT;
+    geometry.mBoxTop = Targets::BOX_TOP;
+    geometry.mBoxRight = Targets::BOX_RIGHT;
+    geometry.mBoxBottom = Targets::BOX_BOTTOM;
+    return geometry;
+}
+
+//Positions of up to NARROWPHASE_BLOCK pairs, an array per coordinate.
+struct PairBlock
+{
+    Coordinate mShotX[NARROWPHASE_BLOCK];
+    Coordinate mShotY[NARROWPHASE_BLOCK];
+    Coordinate mTargetX[NARROWPHASE_BLOCK];
+    Coordinate mTargetY[NARROWPHASE_BLOCK];
+    uint32_t mCount;
+};
+
+//Words of PairHitMasks' masks for a full block.
+const uint32_t NARROWPHASE_MASK_WORDS = NARROWPHASE_BLOCK / 32;
+
+//Bit n % 32 of masks[n / 32] is set if the projectile of pair n hits its
+//target, for n < block.mCount. The same sums and compares as ShotHits,
+//so the same hits, four pairs at a time with SSE2 where the build has it.
+void PairHitMasks(const PairBlock& block,
+                  const HitGeometry& geometry,
+                  uint32_t masks[NARROWPHASE_MASK_WORDS]);
+
+#endif
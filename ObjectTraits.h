@@ -0,0 +1,303 @@
+#ifndef OBJECT_TRAITS_H
+#define OBJECT_TRAITS_H
+
+#include "SceneObject.h"
+
+//What the objects of each table are, fixed at compile time. The passes of
+//SceneObject.cpp are templates on the table they run over, so a pass is
+//compiled once per table with everything below known, and nothing about
+//the kind of object is looked up inside its loop.
+//
+//SPRITE, SECOND_SPRITE: the sprite the table starts with and the one it
+//  switches to every other second. The same for tables that do not
+//  animate.
+//MOVES: objects move with the table's velocity each frame.
+//CULLED: objects outside the window are deleted.
+//BOX_LEFT, BOX_TOP, BOX_RIGHT, BOX_BOTTOM: the box a projectile has to
+//  be strictly inside of to hit an object, from its position. The opaque
+//  part of the bitmap; outside it everything is black.
+//HIT_X, HIT_Y: for projectiles, the pixel tested against their targets'
+//  boxes. Inside their own box.
+//DESTROYED_BY_HIT: a target hit is destroyed, and the projectile that hit
+//  it is the only one used up on it.
+//SPENT_BY_HIT: for projectiles, used up by the first thing they hit. One
+//  already used up, or shot down, hits nothing else that frame.
+//Speed(): pixels per second. Velocity(): the table's velocity at the start
+//  of a level.
+template<TableId TABLE> struct TableTraits;
+
+template<> struct TableTraits<TABLE_PLAYER>
+{
+    enum
+    {
+        SPRITE = PLAYER,
+        SECOND_SPRITE = PLAYER,
+        MOVES = 0,//Moved by ProcessKeyboardInput.
+        CULLED = 0,
+        DESTROYED_BY_HIT = 0,//Loses a life instead.
+        BOX_LEFT = 0,
+        BOX_TOP = 0,
+        BOX_RIGHT = SPRITE_SIZE,
+        BOX_BOTTOM = SPRITE_SIZE,
+    };
+
+    static float Speed() { return PLAYER_SPEED; }
+    static Vec2 Velocity() { return Vec2(0.0f, 0.0f); }
+};
+
+template<> struct TableTraits<TABLE_ALIENS>
+{
+    enum
+    {
+        SPRITE = ENEMY1,
+        SECOND_SPRITE = ENEMY2,
+        MOVES = 1,
+        CULLED = 1,
+        DESTROYED_BY_HIT = 1,
+        BOX_LEFT = 0,
+        BOX_TOP = 0,
+        BOX_RIGHT = SPRITE_SIZE,
+        BOX_BOTTOM = SPRITE_SIZE,
+    };
+
+    //The formation steps this far, in its direction, when the sprite
+    //changes. Its velocity is only the direction.
+    static float Speed() { return ALIEN_SPEED; }
+    static Vec2 Velocity() { return Vec2(1.0f, 0.0f); }
+};
+
+template<> struct TableTraits<TABLE_BOMBS>
+{
+    enum
+    {
+        SPRITE = BOMB,
+        SECOND_SPRITE = BOMB,
+        MOVES = 1,
+        CULLED = 1,
+        DESTROYED_BY_HIT = 1,//By a rocket.
+        SPENT_BY_HIT = 1,
+        BOX_LEFT = 9,
+        BOX_TOP = 8,
+        BOX_RIGHT = 20,
+        BOX_BOTTOM = 25,
+        HIT_X = 9,
+        HIT_Y = 8,
+    };
+
+    static float Speed() { return BOMB_SPEED; }
+    static Vec2 Velocity() { return Vec2(0.0f, BOMB_SPEED); }
+};
+
+template<> struct TableTraits<TABLE_ROCKETS>
+{
+    enum
+    {
+        SPRITE = ROCKET,
+        SECOND_SPRITE = ROCKET,
+        MOVES = 1,
+        CULLED = 1,
+        DESTROYED_BY_HIT = 0,
+        SPENT_BY_HIT = 1,
+        BOX_LEFT = 12,
+        BOX_TOP = 7,
+        BOX_RIGHT = 17,
+        BOX_BOTTOM = 26,
+        HIT_X = 12,
+        HIT_Y = 7,
+    };
+
+    static float Speed() { return ROCKET_SPEED; }
+    static Vec2 Velocity() { return Vec2(0.0f, -ROCKET_SPEED); }
+};
+
+//The sprite table TABLE shows at timeInSecs.
+template<TableId TABLE>
+inline ObjectType TableSprite(const int timeInSecs)
+{
+    return static_cast<ObjectType>((timeInSecs & 1) ?
+        TableTraits<TABLE>::SECOND_SPRITE : TableTraits<TABLE>::SPRITE);
+}
+
+//The pairs of tables that collide: projectiles of SHOTS hit objects of
+//TARGETS. CollideObjects takes them in this order.
+enum CollisionRule
+{
+    RULE_ROCKETS_ALIENS,
+    RULE_ROCKETS_BOMBS,//Rockets shoot bombs down.
+    RULE_BOMBS_PLAYER,
+    NUM_COLLISION_RULES,
+};
+
+template<CollisionRule RULE> struct RuleTraits;
+
+template<> struct RuleTraits<RULE_ROCKETS_ALIENS>
+{
+    static const TableId SHOTS = TABLE_ROCKETS;
+    static const TableId TARGETS = TABLE_ALIENS;
+};
+
+template<> struct RuleTraits<RULE_ROCKETS_BOMBS>
+{
+    static const TableId SHOTS = TABLE_ROCKETS;
+    static const TableId TARGETS = TABLE_BOMBS;
+};
+
+template<> struct RuleTraits<RULE_BOMBS_PLAYER>
+{
+    static const TableId SHOTS = TABLE_BOMBS;
+    static const TableId TARGETS = TABLE_PLAYER;
+};
+
+//Whether a projectile of table SHOTS at shot hits the object of table
+//TARGETS at target.
+template<TableId SHOTS, TableId TARGETS>
+inline bool ShotHits(const Position& shot, const Position& target)
+{
+    typedef TableTraits<SHOTS> Shots;
+    typedef TableTraits<TARGETS> Targets;
+#if defined(FIXED_POSITIONS)
+    const int dx = shot.rawX() + (Shots::HIT_X - Targets::BOX_LEFT) * FIXED_ONE - target.rawX();
+    const int dy = shot.rawY() + (Shots::HIT_Y - Targets::BOX_TOP) * FIXED_ONE - target.rawY();
+    return dx > 0 && dx < (Targets::BOX_RIGHT - Targets::BOX_LEFT) * FIXED_ONE &&
+        dy > 0 && dy < (Targets::BOX_BOTTOM - Targets::BOX_TOP) * FIXED_ONE;
+#else
+    const float rx = shot.x() + Shots::HIT_X;
+    const float ry = shot.y() + Shots::HIT_Y;
+
+    const float left = target.x() + Targets::BOX_LEFT;
+    const float top = target.y() + Targets::BOX_TOP;
+    const float right = target.x() + Targets::BOX_RIGHT;
+    const float bottom = target.y() + Targets::BOX_BOTTOM;
+
+    return (rx > left) && (rx < right) && (ry < bottom) && (ry > top);
+#endif
+}
+
+//Targets one ShotHitMask covers at most.
+const uint32_t HIT_MASK_BITS = 32;
+
+//Bit n is set if a projectile of table SHOTS at shot hits targets[n] of
+//table TARGETS, for n < count <= HIT_MASK_BITS.
+template<TableId SHOTS, TableId TARGETS>
+inline uint32_t ShotHitMask(const Position& shot,
+                            const Position* targets,
+                            const uint32_t count)
+{
+#if defined(FIXED_POSITIONS)
+    typedef TableTraits<SHOTS> Shots;
+    typedef TableTraits<TARGETS> Targets;
+    return FixedHitMask(shot.rawX() + (Shots::HIT_X - Targets::BOX_LEFT) * FIXED_ONE,
+                        shot.rawY() + (Shots::HIT_Y - Targets::BOX_TOP) * FIXED_ONE,
+                        targets, count,
+                        (Targets::BOX_RIGHT - Targets::BOX_LEFT) * FIXED_ONE,
+                        (Targets::BOX_BOTTOM - Targets::BOX_TOP) * FIXED_ONE);
+#else
+    uint32_t mask = 0;
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        mask |= static_cast<uint32_t>(ShotHits<SHOTS, TARGETS>(shot, targets[index])) << index;
+    }
+    return mask;
+#endif
+}
+
+//The projectile of table SHOTS at scene index shot touches the object of
+//table TARGETS at scene index target. A projectile that is spent by a hit
+//only makes the first, and a target that is destroyed by a hit only takes
+//the first. hit has a cleared flag for every object. Returns whether this
+//was a hit.
+template<TableId SHOTS, TableId TARGETS>
+inline bool RecordHit(const ObjectTable& targets,
+                      const uint32_t shot,
+                      const uint32_t target,
+                      SceneFlags& hit,
+                      int hitCounts[NUM_OBJECT_TYPES])
+{
+    if(TableTraits<SHOTS>::SPENT_BY_HIT && hit[shot])
+    {
+        return false;
+    }
+    if(TableTraits<TARGETS>::DESTROYED_BY_HIT)
+    {
+        if(hit[target])
+        {
+            return false;
+        }
+        hit[target] = 1;
+    }
+    hitCounts[targets.mType]++;
+    if(TableTraits<SHOTS>::SPENT_BY_HIT)
+    {
+        hit[shot] = 1;
+    }
+    return true;
+}
+
+//Rows [firstRow, lastRow) of table TABLE move with its velocity from
+//lastTime to newTime. With FIXED_POSITIONS the step is the difference of
+//the rounded distances at the two times, see FixedStepBetween, so the
+//aliens' drift of a pixel a second still moves at 60Hz and nothing moves
+//faster or slower with the frame rate.
+template<TableId TABLE>
+inline void MoveRows(ObjectTable& table,
+                     const uint32_t firstRow,
+                     const uint32_t lastRow,
+                     const float lastTime,
+                     const float newTime)
+{
+    if(!TableTraits<TABLE>::MOVES)
+    {
+        return;
+    }
+
+#if defined(FIXED_POSITIONS)
+    const Position step = Position::FromRaw(FixedStepBetween(table.mVelocity.x(), lastTime, newTime),
+                                            FixedStepBetween(table.mVelocity.y(), lastTime, newTime));
+    if(firstRow < lastRow)
+    {
+        AddFixedStep(&table.mPositions[firstRow], lastRow - firstRow, step);
+    }
+#else
+    const Position step = table.mVelocity * (newTime - lastTime);
+    for(uint32_t row = firstRow; row < lastRow; ++row)
+    {
+        table.mPositions[row] += step;
+    }
+#endif
+}
+
+//Flag the rows [firstRow, lastRow) of table TABLE that are outside the
+//window, by scene index from tableStart. culled has a cleared flag for
+//every object. Returns how many were flagged.
+template<TableId TABLE>
+inline uint32_t CullRows(const ObjectTable& table,
+                         const uint32_t tableStart,
+                         const uint32_t firstRow,
+                         const uint32_t lastRow,
+                         const int width, const int height,
+                         SceneFlags& culled,
+                         int cullCounts[NUM_OBJECT_TYPES])
+{
+    if(!TableTraits<TABLE>::CULLED)
+    {
+        return 0;
+    }
+
+    uint32_t numCulled = 0;
+    for(uint32_t row = firstRow; row < lastRow; ++row)
+    {
+        const Position& position = table.mPositions[row];
+        if(position.x() < -1 ||
+            position.x() > width+1 ||
+            position.y() < -1 ||
+            position.y() > height+1)
+        {
+            culled[tableStart + row] = 1;
+            numCulled++;
+        }
+    }
+    cullCounts[table.mType] += static_cast<int>(numCulled);
+    return numCulled;
+}
+
+#endif
@@ -0,0 +1,394 @@
+//Scaling of the chunked per-object passes of ParallelObjects.h.
+//Usage: ParallelBench [-objects N] [-rockets N] [-threads N] [-reps N]
+//Builds a stress scene of mostly aliens with some bombs and a stream of
+//rockets, then times each pass and a whole SimulateGame frame on 1 to N
+//threads (default: every hardware thread). 1 thread is the serial pass.
+//Columns: best time of -reps runs and speedup over 1 thread. Every run is
+//checked against the serial result, and Collide, the broadphase of
+//Broadphase.h, against AllPairs, every projectile against every target.
+//Neither is split over threads. Both are first run on small hand placed
+//scenes whose hits are known, and moving is checked to cover velocity
+//times time at 60Hz and 10Hz.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Game.h"
+#include "ParallelObjects.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+namespace
+{
+    const int SCENE_WIDTH = 4096;
+    const float FRAME_TIME = 1.0f / 60.0f;
+
+    //What a pass produced, to compare against the serial run.
+    struct PassResult
+    {
+        SceneObjectVector mObjects;
+        int mCounts[NUM_OBJECT_TYPES];
+        Box mBox;
+        uint32_t mChecksum;
+    };
+
+    typedef void (*PassFunc)(ThreadPool* pool, GameState& state, PassResult& result);
+
+    void MovePass(ThreadPool* pool, GameState& state, PassResult&)
+    {
+        ParallelMoveObjects(pool, state.mScene, FIRST_GENERIC_OBJECT, NumObjects(state.mScene),
+            state.mLastTime, state.mLastTime + FRAME_TIME);
+    }
+
+    void AnimatePass(ThreadPool* pool, GameState& state, PassResult&)
+    {
+        ParallelAnimate(pool, state.mScene, FIRST_GENERIC_OBJECT, NumObjects(state.mScene), 1);
+        AnimateSprites(state.mScene, 1);
+    }
+
+    void AlienBBoxPass(ThreadPool* pool, GameState& state, PassResult& result)
+    {
+        ParallelCalcAlienBBox(pool, state.mScene, state.mArena, result.mBox);
+    }
+
+    void CullPass(ThreadPool* pool, GameState& state, PassResult& result)
+    {
+        ParallelCullObjects(pool, state.mScene, state.mArena, state.mWindowWidth, state.mWindowHeight-state.HudWidth, result.mCounts);
+    }
+
+    void CollidePass(ThreadPool*, GameState& state, PassResult& result)
+    {
+        CollideObjects(state.mScene, state.mBroadphase, state.mArena, result.mCounts);
+    }
+
+    void AllPairsPass(ThreadPool*, GameState& state, PassResult& result)
+    {
+        CollideObjects(state.mScene, state.mArena, result.mCounts);
+    }
+
+    void FramePass(ThreadPool* pool, GameState& state, PassResult& result)
+    {
+        FrameInput input;
+        input.mTime = state.mLastTime + FRAME_TIME;
+        input.mKeys.fire = true;
+        input.mKeys.left = false;
+        input.mKeys.right = false;
+        input.mTimestamped = false;
+        input.mNumEvents = 0;
+        SimulateGame(state, input, pool);
+        result.mChecksum = ChecksumGameState(state);
+    }
+
+    struct Pass
+    {
+        const char* mName;
+        PassFunc mFunc;
+        bool mSameAsLast;//Has to match the pass before as well.
+    };
+
+    const Pass PASSES[] =
+    {
+        {"Move", MovePass, false},
+        {"Animate", AnimatePass, false},
+        {"AlienBBox", AlienBBoxPass, false},
+        {"Cull", CullPass, false},
+        {"AllPairs", AllPairsPass, false},
+        {"Collide", CollidePass, true},
+        {"SimulateGame", FramePass, false},
+    };
+}
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+//Aliens scattered over a tall playfield with bombs falling among them,
+//some already past the bottom, and numRockets rockets climbing through.
+//Nothing is near a wall, so every frame does the same work.
+static void BuildScene(GameState& state, uint32_t numObjects, uint32_t numRockets)
+{
+    const int height = state.mWindowHeight - state.HudWidth;
+    uint32_t random = 12345;
+
+    ResetLevel(state, 0.0f);
+    ResetScene(state.mScene);
+    SceneTables& scene = state.mScene;
+    CreateObjects(scene.mTables[TABLE_PLAYER], 1, Vec2(SCENE_WIDTH / 2.0f, static_cast<float>(height)), Vec2(0, 0));
+
+    const uint32_t numAliens = (numObjects - 1 - numRockets) * 9 / 10;
+    for(uint32_t index = 1; index < numObjects; ++index)
+    {
+        const float x = static_cast<float>(F_SPRITE_SIZE + NextRandom(random) % (SCENE_WIDTH - 3 * SPRITE_SIZE));
+        if(index <= numAliens)
+        {
+            const float y = static_cast<float>(SPRITE_SIZE + NextRandom(random) % (height - 3 * SPRITE_SIZE));
+            CreateObjects(scene.mTables[TABLE_ALIENS], 1, Vec2(x, y), Vec2(0, 0));
+        }
+        else if(index < numObjects - numRockets)
+        {
+            //One in twenty is below the bottom and gets culled.
+            const float y = static_cast<float>(NextRandom(random) % (height + height / 20));
+            CreateObjects(scene.mTables[TABLE_BOMBS], 1, Vec2(x, y), Vec2(0, 0));
+        }
+        else
+        {
+            const float y = static_cast<float>(NextRandom(random) % height);
+            CreateObjects(scene.mTables[TABLE_ROCKETS], 1, Vec2(x, y), Vec2(0, 0));
+        }
+    }
+}
+
+//A bomb just above the player with a rocket climbing into it, and if
+//bAlien an alien the rocket reaches in the same frame. The rocket is spent
+//on the alien if there is one, and the bomb hits the player; otherwise it
+//shoots the bomb down before the bomb can. Returns the number of
+//collision passes whose hits are not those.
+static uint32_t CheckRocketMeetsBomb(const bool bAlien)
+{
+    GameState state(640, 480 + GameState::HudWidth);
+    ResetLevel(state, 0.0f);
+    ResetScene(state.mScene);
+    SceneTables& scene = state.mScene;
+
+    CreateObjects(scene.mTables[TABLE_PLAYER], 1, Vec2(100.0f, 400.0f), Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_BOMBS], 1, Vec2(100.0f, 395.0f), Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ROCKETS], 1, Vec2(100.0f, 400.0f), Vec2(0, 0));
+    if(bAlien)
+    {
+        CreateObjects(scene.mTables[TABLE_ALIENS], 1, Vec2(100.0f, 390.0f), Vec2(0, 0));
+    }
+
+    int expected[NUM_OBJECT_TYPES] = {0};
+    expected[scene.mTables[TABLE_ALIENS].mType] = bAlien;
+    expected[BOMB] = !bAlien;
+    expected[PLAYER] = bAlien;
+
+    uint32_t mismatches = 0;
+    for(uint32_t pass = 0; pass < 2; ++pass)
+    {
+        GameState run = state;
+        int counts[NUM_OBJECT_TYPES] = {0};
+        if(pass == 0)
+        {
+            CollideObjects(run.mScene, run.mArena, counts);
+        }
+        else
+        {
+            CollideObjects(run.mScene, run.mBroadphase, run.mArena, counts);
+        }
+
+        if(std::memcmp(counts, expected, sizeof(counts)) != 0)
+        {
+            std::printf("%s: a rocket meeting a bomb above the player%s hits the wrong objects\n",
+                pass == 0 ? "AllPairs" : "Collide", bAlien ? " under an alien" : "");
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+//A rocket overlapping two aliens destroys one. Returns the number of
+//collision passes that destroy a different number.
+static uint32_t CheckRocketBetweenAliens()
+{
+    GameState state(640, 480 + GameState::HudWidth);
+    ResetLevel(state, 0.0f);
+    ResetScene(state.mScene);
+    SceneTables& scene = state.mScene;
+
+    CreateObjects(scene.mTables[TABLE_PLAYER], 1, Vec2(300.0f, 400.0f), Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ALIENS], 1, Vec2(100.0f, 190.0f), Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ALIENS], 1, Vec2(105.0f, 195.0f), Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ROCKETS], 1, Vec2(100.0f, 200.0f), Vec2(0, 0));
+
+    uint32_t mismatches = 0;
+    for(uint32_t pass = 0; pass < 2; ++pass)
+    {
+        GameState run = state;
+        int counts[NUM_OBJECT_TYPES] = {0};
+        if(pass == 0)
+        {
+            CollideObjects(run.mScene, run.mArena, counts);
+        }
+        else
+        {
+            CollideObjects(run.mScene, run.mBroadphase, run.mArena, counts);
+        }
+
+        if(counts[scene.mTables[TABLE_ALIENS].mType] != 1)
+        {
+            std::printf("%s: a rocket between two aliens destroys %d\n",
+                pass == 0 ? "AllPairs" : "Collide", counts[scene.mTables[TABLE_ALIENS].mType]);
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+//Whether position moved from start by distance, to within half a step of
+//a FixedVec2.
+static bool MovedBy(const Position& position, const Vec2& start, const Vec2& distance)
+{
+    const float tolerance = 0.5f / 8;
+    return std::fabs(position.x() - start.x() - distance.x()) <= tolerance &&
+        std::fabs(position.y() - start.y() - distance.y()) <= tolerance;
+}
+
+//Two seconds of frames at frameRate, with the player holding right. Every
+//table has to cover its velocity times the time, whatever the frame rate,
+//down to the aliens' drift of a pixel a second. Returns the number of
+//tables that do not.
+static uint32_t CheckMoveDistance(const int frameRate)
+{
+    GameState state(640, 480 + GameState::HudWidth);
+    ResetLevel(state, 0.0f);
+    ResetScene(state.mScene);
+    SceneTables& scene = state.mScene;
+
+    const Vec2 start(100.0f, 200.0f);
+    CreateObjects(scene.mTables[TABLE_PLAYER], 1, start, Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ALIENS], 1, start, Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_BOMBS], 1, start, Vec2(0, 0));
+    CreateObjects(scene.mTables[TABLE_ROCKETS], 1, start, Vec2(0, 0));
+
+    IDiceInvaders::KeyStatus keys;
+    keys.fire = false;
+    keys.left = false;
+    keys.right = true;
+
+    float time = 0.0f;
+    for(int frame = 0; frame < 2 * frameRate; ++frame)
+    {
+        const float newTime = static_cast<float>(frame + 1) / frameRate;
+        MoveObjects(scene, time, newTime);
+        ProcessKeyboardInput(state, keys, time, newTime);
+        time = newTime;
+    }
+
+    uint32_t mismatches = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        Vec2 velocity = table == TABLE_PLAYER ? Vec2(PLAYER_SPEED, 0.0f) : scene.mTables[table].mVelocity;
+        if(!MovedBy(scene.mTables[table].mPositions[0], start, velocity * time))
+        {
+            std::printf("Move: table %u at %dHz is %.3f, %.3f from where it started, not %.3f, %.3f\n",
+                table, frameRate,
+                scene.mTables[table].mPositions[0].x() - start.x(),
+                scene.mTables[table].mPositions[0].y() - start.y(),
+                velocity.x() * time, velocity.y() * time);
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+static void ClearResult(PassResult& result)
+{
+    for(int i=0; i<NUM_OBJECT_TYPES;++i)
+    {
+        result.mCounts[i] = 0;
+    }
+    std::memset(&result.mBox, 0, sizeof(result.mBox));
+    result.mChecksum = 0;
+}
+
+static bool SameResult(const PassResult& a, const PassResult& b)
+{
+    return a.mObjects.size() == b.mObjects.size() &&
+        (a.mObjects.empty() ||
+            std::memcmp(&a.mObjects[0], &b.mObjects[0], a.mObjects.size() * sizeof(SceneObjectData)) == 0) &&
+        std::memcmp(a.mCounts, b.mCounts, sizeof(a.mCounts)) == 0 &&
+        std::memcmp(&a.mBox, &b.mBox, sizeof(a.mBox)) == 0 &&
+        a.mChecksum == b.mChecksum;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t numObjects = GetOptionInt(argc, argv, "-objects", 200000);
+    const uint32_t numRockets = GetOptionInt(argc, argv, "-rockets", 64);
+    const uint32_t maxThreads = GetOptionInt(argc, argv, "-threads", GetHardwareThreadCount());
+    const uint32_t numReps = GetOptionInt(argc, argv, "-reps", 20);
+
+    //Aliens cover about a quarter of the playfield.
+    const int height = static_cast<int>(static_cast<uint64_t>(numObjects) * SPRITE_SIZE * SPRITE_SIZE * 4 / SCENE_WIDTH);
+    GameState scene(SCENE_WIDTH, std::max(height, 720) + GameState::HudWidth);
+    BuildScene(scene, std::max(numObjects, numRockets + 2), numRockets);
+    //Every run starts from the order of the frame before, as in a game.
+    scene.mBroadphase.update(scene.mScene);
+
+    std::printf("%u objects, %u rockets, %u hardware threads, chunks of %u, serial below %u objects\n",
+        NumObjects(scene.mScene), numRockets, GetHardwareThreadCount(),
+        PARALLEL_OBJECT_CHUNK, PARALLEL_MIN_OBJECTS);
+    std::printf("%-14s %8s %10s %8s\n", "pass", "threads", "best ms", "speedup");
+
+    uint32_t mismatches = CheckRocketMeetsBomb(false) + CheckRocketMeetsBomb(true) +
+        CheckRocketBetweenAliens() + CheckMoveDistance(60) + CheckMoveDistance(10);
+    PassResult lastReference;
+    for(uint32_t passIndex = 0; passIndex < sizeof(PASSES) / sizeof(PASSES[0]); ++passIndex)
+    {
+        const Pass& pass = PASSES[passIndex];
+        PassResult reference;
+        double serialTime = 0.0;
+
+        for(uint32_t numThreads = 1; numThreads <= std::max(maxThreads, 1u); ++numThreads)
+        {
+            ThreadPool pool(numThreads - 1);
+            uint64_t bestTime = ~0ull;
+
+            for(uint32_t rep = 0; rep < numReps; ++rep)
+            {
+                GameState state = scene;
+                PassResult result;
+                ClearResult(result);
+
+                const uint64_t start = GetTimeNanoseconds();
+                pass.mFunc(&pool, state, result);
+                bestTime = std::min(bestTime, GetTimeNanoseconds() - start);
+
+                FlattenScene(state.mScene, result.mObjects);
+                if(numThreads == 1 && rep == 0)
+                {
+                    reference = result;
+                    if(pass.mSameAsLast && !SameResult(result, lastReference))
+                    {
+                        ++mismatches;
+                    }
+                }
+                else if(!SameResult(result, reference))
+                {
+                    ++mismatches;
+                }
+            }
+
+            const double bestMs = NanosecondsToMilliseconds(bestTime);
+            if(numThreads == 1)
+            {
+                serialTime = bestMs;
+            }
+            std::printf("%-14s %8u %10.3f %8.2f\n", pass.mName, numThreads, bestMs,
+                bestMs > 0.0 ? serialTime / bestMs : 0.0);
+        }
+        lastReference = reference;
+    }
+
+    if(mismatches)
+    {
+        std::printf("%u runs differ from the serial pass\n", mismatches);
+        return 1;
+    }
+    std::printf("every run matches the serial pass\n");
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "ParallelObjects.h"
+#include "ObjectTraits.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+    //What one chunk adds up. Each chunk writes only its own.
+    struct ChunkResult
+    {
+        ChunkResult()
+        {
+            for(int i=0; i<NUM_OBJECT_TYPES;++i)
+            {
+                mCounts[i] = 0;
+            }
+            mBox.mBottom = 0.0f;
+            mBox.mTop = 100000.0f;
+            mBox.mLeft = 100000.0f;
+            mBox.mRight = 0.0f;
+        }
+
+        int mCounts[NUM_OBJECT_TYPES];
+        Box mBox;
+    };
+
+    struct PassContext
+    {
+        SceneTables* mScene;
+        uint32_t mBegin;//Scene index of item 0.
+        uint32_t mTableStarts[NUM_TABLES + 1];
+        float mLastTime;
+        float mNewTime;
+        int mTimeInSecs;
+        int mWidth;
+        int mHeight;
+        ArenaSpan<ChunkResult>* mChunks;
+        SceneFlags* mFlags;
+    };
+
+    bool UseThreads(const ThreadPool* pool, const uint32_t count)
+    {
+        return pool && pool->getNumThreads() > 1 && count >= PARALLEL_MIN_OBJECTS;
+    }
+
+    uint32_t NumChunks(const uint32_t count)
+    {
+        return (count + PARALLEL_OBJECT_CHUNK - 1) / PARALLEL_OBJECT_CHUNK;
+    }
+
+    void InitPass(PassContext& pass, SceneTables& scene, const uint32_t begin)
+    {
+        pass.mScene = &scene;
+        pass.mBegin = begin;
+        TableStarts(scene, pass.mTableStarts);
+        pass.mChunks = 0;
+        pass.mFlags = 0;
+    }
+
+    ChunkResult& ResultOf(const PassContext& pass, const uint32_t begin)
+    {
+        return (*pass.mChunks)[begin / PARALLEL_OBJECT_CHUNK];
+    }
+
+    //Rows of table within the chunk's items [begin, end).
+    void ChunkRows(const PassContext& pass, const uint32_t table,
+                   const uint32_t begin, const uint32_t end,
+                   uint32_t& firstRow, uint32_t& lastRow)
+    {
+        const uint32_t tableStart = pass.mTableStarts[table];
+        const uint32_t tableEnd = pass.mTableStarts[table + 1];
+        const uint32_t first = std::min(std::max(pass.mBegin + begin, tableStart), tableEnd);
+        const uint32_t last = std::max(std::min(pass.mBegin + end, tableEnd), first);
+        firstRow = first - tableStart;
+        lastRow = last - tableStart;
+    }
+
+    void MoveChunk(void* context, uint32_t begin, uint32_t end)
+    {
+        const PassContext& pass = *static_cast<PassContext*>(context);
+        MoveObjectRange(*pass.mScene, pass.mBegin + begin, pass.mBegin + end, pass.mLastTime, pass.mNewTime);
+    }
+
+    void AnimateChunk(void* context, uint32_t begin, uint32_t end)
+    {
+        const PassContext& pass = *static_cast<PassContext*>(context);
+        AnimateRange(*pass.mScene, pass.mBegin + begin, pass.mBegin + end, pass.mTimeInSecs);
+    }
+
+    struct BoxContext
+    {
+        const PositionVector* mAliens;
+        ArenaSpan<ChunkResult>* mChunks;
+    };
+
+    void AlienBBoxChunk(void* context, uint32_t begin, uint32_t end)
+    {
+        const BoxContext& pass = *static_cast<BoxContext*>(context);
+        const PositionVector& aliens = *pass.mAliens;
+        Box& box = (*pass.mChunks)[begin / PARALLEL_OBJECT_CHUNK].mBox;
+
+        for(uint32_t row = begin; row < end; ++row)
+        {
+            box.mBottom = std::max(box.mBottom, aliens[row].y());
+            box.mTop = std::min(box.mTop, aliens[row].y()-SPRITE_SIZE);
+            box.mLeft = std::min(box.mLeft, aliens[row].x());
+            box.mRight = std::max(box.mRight, aliens[row].x()+SPRITE_SIZE);
+        }
+    }
+
+    template<TableId TABLE>
+    void CullChunkTable(const PassContext& pass, const uint32_t begin, const uint32_t end, int* counts)
+    {
+        uint32_t firstRow, lastRow;
+        ChunkRows(pass, TABLE, begin, end, firstRow, lastRow);
+        SceneFlags& culled = *pass.mFlags;
+        CullRows<TABLE>(pass.mScene->mTables[TABLE], pass.mTableStarts[TABLE], firstRow, lastRow,
+            pass.mWidth, pass.mHeight, culled, counts);
+    }
+
+    void CullChunk(void* context, uint32_t begin, uint32_t end)
+    {
+        const PassContext& pass = *static_cast<PassContext*>(context);
+        int* counts = ResultOf(pass, begin).mCounts;
+
+        CullChunkTable<TABLE_ALIENS>(pass, begin, end, counts);
+        CullChunkTable<TABLE_BOMBS>(pass, begin, end, counts);
+        CullChunkTable<TABLE_ROCKETS>(pass, begin, end, counts);
+    }
+}
+
+void ParallelMoveObjects(ThreadPool* pool,
+                         SceneTables& scene,
+                         const uint32_t begin,
+                         const uint32_t end,
+                         const float lastTime,
+                         const float newTime)
+{
+    if(begin >= end || !UseThreads(pool, end - begin))
+    {
+        MoveObjectRange(scene, begin, end, lastTime, newTime);
+        return;
+    }
+
+    PassContext pass;
+    InitPass(pass, scene, begin);
+    pass.mLastTime = lastTime;
+    pass.mNewTime = newTime;
+    pool->parallelFor(end - begin, PARALLEL_OBJECT_CHUNK, MoveChunk, &pass);
+}
+
+void ParallelAnimate(ThreadPool* pool,
+                     SceneTables& scene,
+                     const uint32_t begin,
+                     const uint32_t end,
+                     const int timeInSecs)
+{
+    if(begin >= end || !UseThreads(pool, end - begin))
+    {
+        AnimateRange(scene, begin, end, timeInSecs);
+        return;
+    }
+
+    PassContext pass;
+    InitPass(pass, scene, begin);
+    pass.mTimeInSecs = timeInSecs;
+    pool->parallelFor(end - begin, PARALLEL_OBJECT_CHUNK, AnimateChunk, &pass);
+}
+
+void ParallelCalcAlienBBox(ThreadPool* pool,
+                           const SceneTables& scene,
+                           FrameArena& arena,
+                           Box& box)
+{
+    const uint32_t count = static_cast<uint32_t>(scene.mTables[TABLE_ALIENS].mPositions.size());
+    if(!UseThreads(pool, count))
+    {
+        CalcAlienBBox(scene, box);
+        return;
+    }
+
+    ArenaSpan<ChunkResult> chunks = arena.allocate(NumChunks(count), ChunkResult());
+    BoxContext pass;
+    pass.mAliens = &scene.mTables[TABLE_ALIENS].mPositions;
+    pass.mChunks = &chunks;
+    pool->parallelFor(count, PARALLEL_OBJECT_CHUNK, AlienBBoxChunk, &pass);
+
+    //Minimum and maximum come out the same whatever order they are taken in.
+    box = chunks[0].mBox;
+    for(uint32_t chunk = 1; chunk < chunks.size(); ++chunk)
+    {
+        const Box& other = chunks[chunk].mBox;
+        box.mBottom = std::max(box.mBottom, other.mBottom);
+        box.mTop = std::min(box.mTop, other.mTop);
+        box.mLeft = std::min(box.mLeft, other.mLeft);
+        box.mRight = std::max(box.mRight, other.mRight);
+    }
+}
+
+void ParallelCullObjects(ThreadPool* pool,
+                         SceneTables& scene,
+                         FrameArena& arena,
+                         const int width, const int height,
+                         int cullCounts[NUM_OBJECT_TYPES])
+{
+    if(!UseThreads(pool, NumObjects(scene)))
+    {
+        CullObjects(scene, arena, width, height, cullCounts);
+        return;
+    }
+
+    DeleteDestroyedObjects(scene, cullCounts);
+
+    const uint32_t count = NumObjects(scene);
+    const uint32_t firstAlien = TableStart(scene, TABLE_ALIENS);
+    ArenaSpan<ChunkResult> chunks = arena.allocate(NumChunks(count - firstAlien), ChunkResult());
+    SceneFlags culled = arena.allocate<uint8_t>(count, 0);
+    PassContext pass;
+    InitPass(pass, scene, firstAlien);
+    pass.mWidth = width;
+    pass.mHeight = height;
+    pass.mChunks = &chunks;
+    pass.mFlags = &culled;
+    pool->parallelFor(count - firstAlien, PARALLEL_OBJECT_CHUNK, CullChunk, &pass);
+
+    uint32_t numCulled = 0;
+    for(uint32_t chunk = 0; chunk < chunks.size(); ++chunk)
+    {
+        for(int i=0; i<NUM_OBJECT_TYPES;++i)
+        {
+            cullCounts[i] += chunks[chunk].mCounts[i];
+            numCulled += chunks[chunk].mCounts[i];
+        }
+    }
+
+    RemoveCulledObjects(scene, culled, numCulled, arena);
+}
@@ -0,0 +1,54 @@
+#ifndef PARALLEL_OBJECTS_H
+#define PARALLEL_OBJECTS_H
+
+#include "SceneObject.h"
+
+class ThreadPool;
+
+//Objects per chunk: 4096 positions of 8 bytes is 32KB, which stays in a
+//core's L1/L2 while the chunk is worked on and is far more than enough
+//work to pay for handing the chunk to a thread.
+const uint32_t PARALLEL_OBJECT_CHUNK = 4096;
+
+//Scenes with fewer objects run every pass on the calling thread. Below
+//this a pass takes less time than waking the workers.
+const uint32_t PARALLEL_MIN_OBJECTS = 16384;
+
+//The passes of SceneObject.h split into chunks of PARALLEL_OBJECT_CHUNK
+//objects on a ThreadPool. Each chunk reduces into its own bounding box or
+//counts, which are added up once every chunk is done. The results are
+//exactly those of the serial passes, object order included. pool may be
+//null, and small scenes do not use it, in which case these call the
+//serial passes. Chunk results and flags come from the caller's arena
+//before the workers start. Workers only write into them, so they need no
+//arena of their own.
+void ParallelMoveObjects(ThreadPool* pool,
+                         SceneTables& scene,
+                         const uint32_t begin,
+                         const uint32_t end,
+                         const float lastTime,
+                         const float newTime);
+
+//AnimateRange. AnimateSprites still follows.
+void ParallelAnimate(ThreadPool* pool,
+                     SceneTables& scene,
+                     const uint32_t begin,
+                     const uint32_t end,
+                     const int timeInSecs);
+
+void ParallelCalcAlienBBox(ThreadPool* pool,
+                           const SceneTables& scene,
+                           FrameArena& arena,
+                           Box& box);
+
+//The bounds test runs in parallel. RemoveCulledObjects is serial.
+void ParallelCullObjects(ThreadPool* pool,
+                         SceneTables& scene,
+                         FrameArena& arena,
+                         const int width, const int height,
+                         int cullCounts[NUM_OBJECT_TYPES]);
+
+//Collisions are not split: the broadphase of Broadphase.h does less work
+//on one thread than every projectile against every target does on many.
+
+#endif
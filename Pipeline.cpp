@@ -0,0 +1,176 @@
+#include "Pipeline.h"
+#include "Atomics.h"
+#include "FrameLimiter.h"
+#include "Latency.h"
+#include "LiveState.h"
+#include "Replay.h"
+#include "SpscQueue.h"
+#include "Threading.h"
+
+namespace
+{
+    //What the renderer needs from one simulated frame. This copy is the
+    //only game data the two threads share.
+    struct RenderFrame
+    {
+        SceneTables mScene;
+        HudText mHud;
+        int mPlayerLives;
+    };
+
+    struct Pipeline
+    {
+        Pipeline(GameState& state, ReplayWriter* recorder, LiveStateWriter* exporter) : mState(state),
+            mRecorder(recorder),
+            mExporter(exporter),
+            mQuit(0)
+        {
+        }
+
+        GameState& mState;//Owned by the simulation thread until it exits.
+        ReplayWriter* mRecorder;//Likewise.
+        LiveStateWriter* mExporter;//Likewise.
+
+        //Render thread -> simulation thread.
+        SpscQueue<FrameInput, 2> mInputs;
+
+        //Simulation thread -> render thread. Two slots so one frame can be
+        //drawn while the next one is written.
+        SpscQueue<RenderFrame, 2> mFrames;
+
+        volatile int32_t mQuit;
+    };
+}
+
+static void CaptureRenderFrame(const GameState& state,
+                               RenderFrame& frame)
+{
+    //Assignment reuses the slot's capacity, so no allocation once the
+    //slots have grown to the largest scene.
+    frame.mScene = state.mScene;
+    frame.mHud = state.mHud;
+    frame.mPlayerLives = state.mPlayerLives;
+}
+
+static void SimulationThread(void* context)
+{
+    Pipeline& pipeline = *static_cast<Pipeline*>(context);
+    GameState& state = pipeline.mState;
+
+    UpdateHud(state, 0.0f);
+
+    for(;;)
+    {
+        RenderFrame* frame;
+        while(!(frame = pipeline.mFrames.beginPush()))
+        {
+            if(AtomicLoad(&pipeline.mQuit))
+            {
+                return;
+            }
+            ThreadYield();
+        }
+
+        CaptureRenderFrame(state, *frame);
+        pipeline.mFrames.endPush();
+
+        //The renderer stops when it sees a frame without lives.
+        if(!state.mPlayerLives)
+        {
+            return;
+        }
+
+        FrameInput input;
+        while(!pipeline.mInputs.pop(input))
+        {
+            if(AtomicLoad(&pipeline.mQuit))
+            {
+                return;
+            }
+            ThreadYield();
+        }
+
+        if(pipeline.mRecorder)
+        {
+            pipeline.mRecorder->record(state, input);
+        }
+
+        const float deltaTimeInSecs = input.mTime - state.mLastTime;
+        if(pipeline.mExporter)
+        {
+            uint32_t phaseTimes[NUM_SIMULATION_PHASES];
+            SimulateGame(state, input, 0, phaseTimes);
+            pipeline.mExporter->publish(state, phaseTimes);
+        }
+        else
+        {
+            SimulateGame(state, input);
+        }
+        UpdateHud(state, deltaTimeInSecs);
+    }
+}
+
+bool RunPipelinedGame(IDiceInvaders* system,
+                      InputSampler* sampler,
+                      ReplayWriter* recorder,
+                      LiveStateWriter* exporter,
+                      FrameLimiter& limiter,
+                      GameState& state)
+{
+    Pipeline pipeline(state, recorder, exporter);
+
+    Thread simulation;
+    if(!simulation.start(SimulationThread, &pipeline))
+    {
+        return true;//Caller falls back to the serial loop.
+    }
+
+    bool bSystemOK = true;
+    for(;;)
+    {
+        //Input for frame N+1 is sampled before drawing frame N, the same
+        //order as GameScreen.
+        FrameInput input;
+        SampleFrameInput(system, sampler, input);
+        while(!pipeline.mInputs.push(input))
+        {
+            ThreadYield();
+        }
+
+        RenderFrame* frame;
+        while(!(frame = pipeline.mFrames.front()))
+        {
+            ThreadYield();
+        }
+
+        if(!frame->mPlayerLives)
+        {
+            pipeline.mFrames.pop();
+            break;
+        }
+
+        //Sprites and window size are never written after InitLevel so
+        //they are safe to read while the simulation runs.
+        DrawGame(system,
+            state.mSprites,
+            state.mWindowWidth,
+            state.mWindowHeight,
+            frame->mScene,
+            frame->mHud,
+            frame->mPlayerLives);
+        pipeline.mFrames.pop();
+
+        bSystemOK = system->update();
+        LatencyMark(LATENCY_PRESENTED);
+        if(!bSystemOK)
+        {
+            break;
+        }
+
+        limiter.wait();
+    }
+
+    AtomicStore(&pipeline.mQuit, 1);
+    simulation.join();
+    return bSystemOK;
+}
@@ -0,0 +1,26 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Game.h"
+
+class FrameLimiter;
+class LiveStateWriter;
+class ReplayWriter;
+
+//Run the game with simulation and rendering on separate threads until
+//the player has no lives left or the window is closed. The calling thread
+//samples input, draws frame N and calls update() while a simulation thread
+//produces frame N+1. Frames are handed over through a lock-free double
+//buffer. Given the same FrameInput sequence the game plays out exactly as
+//with GameScreen. sampler may be null to poll the keys once per frame.
+//recorder and exporter, if not null, are written by the simulation
+//thread. limiter paces the calling thread after each update(). Returns
+//the last result of system->update().
+bool RunPipelinedGame(IDiceInvaders* system,
+                      InputSampler* sampler,
+                      ReplayWriter* recorder,
+                      LiveStateWriter* exporter,
+                      FrameLimiter& limiter,
+                      GameState& state);
+
+#endif
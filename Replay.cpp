@@ -0,0 +1,660 @@
+#include "Replay.h"
+#include "FastForward.h"
+#include "FrameLimiter.h"
+#include "Log.h"
+#include "ServerProtocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint32_t KEY_RUN_TIMESTAMPED = 1 << 3;
+    const uint32_t KEY_RUN_EVENTS = 1 << 4;
+    const uint32_t KEY_RUN_LENGTH_SHIFT = 5;
+
+    uint32_t FloatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float BitsFloat(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint32_t Zigzag(uint32_t value)
+    {
+        return (value << 1) ^ (0u - (value >> 31));
+    }
+
+    uint32_t Unzigzag(uint32_t value)
+    {
+        return (value >> 1) ^ (0u - (value & 1));
+    }
+
+    void WriteVarint(uint64_t value, std::vector<uint8_t>& out)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+    {
+        value = 0;
+        for(uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            if(data == end)
+            {
+                return false;
+            }
+            const uint8_t byte = *data++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename T>
+    void Append(const T& value, std::vector<uint8_t>& out)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+}
+
+ReplayWriter::ReplayWriter() : mFile(0),
+    mError(false),
+    mKeyframeInterval(REPLAY_KEYFRAME_INTERVAL),
+    mKeyRunHeader(0),
+    mKeyRunLength(0),
+    mTimeRunLength(0),
+    mLastTimeBits(0),
+    mLastTimeDelta(0)
+{
+    std::memset(&mHeader, 0, sizeof(mHeader));
+    std::memset(&mBlock, 0, sizeof(mBlock));
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    //A recording that was never closed keeps its zeroed header, which
+    //readers reject.
+    if(mFile)
+    {
+        std::fclose(mFile);
+    }
+}
+
+bool ReplayWriter::open(const char* path,
+                        int windowWidth,
+                        int windowHeight,
+                        uint32_t keyframeInterval)
+{
+    mFile = std::fopen(path, "wb");
+    if(!mFile)
+    {
+        return false;
+    }
+
+    std::memset(&mHeader, 0, sizeof(mHeader));
+    mHeader.mWindowWidth = windowWidth;
+    mHeader.mWindowHeight = windowHeight;
+    mKeyframeInterval = std::max(keyframeInterval, 1u);
+    mIndex.clear();
+    mError = false;
+
+    //Placeholder until close fills in the real header.
+    const ReplayHeader empty = ReplayHeader();
+    mError = std::fwrite(&empty, sizeof(empty), 1, mFile) != 1;
+    return !mError;
+}
+
+void ReplayWriter::record(const GameState& state, const FrameInput& input)
+{
+    if(!mFile)
+    {
+        return;
+    }
+
+    if(mHeader.mNumFrames % mKeyframeInterval == 0)
+    {
+        if(mHeader.mNumFrames)
+        {
+            writeBlock();
+        }
+        beginBlock(state, input);
+    }
+
+    uint32_t header = PackKeys(input.mKeys);
+    if(input.mTimestamped)
+    {
+        header |= KEY_RUN_TIMESTAMPED;
+    }
+
+    const uint32_t timeBits = FloatBits(input.mTime);
+
+    if(input.mTimestamped && input.mNumEvents)
+    {
+        endKeyRun();
+        WriteVarint((1u << KEY_RUN_LENGTH_SHIFT) | header | KEY_RUN_EVENTS, mKeys);
+
+        WriteVarint(input.mNumEvents, mEvents);
+        for(uint32_t index = 0; index < input.mNumEvents; ++index)
+        {
+            const InputEvent& event = input.mEvents[index];
+            WriteVarint(Zigzag(FloatBits(event.mTime) - timeBits), mEvents);
+            mEvents.push_back(PackKeys(event.mKeys));
+        }
+    }
+    else if(mKeyRunLength && header == mKeyRunHeader)
+    {
+        ++mKeyRunLength;
+    }
+    else
+    {
+        endKeyRun();
+        mKeyRunHeader = header;
+        mKeyRunLength = 1;
+    }
+
+    //Float bits of a steadily increasing time grow by nearly the same
+    //amount each frame, so the change in delta is small, and zero with a
+    //fixed step.
+    const uint32_t delta = timeBits - mLastTimeBits;
+    const uint32_t change = delta - mLastTimeDelta;
+    if(change == 0)
+    {
+        ++mTimeRunLength;
+    }
+    else
+    {
+        endTimeRun();
+        WriteVarint(static_cast<uint64_t>(Zigzag(change)) << 1, mTimes);
+    }
+    mLastTimeBits = timeBits;
+    mLastTimeDelta = delta;
+
+    ++mBlock.mNumFrames;
+    ++mHeader.mNumFrames;
+}
+
+bool ReplayWriter::close(const GameState& state)
+{
+    if(!mFile)
+    {
+        return false;
+    }
+
+    if(mBlock.mNumFrames)
+    {
+        writeBlock();
+    }
+
+    mHeader.mMagic = REPLAY_MAGIC;
+    mHeader.mVersion = REPLAY_VERSION;
+    mHeader.mNumBlocks = static_cast<uint32_t>(mIndex.size());
+    mHeader.mIndexOffset = static_cast<uint32_t>(std::ftell(mFile));
+    mHeader.mFinalChecksum = ChecksumGameState(state);
+
+    if(!mIndex.empty() &&
+        std::fwrite(&mIndex[0], sizeof(ReplayIndexEntry), mIndex.size(), mFile) != mIndex.size())
+    {
+        mError = true;
+    }
+
+    if(std::fseek(mFile, 0, SEEK_SET) != 0 ||
+        std::fwrite(&mHeader, sizeof(mHeader), 1, mFile) != 1)
+    {
+        mError = true;
+    }
+
+    if(std::fclose(mFile) != 0)
+    {
+        mError = true;
+    }
+    mFile = 0;
+    return !mError;
+}
+
+uint32_t ReplayWriter::getFrameCount() const
+{
+    return mHeader.mNumFrames;
+}
+
+void ReplayWriter::beginBlock(const GameState& state, const FrameInput& input)
+{
+    mBlock.mFirstFrame = mHeader.mNumFrames;
+    mBlock.mNumFrames = 0;
+    mBlock.mFirstTime = FloatBits(input.mTime);
+
+    ReplayKeyframe keyframe;
+    keyframe.mPlayerScore = state.mPlayerScore;
+    keyframe.mPlayerLives = state.mPlayerLives;
+    keyframe.mLastTime = state.mLastTime;
+    keyframe.mFloorLastTime = state.mFloorLastTime;
+    keyframe.mTimeOfLastFire = state.mTimeOfLastFire;
+    keyframe.mFireKeyWasDown = state.mFireKeyWasDown;
+    keyframe.mRandom = state.mRandom;
+    keyframe.mHeldKeys = PackKeys(state.mHeldKeys);
+    SceneObjectVector objects;
+    FlattenScene(state.mScene, objects);
+    keyframe.mNumObjects = static_cast<uint32_t>(objects.size());
+
+    mKeyframe.clear();
+    Append(keyframe, mKeyframe);
+    for(size_t index = 0; index < objects.size(); ++index)
+    {
+        const SceneObjectData& source = objects[index];
+        ReplayObject object;
+        object.mType = source.mType;
+        object.mX = source.mPosition.x();
+        object.mY = source.mPosition.y();
+        object.mVelocityX = source.mVelocity.x();
+        object.mVelocityY = source.mVelocity.y();
+        Append(object, mKeyframe);
+    }
+
+    mKeys.clear();
+    mTimes.clear();
+    mEvents.clear();
+    mKeyRunLength = 0;
+    mTimeRunLength = 0;
+    mLastTimeBits = mBlock.mFirstTime;
+    mLastTimeDelta = 0;
+}
+
+void ReplayWriter::endKeyRun()
+{
+    if(mKeyRunLength)
+    {
+        WriteVarint((static_cast<uint64_t>(mKeyRunLength) << KEY_RUN_LENGTH_SHIFT) | mKeyRunHeader, mKeys);
+        mKeyRunLength = 0;
+    }
+}
+
+void ReplayWriter::endTimeRun()
+{
+    if(mTimeRunLength)
+    {
+        WriteVarint((static_cast<uint64_t>(mTimeRunLength) << 1) | 1, mTimes);
+        mTimeRunLength = 0;
+    }
+}
+
+void ReplayWriter::writeBlock()
+{
+    endKeyRun();
+    endTimeRun();
+
+    mBlock.mKeySize = static_cast<uint32_t>(mKeys.size());
+    mBlock.mTimeSize = static_cast<uint32_t>(mTimes.size());
+    mBlock.mEventSize = static_cast<uint32_t>(mEvents.size());
+
+    ReplayIndexEntry entry;
+    entry.mFirstFrame = mBlock.mFirstFrame;
+    entry.mOffset = static_cast<uint32_t>(std::ftell(mFile));
+    mIndex.push_back(entry);
+
+    //Keep the next block 4 byte aligned so its headers can be read in place.
+    mEvents.resize(mEvents.size() + (0u - (mKeys.size() + mTimes.size() + mEvents.size())) % 4, 0);
+
+    if(std::fwrite(&mBlock, sizeof(mBlock), 1, mFile) != 1 ||
+        std::fwrite(&mKeyframe[0], 1, mKeyframe.size(), mFile) != mKeyframe.size() ||
+        (!mKeys.empty() && std::fwrite(&mKeys[0], 1, mKeys.size(), mFile) != mKeys.size()) ||
+        (!mTimes.empty() && std::fwrite(&mTimes[0], 1, mTimes.size(), mFile) != mTimes.size()) ||
+        (!mEvents.empty() && std::fwrite(&mEvents[0], 1, mEvents.size(), mFile) != mEvents.size()))
+    {
+        mError = true;
+    }
+    mBlock.mNumFrames = 0;
+}
+
+ReplayReader::ReplayReader() : mHeader(0),
+    mIndex(0),
+    mBlock(0),
+    mFrame(0),
+    mBlockEndFrame(0),
+    mKeys(0),
+    mKeysEnd(0),
+    mTimes(0),
+    mTimesEnd(0),
+    mEvents(0),
+    mEventsEnd(0),
+    mKeyRunHeader(0),
+    mKeyRunLeft(0),
+    mTimeRunLeft(0),
+    mLastTimeBits(0),
+    mLastTimeDelta(0)
+{
+}
+
+bool ReplayReader::open(const char* path)
+{
+    close();
+    if(!mFile.open(path))
+    {
+        return false;
+    }
+
+    const uint8_t* data = mFile.getData();
+    const size_t size = mFile.getSize();
+    const ReplayHeader* header = reinterpret_cast<const ReplayHeader*>(data);
+    bool bValid = size >= sizeof(ReplayHeader) &&
+        header->mMagic == REPLAY_MAGIC &&
+        header->mVersion == REPLAY_VERSION &&
+        header->mNumBlocks > 0 &&
+        header->mIndexOffset % 4 == 0 &&
+        header->mIndexOffset <= size &&
+        header->mNumBlocks <= (size - header->mIndexOffset) / sizeof(ReplayIndexEntry);
+
+    const ReplayIndexEntry* index = reinterpret_cast<const ReplayIndexEntry*>(data + (bValid ? header->mIndexOffset : 0));
+    for(uint32_t block = 0; bValid && block < header->mNumBlocks; ++block)
+    {
+        bValid = index[block].mOffset % 4 == 0 &&
+            index[block].mOffset >= sizeof(ReplayHeader) &&
+            index[block].mOffset < header->mIndexOffset &&
+            index[block].mFirstFrame < header->mNumFrames &&
+            (block == 0 ? index[block].mFirstFrame == 0 : index[block].mFirstFrame > index[block - 1].mFirstFrame);
+    }
+
+    if(!bValid)
+    {
+        mFile.close();
+        return false;
+    }
+
+    mHeader = header;
+    mIndex = index;
+    mBlock = mHeader->mNumBlocks;
+    mFrame = 0;
+    mBlockEndFrame = 0;
+    return true;
+}
+
+void ReplayReader::close()
+{
+    mFile.close();
+    mHeader = 0;
+    mIndex = 0;
+}
+
+int ReplayReader::getWindowWidth() const
+{
+    return mHeader->mWindowWidth;
+}
+
+int ReplayReader::getWindowHeight() const
+{
+    return mHeader->mWindowHeight;
+}
+
+uint32_t ReplayReader::getFrameCount() const
+{
+    return mHeader->mNumFrames;
+}
+
+uint32_t ReplayReader::getFinalChecksum() const
+{
+    return mHeader->mFinalChecksum;
+}
+
+bool ReplayReader::seek(uint32_t frame, GameState& state)
+{
+    if(frame > mHeader->mNumFrames)
+    {
+        return false;
+    }
+
+    //Last block starting at or before frame.
+    uint32_t low = 0;
+    uint32_t high = mHeader->mNumBlocks;
+    while(high - low > 1)
+    {
+        const uint32_t middle = (low + high) / 2;
+        if(mIndex[middle].mFirstFrame <= frame)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if(!beginBlock(low, &state))
+    {
+        return false;
+    }
+
+    //Nothing is drawn on the way, so skip the work of quiet frames.
+    FastForward fastForward(state, FAST_FORWARD_EXACT);
+    while(mFrame < frame)
+    {
+        FrameInput input;
+        if(!state.mPlayerLives || !next(input))
+        {
+            return false;
+        }
+        fastForward.simulate(input);
+    }
+    return true;
+}
+
+bool ReplayReader::next(FrameInput& input)
+{
+    if(mFrame == mBlockEndFrame)
+    {
+        if(mBlock + 1 >= mHeader->mNumBlocks ||
+            mIndex[mBlock + 1].mFirstFrame != mFrame ||
+            !beginBlock(mBlock + 1, 0))
+        {
+            return false;
+        }
+    }
+
+    uint64_t value;
+    if(!mKeyRunLeft)
+    {
+        if(!ReadVarint(mKeys, mKeysEnd, value) || !(value >> KEY_RUN_LENGTH_SHIFT))
+        {
+            return false;
+        }
+        mKeyRunHeader = static_cast<uint32_t>(value & ((1u << KEY_RUN_LENGTH_SHIFT) - 1));
+        mKeyRunLeft = static_cast<uint32_t>(value >> KEY_RUN_LENGTH_SHIFT);
+    }
+    --mKeyRunLeft;
+
+    if(!mTimeRunLeft)
+    {
+        if(!ReadVarint(mTimes, mTimesEnd, value))
+        {
+            return false;
+        }
+        if(value & 1)
+        {
+            mTimeRunLeft = static_cast<uint32_t>(value >> 1);
+            if(!mTimeRunLeft)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            mLastTimeDelta += Unzigzag(static_cast<uint32_t>(value >> 1));
+        }
+    }
+    if(mTimeRunLeft)
+    {
+        --mTimeRunLeft;
+    }
+    mLastTimeBits += mLastTimeDelta;
+
+    input.mTime = BitsFloat(mLastTimeBits);
+    UnpackKeys(static_cast<uint8_t>(mKeyRunHeader), input.mKeys);
+    input.mTimestamped = (mKeyRunHeader & KEY_RUN_TIMESTAMPED) != 0;
+    input.mNumEvents = 0;
+
+    if(mKeyRunHeader & KEY_RUN_EVENTS)
+    {
+        if(!ReadVarint(mEvents, mEventsEnd, value) || value > MAX_FRAME_INPUT_EVENTS)
+        {
+            return false;
+        }
+        input.mNumEvents = static_cast<uint32_t>(value);
+        for(uint32_t index = 0; index < input.mNumEvents; ++index)
+        {
+            if(!ReadVarint(mEvents, mEventsEnd, value) || mEvents == mEventsEnd)
+            {
+                return false;
+            }
+            input.mEvents[index].mTime = BitsFloat(mLastTimeBits + Unzigzag(static_cast<uint32_t>(value)));
+            UnpackKeys(*mEvents++, input.mEvents[index].mKeys);
+        }
+    }
+
+    ++mFrame;
+    return true;
+}
+
+uint32_t ReplayReader::getFrame() const
+{
+    return mFrame;
+}
+
+bool ReplayReader::beginBlock(uint32_t block, GameState* state)
+{
+    const uint8_t* data = mFile.getData();
+    const uint8_t* end = data + mHeader->mIndexOffset;
+    const uint8_t* cursor = data + mIndex[block].mOffset;
+
+    if(static_cast<size_t>(end - cursor) < sizeof(ReplayBlockHeader) + sizeof(ReplayKeyframe))
+    {
+        return false;
+    }
+    const ReplayBlockHeader* header = reinterpret_cast<const ReplayBlockHeader*>(cursor);
+    cursor += sizeof(ReplayBlockHeader);
+    const ReplayKeyframe* keyframe = reinterpret_cast<const ReplayKeyframe*>(cursor);
+    cursor += sizeof(ReplayKeyframe);
+
+    const uint64_t remaining = static_cast<uint64_t>(end - cursor);
+    if(header->mFirstFrame != mIndex[block].mFirstFrame ||
+        header->mNumFrames == 0 ||
+        header->mNumFrames > mHeader->mNumFrames - header->mFirstFrame ||
+        static_cast<uint64_t>(keyframe->mNumObjects) * sizeof(ReplayObject) +
+            header->mKeySize + header->mTimeSize + header->mEventSize > remaining)
+    {
+        return false;
+    }
+
+    const ReplayObject* objects = reinterpret_cast<const ReplayObject*>(cursor);
+    cursor += keyframe->mNumObjects * sizeof(ReplayObject);
+
+    if(state)
+    {
+        SceneObjectVector flat(keyframe->mNumObjects);
+        for(uint32_t index = 0; index < keyframe->mNumObjects; ++index)
+        {
+            if(objects[index].mType >= NUM_OBJECT_TYPES)
+            {
+                return false;
+            }
+            SceneObjectData& object = flat[index];
+            object.mType = static_cast<ObjectType>(objects[index].mType);
+            object.mPosition = Vec2(objects[index].mX, objects[index].mY);
+            object.mVelocity = Vec2(objects[index].mVelocityX, objects[index].mVelocityY);
+        }
+        if(!UnflattenScene(flat, state->mScene))
+        {
+            return false;
+        }
+
+        state->mPlayerScore = keyframe->mPlayerScore;
+        state->mPlayerLives = keyframe->mPlayerLives;
+        state->mLastTime = keyframe->mLastTime;
+        state->mFloorLastTime = keyframe->mFloorLastTime;
+        state->mTimeOfLastFire = keyframe->mTimeOfLastFire;
+        state->mFireKeyWasDown = keyframe->mFireKeyWasDown;
+        state->mRandom = keyframe->mRandom;
+        UnpackKeys(static_cast<uint8_t>(keyframe->mHeldKeys), state->mHeldKeys);
+
+        if(state->mPlayerLives && state->mScene.mTables[TABLE_PLAYER].mPositions.empty())
+        {
+            return false;
+        }
+    }
+
+    mKeys = cursor;
+    mKeysEnd = mKeys + header->mKeySize;
+    mTimes = mKeysEnd;
+    mTimesEnd = mTimes + header->mTimeSize;
+    mEvents = mTimesEnd;
+    mEventsEnd = mEvents + header->mEventSize;
+
+    mBlock = block;
+    mFrame = header->mFirstFrame;
+    mBlockEndFrame = header->mFirstFrame + header->mNumFrames;
+    mKeyRunLeft = 0;
+    mTimeRunLeft = 0;
+    mLastTimeBits = header->mFirstTime;
+    mLastTimeDelta = 0;
+    return true;
+}
+
+bool PlayReplay(IDiceInvaders* system,
+                ReplayReader& reader,
+                uint32_t firstFrame,
+                FrameLimiter& limiter,
+                GameState& state)
+{
+    if(!reader.seek(firstFrame, state))
+    {
+        LogMessage("Replay: cannot seek to frame %u", firstFrame);
+        return true;
+    }
+
+    UpdateHud(state, 0.0f);
+
+    bool bSystemOK = true;
+    FrameInput input;
+    while(state.mPlayerLives && reader.next(input))
+    {
+        DrawGame(system,
+            state.mSprites,
+            state.mWindowWidth,
+            state.mWindowHeight,
+            state.mScene,
+            state.mHud,
+            state.mPlayerLives);
+
+        const float deltaTimeInSecs = input.mTime - state.mLastTime;
+        SimulateGame(state, input);
+        UpdateHud(state, deltaTimeInSecs);
+
+        bSystemOK = system->update();
+        if(!bSystemOK)
+        {
+            break;
+        }
+
+        limiter.wait();
+    }
+
+    if(reader.getFrame() == reader.getFrameCount())
+    {
+        const uint32_t checksum = ChecksumGameState(state);
+        LogMessage("Replay: %u frames, final state %s the recording",
+            reader.getFrameCount(), checksum == reader.getFinalChecksum() ? "matches" : "DOES NOT MATCH");
+    }
+    return bSystemOK;
+}
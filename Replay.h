@@ -0,0 +1,219 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdio>
+#include <vector>
+#include "Game.h"
+#include "MappedFile.h"
+
+class FrameLimiter;
+
+//Recording of every FrameInput of a game, enough to play it back exactly
+//since the simulation is deterministic. Layout:
+//  ReplayHeader
+//  blocks, each starting on a 4 byte boundary:
+//    ReplayBlockHeader
+//    ReplayKeyframe and mNumObjects ReplayObjects: the state the block
+//    starts from
+//    key runs: varint (length << 5 | events << 4 | timestamped << 3 |
+//    InputBits), one per stretch of frames with unchanged input. A frame
+//    with key events gets a run of its own.
+//    frame times: the bits of each float time as the zigzag varint of its
+//    change in delta, shifted left one. An odd varint instead stands for
+//    value >> 1 frames whose delta did not change.
+//    key events of the frames that have them: varint count, then per
+//    event the zigzag varint of its time bits minus the frame's and one
+//    byte of InputBits.
+//  ReplayIndexEntry[mNumBlocks]
+//Every block decodes on its own, so seeking restores the keyframe before
+//the frame and replays at most one block.
+const uint32_t REPLAY_MAGIC = 0x50524944;//"DIRP"
+//Builds with FIXED_POSITIONS play differently, so neither kind of build
+//plays the other's recordings. Version 2 added rockets shooting bombs,
+//version 3 spends a projectile on the first thing it hits. Builds with
+//FIXED_POSITIONS went to 0x10004 when their steps stopped depending on
+//the frame rate. Version 4 (0x10005) hashes the held keys into the final
+//checksum.
+#if defined(FIXED_POSITIONS)
+const uint32_t REPLAY_VERSION = 0x10005;
+#else
+const uint32_t REPLAY_VERSION = 4;
+#endif
+
+//Frames between keyframes unless asked otherwise. Thirty seconds at 60Hz.
+const uint32_t REPLAY_KEYFRAME_INTERVAL = 1800;
+
+struct ReplayHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    int32_t mWindowWidth;
+    int32_t mWindowHeight;
+    uint32_t mNumFrames;
+    uint32_t mNumBlocks;
+    uint32_t mIndexOffset;//From the start of the file.
+    uint32_t mFinalChecksum;//ChecksumGameState after the last frame.
+};
+
+struct ReplayBlockHeader
+{
+    uint32_t mFirstFrame;
+    uint32_t mNumFrames;
+    uint32_t mFirstTime;//Bits of the first frame's float time.
+    uint32_t mKeySize;//Bytes of each section.
+    uint32_t mTimeSize;
+    uint32_t mEventSize;
+};
+
+//GameState apart from the window, sprites and HUD.
+struct ReplayKeyframe
+{
+    int32_t mPlayerScore;
+    int32_t mPlayerLives;
+    float mLastTime;
+    int32_t mFloorLastTime;
+    float mTimeOfLastFire;
+    int32_t mFireKeyWasDown;
+    uint32_t mRandom;
+    uint32_t mHeldKeys;//InputBits
+    uint32_t mNumObjects;
+};
+
+struct ReplayObject
+{
+    uint32_t mType;
+    float mX;
+    float mY;
+    float mVelocityX;
+    float mVelocityY;
+};
+
+struct ReplayIndexEntry
+{
+    uint32_t mFirstFrame;
+    uint32_t mOffset;
+};
+
+class ReplayWriter
+{
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+
+    //Start a recording of a game played at the given window size. A block
+    //begins every keyframeInterval frames.
+    bool open(const char* path,
+              int windowWidth,
+              int windowHeight,
+              uint32_t keyframeInterval);
+
+    //Record the next frame. Call with the state about to be simulated,
+    //before SimulateGame is given input.
+    void record(const GameState& state, const FrameInput& input);
+
+    //Finish the last block and write the index. state is the game after
+    //the last recorded frame. False if anything failed to write.
+    bool close(const GameState& state);
+
+    uint32_t getFrameCount() const;
+
+private:
+    ReplayWriter(const ReplayWriter&);
+    ReplayWriter& operator=(const ReplayWriter&);
+
+    void beginBlock(const GameState& state, const FrameInput& input);
+    void endKeyRun();
+    void endTimeRun();
+    void writeBlock();
+
+private:
+    std::FILE* mFile;
+    bool mError;
+    ReplayHeader mHeader;
+    uint32_t mKeyframeInterval;
+    std::vector<ReplayIndexEntry> mIndex;
+
+    //The open block. Sections are encoded as frames come in and written
+    //out when the block is full.
+    ReplayBlockHeader mBlock;
+    std::vector<uint8_t> mKeyframe;
+    std::vector<uint8_t> mKeys;
+    std::vector<uint8_t> mTimes;
+    std::vector<uint8_t> mEvents;
+
+    uint32_t mKeyRunHeader;//Run header without the length.
+    uint32_t mKeyRunLength;
+    uint32_t mTimeRunLength;//Frames with an unchanged delta not yet written.
+    uint32_t mLastTimeBits;
+    uint32_t mLastTimeDelta;
+};
+
+//Streams a recording out of a memory mapped file. Only the block being
+//played is touched, so an hour long replay costs no more memory than a
+//short one.
+class ReplayReader
+{
+public:
+    ReplayReader();
+
+    //Validates the header and the index. Call seek before next.
+    bool open(const char* path);
+    void close();
+
+    int getWindowWidth() const;
+    int getWindowHeight() const;
+    uint32_t getFrameCount() const;
+    uint32_t getFinalChecksum() const;
+
+    //Put state at the start of frame: restore the nearest keyframe before
+    //it and simulate the frames in between. The window, sprites and HUD of
+    //state are left alone. False if frame is past the end or the file is
+    //damaged.
+    bool seek(uint32_t frame, GameState& state);
+
+    //Input of the next frame. False at the end or if the file is damaged.
+    bool next(FrameInput& input);
+
+    //Frame next will return.
+    uint32_t getFrame() const;
+
+private:
+    ReplayReader(const ReplayReader&);
+    ReplayReader& operator=(const ReplayReader&);
+
+    bool beginBlock(uint32_t block, GameState* state);
+
+private:
+    MappedFile mFile;
+    const ReplayHeader* mHeader;
+    const ReplayIndexEntry* mIndex;
+
+    uint32_t mBlock;
+    uint32_t mFrame;
+    uint32_t mBlockEndFrame;
+
+    const uint8_t* mKeys;
+    const uint8_t* mKeysEnd;
+    const uint8_t* mTimes;
+    const uint8_t* mTimesEnd;
+    const uint8_t* mEvents;
+    const uint8_t* mEventsEnd;
+
+    uint32_t mKeyRunHeader;
+    uint32_t mKeyRunLeft;
+    uint32_t mTimeRunLeft;
+    uint32_t mLastTimeBits;
+    uint32_t mLastTimeDelta;
+};
+
+//Play reader back from firstFrame, one recorded frame per update(), until
+//it ends or the window is closed. state must have been through InitLevel.
+//Logs whether the game ended as it was recorded. Returns the last result
+//of system->update().
+bool PlayReplay(IDiceInvaders* system,
+                ReplayReader& reader,
+                uint32_t firstFrame,
+                FrameLimiter& limiter,
+                GameState& state);
+
+#endif
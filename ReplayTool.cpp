@@ -0,0 +1,323 @@
+//Records synthetic games in the replay format and checks that they play
+//back and seek exactly. Also plays back recordings made with -record.
+//Usage: ReplayTool -record FILE [-frames N] [-seed N] [-keyframes N]
+//                  [-jitter US] [-timestamped 1] [-seeks N]
+//       ReplayTool -play FILE [-fastforward 1]
+//
+//A recorded game runs at 60Hz with up to -jitter US microseconds of clock
+//jitter either way (1000 by default, 0 for a fixed step) and a random key
+//script, and ends when the player has no lives left or after
+//-frames N frames. -timestamped 1 delivers the keys as timestamped events
+//the way -inputrate does.
+//
+//-fastforward 1 plays the recording again through FastForward in both
+//modes and compares them with the frame by frame game.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "FastForward.h"
+#include "Game.h"
+#include "Log.h"
+#include "Replay.h"
+#include "ServerProtocol.h"
+#include "Timer.h"
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+//Returns the argument following option in argv or null.
+static const char* GetOptionString(int argc, char** argv, const char* option)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return argv[index + 1];
+        }
+    }
+    return 0;
+}
+
+static uint32_t NextScriptRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static bool Record(const char* path,
+                   uint32_t maxFrames,
+                   uint32_t seed,
+                   uint32_t keyframeInterval,
+                   uint32_t clockJitter,
+                   bool bTimestamped,
+                   uint32_t numSeeks)
+{
+    GameState state(SERVER_WINDOW_WIDTH, SERVER_WINDOW_HEIGHT);
+    ResetLevel(state, 0.0f);
+
+    ReplayWriter writer;
+    if(!writer.open(path, state.mWindowWidth, state.mWindowHeight, keyframeInterval))
+    {
+        LogMessage("ReplayTool: cannot create %s", path);
+        return false;
+    }
+
+    //Checksum at the start of every frame to check seeks against.
+    std::vector<uint32_t> checksums;
+
+    uint32_t random = seed;
+    float time = 0.0f;
+    float nextKeyChange = 0.5f;
+    IDiceInvaders::KeyStatus keys;
+    UnpackKeys(0, keys);
+
+    const uint64_t recordStart = GetTimeNanoseconds();
+    while(state.mPlayerLives && checksums.size() < maxFrames)
+    {
+        checksums.push_back(ChecksumGameState(state));
+
+        FrameInput input;
+        const int jitter = static_cast<int>(NextScriptRandom(random) % (clockJitter * 2 + 1)) -
+            static_cast<int>(clockJitter);
+        input.mTime = time + 1.0f / 60.0f + jitter / 1000000.0f;
+        input.mTimestamped = bTimestamped;
+        input.mNumEvents = 0;
+        while(nextKeyChange <= input.mTime)
+        {
+            const uint32_t bits = NextScriptRandom(random);
+            keys.fire = (bits & 1) != 0;
+            keys.left = (bits & 2) != 0;
+            keys.right = !keys.left && (bits & 4) != 0;
+            if(bTimestamped && input.mNumEvents < MAX_FRAME_INPUT_EVENTS)
+            {
+                input.mEvents[input.mNumEvents].mTime = nextKeyChange;
+                input.mEvents[input.mNumEvents].mKeys = keys;
+                ++input.mNumEvents;
+            }
+            nextKeyChange += 0.1f + (bits >> 8) % 1000 / 1000.0f;
+        }
+        input.mKeys = keys;
+        time = input.mTime;
+
+        writer.record(state, input);
+        SimulateGame(state, input);
+    }
+    const uint64_t recordTime = GetTimeNanoseconds() - recordStart;
+    checksums.push_back(ChecksumGameState(state));
+
+    if(!writer.close(state))
+    {
+        LogMessage("ReplayTool: cannot write %s", path);
+        return false;
+    }
+
+    const uint32_t numFrames = writer.getFrameCount();
+    std::FILE* file = std::fopen(path, "rb");
+    long fileSize = 0;
+    if(file)
+    {
+        std::fseek(file, 0, SEEK_END);
+        fileSize = std::ftell(file);
+        std::fclose(file);
+    }
+
+    //What storing every frame's time and KeyStatus as they are would take.
+    const double rawSize = static_cast<double>(numFrames) * (sizeof(float) + sizeof(IDiceInvaders::KeyStatus));
+    LogMessage("ReplayTool: %u frames (%.1f minutes) in %ld bytes, %.2f bytes per frame, %.1fx smaller than raw input",
+        numFrames, time / 60.0f, fileSize, static_cast<double>(fileSize) / numFrames, rawSize / fileSize);
+    LogMessage("ReplayTool: simulated and recorded at %.2fus per frame, %.1fKB per hour at 60Hz",
+        NanosecondsToMilliseconds(recordTime) * 1000.0 / numFrames,
+        static_cast<double>(fileSize) / numFrames * 60 * 3600 / 1024);
+
+    ReplayReader reader;
+    if(!reader.open(path))
+    {
+        LogMessage("ReplayTool: cannot read back %s", path);
+        return false;
+    }
+
+    bool bOK = true;
+    GameState playback(reader.getWindowWidth(), reader.getWindowHeight());
+    for(uint32_t seek = 0; seek < numSeeks && bOK; ++seek)
+    {
+        const uint32_t frame = seek == 0 ? numFrames : NextScriptRandom(random) % (numFrames + 1);
+
+        const uint64_t start = GetTimeNanoseconds();
+        bOK = reader.seek(frame, playback);
+        const uint64_t seekTime = GetTimeNanoseconds() - start;
+
+        if(!bOK || ChecksumGameState(playback) != checksums[frame])
+        {
+            LogMessage("ReplayTool: seek to frame %u MISMATCH", frame);
+            bOK = false;
+        }
+        else if(seek < 4)
+        {
+            LogMessage("ReplayTool: seek to frame %u took %.3fms", frame, NanosecondsToMilliseconds(seekTime));
+        }
+    }
+
+    if(bOK && reader.getFinalChecksum() != checksums.back())
+    {
+        LogMessage("ReplayTool: final checksum MISMATCH");
+        bOK = false;
+    }
+
+    if(bOK)
+    {
+        LogMessage("ReplayTool: %u seeks match the recording", numSeeks);
+    }
+    return bOK;
+}
+
+//Largest distance between objects of the two games, or -1 if they do not
+//hold the same objects.
+static float CompareObjects(const GameState& a, const GameState& b)
+{
+    SceneObjectVector objectsA;
+    SceneObjectVector objectsB;
+    FlattenScene(a.mScene, objectsA);
+    FlattenScene(b.mScene, objectsB);
+    if(objectsA.size() != objectsB.size())
+    {
+        return -1.0f;
+    }
+    float maxDistance = 0.0f;
+    for(size_t index = 0; index < objectsA.size(); ++index)
+    {
+        if(objectsA[index].mType != objectsB[index].mType)
+        {
+            return -1.0f;
+        }
+        const Vec2& positionA = objectsA[index].mPosition;
+        const Vec2& positionB = objectsB[index].mPosition;
+        maxDistance = std::max(maxDistance, std::max(std::fabs(positionA.x() - positionB.x()),
+            std::fabs(positionA.y() - positionB.y())));
+    }
+    return maxDistance;
+}
+
+//Play the recording again through FastForward. exact is the frame by
+//frame game, which FAST_FORWARD_EXACT must match bit for bit.
+static bool PlayFastForward(ReplayReader& reader,
+                            FastForwardMode mode,
+                            const GameState& exact,
+                            double exactTime)
+{
+    GameState state(reader.getWindowWidth(), reader.getWindowHeight());
+    const uint64_t start = GetTimeNanoseconds();
+    if(!reader.seek(0, state))
+    {
+        return false;
+    }
+
+    FastForward fastForward(state, mode);
+    FrameInput input;
+    while(state.mPlayerLives && reader.next(input))
+    {
+        fastForward.simulate(input);
+    }
+    fastForward.flush();
+    const uint64_t playTime = GetTimeNanoseconds() - start;
+
+    const char* modeName = mode == FAST_FORWARD_EXACT ? "exact" : "jump";
+    LogMessage("ReplayTool: %s fast forward simulated %u of %u frames in full in %.1fms, %.1fx faster",
+        modeName, fastForward.getStepCount(), fastForward.getFrameCount(),
+        NanosecondsToMilliseconds(playTime), exactTime / std::max(NanosecondsToMilliseconds(playTime), 0.001));
+
+    if(mode == FAST_FORWARD_EXACT)
+    {
+        const bool bOK = ChecksumGameState(state) == ChecksumGameState(exact);
+        LogMessage("ReplayTool: exact fast forward %s", bOK ? "matches" : "DOES NOT MATCH");
+        return bOK;
+    }
+
+    //Jumps round differently, so only report how far the games drifted.
+    const float distance = CompareObjects(exact, state);
+    LogMessage("ReplayTool: jump fast forward score %d, lives %d, frame by frame %d, %d, objects %s %.4f pixels",
+        state.mPlayerScore, state.mPlayerLives, exact.mPlayerScore, exact.mPlayerLives,
+        distance < 0.0f ? "differ" : "within", std::max(distance, 0.0f));
+    return true;
+}
+
+static bool Play(const char* path, bool bFastForward)
+{
+    ReplayReader reader;
+    if(!reader.open(path))
+    {
+        LogMessage("ReplayTool: cannot read %s", path);
+        return false;
+    }
+
+    GameState state(reader.getWindowWidth(), reader.getWindowHeight());
+    const uint64_t start = GetTimeNanoseconds();
+    if(!reader.seek(0, state))
+    {
+        LogMessage("ReplayTool: %s is damaged", path);
+        return false;
+    }
+
+    FrameInput input;
+    while(state.mPlayerLives && reader.next(input))
+    {
+        SimulateGame(state, input);
+    }
+    const uint64_t playTime = GetTimeNanoseconds() - start;
+
+    const bool bOK = reader.getFrame() == reader.getFrameCount() &&
+        ChecksumGameState(state) == reader.getFinalChecksum();
+    LogMessage("ReplayTool: played %u of %u frames in %.1fms, score %d, %s",
+        reader.getFrame(), reader.getFrameCount(), NanosecondsToMilliseconds(playTime),
+        state.mPlayerScore, bOK ? "final state matches" : "final state DOES NOT MATCH");
+
+    if(bOK && bFastForward)
+    {
+        const double exactTime = NanosecondsToMilliseconds(playTime);
+        PlayFastForward(reader, FAST_FORWARD_JUMP, state, exactTime);
+        return PlayFastForward(reader, FAST_FORWARD_EXACT, state, exactTime);
+    }
+    return bOK;
+}
+
+int main(int argc, char** argv)
+{
+    const char* recordPath = GetOptionString(argc, argv, "-record");
+    const char* playPath = GetOptionString(argc, argv, "-play");
+
+    bool bOK = false;
+    if(recordPath)
+    {
+        bOK = Record(recordPath,
+            std::max(GetOptionInt(argc, argv, "-frames", 216000), 1),
+            GetOptionInt(argc, argv, "-seed", 1),
+            std::max(GetOptionInt(argc, argv, "-keyframes", REPLAY_KEYFRAME_INTERVAL), 1),
+            std::max(GetOptionInt(argc, argv, "-jitter", 1000), 0),
+            GetOptionInt(argc, argv, "-timestamped", 0) != 0,
+            GetOptionInt(argc, argv, "-seeks", 100));
+    }
+    else if(playPath)
+    {
+        bOK = Play(playPath, GetOptionInt(argc, argv, "-fastforward", 0) != 0);
+    }
+    else
+    {
+        LogMessage("ReplayTool: -record FILE or -play FILE");
+    }
+    return bOK ? 0 : 1;
+}
@@ -0,0 +1,431 @@
+#include "Rollback.h"
+#include "FrameLimiter.h"
+#include "Latency.h"
+#include "Log.h"
+#include "ServerProtocol.h"
+#include "Threading.h"
+#include "Timer.h"
+#include "UdpTransport.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    //Every input the peer has not acknowledged is sent again in each
+    //datagram, so a lost datagram costs nothing but a little latency.
+    //A peer is at most 2 * ROLLBACK_MAX_FRAMES ahead of the last
+    //acknowledgement it has seen.
+    const uint32_t MAX_PACKET_INPUTS = 4 * ROLLBACK_MAX_FRAMES;
+
+    //Native byte order, which is fine for loopback.
+    struct RollbackPacket
+    {
+        uint32_t mFrame;//Sender's current frame.
+        uint32_t mAck;//Inputs received from the receiver without a gap.
+        int32_t mAdvantage;//Sender's frame minus the receiver's last reported frame.
+        uint32_t mChecksumFrame;//0 when there is no checksum yet.
+        uint32_t mChecksum;
+        uint32_t mFirstInputFrame;
+        uint8_t mNumInputs;
+        uint8_t mInputs[MAX_PACKET_INPUTS];//InputBits
+    };
+
+    const uint32_t PACKET_HEADER_SIZE = offsetof(RollbackPacket, mInputs);
+
+    const uint32_t NO_FRAME = 0xffffffffu;
+
+    //Stall at most once per this many frames to let the peer catch up, so
+    //the effect of one stall is seen before deciding on the next.
+    const uint32_t SYNC_INTERVAL = ROLLBACK_FRAME_RATE / 4;
+
+    //A game is abandoned when the peer has been silent this long.
+    const uint64_t PEER_TIMEOUT = 10000000000ull;
+}
+
+RollbackSession::RollbackSession(GameState& state, UdpTransport& transport) : mState(state),
+    mTransport(transport),
+    mFrame(0),
+    mRemoteFrame(0),
+    mRemoteAck(0),
+    mRemoteReportedFrame(0),
+    mRemoteAdvantage(0),
+    mNextSyncFrame(0),
+    mLastReceiveTime(GetTimeNanoseconds()),
+    mStates(STATE_HISTORY, state),
+    mNextChecksumFrame(CHECKSUM_INTERVAL),
+    mRollbacks(0),
+    mResimulatedFrames(0),
+    mMaxRollbackFrames(0),
+    mMaxRollbackTime(0),
+    mSaveTime(0),
+    mSaves(0),
+    mPredictionStalls(0),
+    mSyncStalls(0),
+    mChecksumsCompared(0),
+    mDesyncs(0)
+{
+    std::memset(mLocalInputs, 0, sizeof(mLocalInputs));
+    std::memset(mRemoteInputs, 0, sizeof(mRemoteInputs));
+    std::memset(mPredictedInputs, 0, sizeof(mPredictedInputs));
+    std::fill(mRemoteInputFrames, mRemoteInputFrames + INPUT_HISTORY, NO_FRAME);
+    std::fill(mLocalChecksumFrames, mLocalChecksumFrames + CHECKSUM_HISTORY, NO_FRAME);
+    std::fill(mRemoteChecksumFrames, mRemoteChecksumFrames + CHECKSUM_HISTORY, NO_FRAME);
+}
+
+bool RollbackSession::update(const IDiceInvaders::KeyStatus& localKeys)
+{
+    receive();
+
+    bool bAdvance = mState.mPlayerLives != 0;
+    if(bAdvance && mFrame >= mRemoteFrame + ROLLBACK_MAX_FRAMES)
+    {
+        ++mPredictionStalls;
+        bAdvance = false;
+    }
+
+    //Both advantages include the one way latency, so their difference is
+    //twice how far this peer really is ahead.
+    const int32_t advantage = static_cast<int32_t>(mFrame - mRemoteReportedFrame);
+    if(bAdvance && mFrame >= mNextSyncFrame && advantage - mRemoteAdvantage >= 2)
+    {
+        ++mSyncStalls;
+        mNextSyncFrame = mFrame + SYNC_INTERVAL;
+        bAdvance = false;
+    }
+
+    if(bAdvance)
+    {
+        mLocalInputs[mFrame % INPUT_HISTORY] = PackKeys(localKeys);
+        simulateFrame(mFrame);
+        ++mFrame;
+    }
+
+    exchangeChecksums();
+    send();
+    mTransport.flush();
+    return bAdvance;
+}
+
+void RollbackSession::poll()
+{
+    receive();
+    exchangeChecksums();
+    send();
+    mTransport.flush();
+}
+
+uint32_t RollbackSession::getFrame() const
+{
+    return mFrame;
+}
+
+uint32_t RollbackSession::getConfirmedFrame() const
+{
+    return std::min(mFrame, mRemoteFrame);
+}
+
+uint64_t RollbackSession::getTimeSinceReceive() const
+{
+    return GetTimeNanoseconds() - mLastReceiveTime;
+}
+
+uint32_t RollbackSession::getChecksum(uint32_t frame) const
+{
+    assert(frame <= mFrame && mFrame - frame < STATE_HISTORY);
+    if(frame == mFrame)
+    {
+        return ChecksumGameState(mState);
+    }
+    return ChecksumGameState(mStates[frame % STATE_HISTORY]);
+}
+
+void RollbackSession::logStats() const
+{
+    LogMessage("Rollback: %u frames, %u rollbacks resimulating %u frames (max %u), "
+        "slowest rollback %.2fms of a %.2fms frame",
+        mFrame, mRollbacks, mResimulatedFrames, mMaxRollbackFrames,
+        NanosecondsToMilliseconds(mMaxRollbackTime), 1000.0 / ROLLBACK_FRAME_RATE);
+    LogMessage("Rollback: state save %.2fus mean, %u prediction stalls, %u sync stalls",
+        mSaves ? NanosecondsToMilliseconds(mSaveTime) * 1000.0 / mSaves : 0.0,
+        mPredictionStalls, mSyncStalls);
+    LogMessage("Rollback: %u checksums compared with the peer, %u desyncs",
+        mChecksumsCompared, mDesyncs);
+}
+
+void RollbackSession::receive()
+{
+    uint32_t firstWrongFrame = mFrame;
+
+    RollbackPacket packet;
+    uint32_t size;
+    while((size = mTransport.receive(&packet, sizeof(packet))) != 0)
+    {
+        if(size < PACKET_HEADER_SIZE ||
+            packet.mNumInputs > MAX_PACKET_INPUTS ||
+            size != PACKET_HEADER_SIZE + packet.mNumInputs ||
+            packet.mAck > mFrame)
+        {
+            continue;
+        }
+
+        mLastReceiveTime = GetTimeNanoseconds();
+        mRemoteAck = std::max(mRemoteAck, packet.mAck);
+
+        //Datagrams can arrive out of order. Only the newest says where the
+        //peer is.
+        if(packet.mFrame >= mRemoteReportedFrame)
+        {
+            mRemoteReportedFrame = packet.mFrame;
+            mRemoteAdvantage = packet.mAdvantage;
+        }
+
+        if(packet.mChecksumFrame)
+        {
+            const uint32_t slot = (packet.mChecksumFrame / CHECKSUM_INTERVAL) % CHECKSUM_HISTORY;
+            if(mRemoteChecksumFrames[slot] != packet.mChecksumFrame)
+            {
+                mRemoteChecksumFrames[slot] = packet.mChecksumFrame;
+                mRemoteChecksums[slot] = packet.mChecksum;
+                if(mLocalChecksumFrames[slot] == packet.mChecksumFrame)
+                {
+                    compareChecksum(packet.mChecksumFrame, mLocalChecksums[slot], packet.mChecksum);
+                }
+            }
+        }
+
+        for(uint32_t index = 0; index < packet.mNumInputs; ++index)
+        {
+            const uint32_t frame = packet.mFirstInputFrame + index;
+            if(frame < mRemoteFrame || frame - mRemoteFrame >= INPUT_HISTORY)
+            {
+                continue;
+            }
+
+            const uint32_t slot = frame % INPUT_HISTORY;
+            if(mRemoteInputFrames[slot] == frame)
+            {
+                continue;
+            }
+
+            mRemoteInputs[slot] = packet.mInputs[index];
+            mRemoteInputFrames[slot] = frame;
+
+            if(frame < mFrame && mPredictedInputs[slot] != packet.mInputs[index])
+            {
+                firstWrongFrame = std::min(firstWrongFrame, frame);
+            }
+        }
+
+        while(mRemoteInputFrames[mRemoteFrame % INPUT_HISTORY] == mRemoteFrame)
+        {
+            ++mRemoteFrame;
+        }
+    }
+
+    if(firstWrongFrame < mFrame)
+    {
+        rollback(firstWrongFrame);
+    }
+}
+
+void RollbackSession::send()
+{
+    //Oldest first, so the peer can always fill its next gap. The window
+    //keeps everything unacknowledged within one datagram anyway.
+    const uint32_t firstFrame = mRemoteAck;
+    const uint32_t numInputs = std::min(mFrame - firstFrame, MAX_PACKET_INPUTS);
+
+    RollbackPacket packet;
+    packet.mFrame = mFrame;
+    packet.mAck = mRemoteFrame;
+    packet.mAdvantage = static_cast<int32_t>(mFrame - mRemoteReportedFrame);
+    packet.mFirstInputFrame = firstFrame;
+    packet.mNumInputs = static_cast<uint8_t>(numInputs);
+    for(uint32_t index = 0; index < numInputs; ++index)
+    {
+        packet.mInputs[index] = mLocalInputs[(firstFrame + index) % INPUT_HISTORY];
+    }
+
+    packet.mChecksumFrame = 0;
+    packet.mChecksum = 0;
+    if(mNextChecksumFrame > CHECKSUM_INTERVAL)
+    {
+        const uint32_t frame = mNextChecksumFrame - CHECKSUM_INTERVAL;
+        const uint32_t slot = (frame / CHECKSUM_INTERVAL) % CHECKSUM_HISTORY;
+        packet.mChecksumFrame = frame;
+        packet.mChecksum = mLocalChecksums[slot];
+    }
+
+    mTransport.send(&packet, PACKET_HEADER_SIZE + numInputs);
+}
+
+void RollbackSession::simulateFrame(uint32_t frame)
+{
+    //Vector assignment reuses the slot's capacity, so saving is a copy of
+    //the objects and nothing more once the slots have grown.
+    const uint64_t saveStart = GetTimeNanoseconds();
+    mStates[frame % STATE_HISTORY] = mState;
+    mSaveTime += GetTimeNanoseconds() - saveStart;
+    ++mSaves;
+
+    //Remote keys not received yet are predicted to be held, which is
+    //right for all but the frames where a key changes.
+    const uint32_t slot = frame % INPUT_HISTORY;
+    uint8_t remoteKeys = 0;
+    if(mRemoteInputFrames[slot] == frame)
+    {
+        remoteKeys = mRemoteInputs[slot];
+    }
+    else if(mRemoteFrame > 0)
+    {
+        remoteKeys = mRemoteInputs[(mRemoteFrame - 1) % INPUT_HISTORY];
+    }
+    mPredictedInputs[slot] = remoteKeys;
+
+    FrameInput input;
+    input.mTime = static_cast<float>(frame + 1) / ROLLBACK_FRAME_RATE;
+    input.mTimestamped = false;
+    input.mNumEvents = 0;
+    UnpackKeys(static_cast<uint8_t>(mLocalInputs[slot] | remoteKeys), input.mKeys);
+
+    //A predicted game over may yet be undone by a rollback.
+    if(mState.mPlayerLives)
+    {
+        SimulateGame(mState, input);
+    }
+}
+
+void RollbackSession::rollback(uint32_t frame)
+{
+    assert(mFrame - frame < STATE_HISTORY);
+    const uint64_t start = GetTimeNanoseconds();
+
+    mState = mStates[frame % STATE_HISTORY];
+    for(uint32_t resimulate = frame; resimulate < mFrame; ++resimulate)
+    {
+        simulateFrame(resimulate);
+    }
+
+    const uint32_t numFrames = mFrame - frame;
+    ++mRollbacks;
+    mResimulatedFrames += numFrames;
+    mMaxRollbackFrames = std::max(mMaxRollbackFrames, numFrames);
+    mMaxRollbackTime = std::max(mMaxRollbackTime, GetTimeNanoseconds() - start);
+}
+
+void RollbackSession::exchangeChecksums()
+{
+    while(mNextChecksumFrame <= getConfirmedFrame())
+    {
+        const uint32_t frame = mNextChecksumFrame;
+        const uint32_t slot = (frame / CHECKSUM_INTERVAL) % CHECKSUM_HISTORY;
+        mLocalChecksumFrames[slot] = frame;
+        mLocalChecksums[slot] = getChecksum(frame);
+        if(mRemoteChecksumFrames[slot] == frame)
+        {
+            compareChecksum(frame, mLocalChecksums[slot], mRemoteChecksums[slot]);
+        }
+        mNextChecksumFrame += CHECKSUM_INTERVAL;
+    }
+}
+
+void RollbackSession::compareChecksum(uint32_t frame, uint32_t local, uint32_t remote)
+{
+    ++mChecksumsCompared;
+    if(local != remote)
+    {
+        if(!mDesyncs)
+        {
+            LogMessage("Rollback: desync at frame %u, checksum %08x here and %08x on the peer",
+                frame, local, remote);
+        }
+        ++mDesyncs;
+    }
+}
+
+bool RunRollbackGame(IDiceInvaders* system,
+                     UdpTransport& transport,
+                     FrameLimiter& limiter,
+                     GameState& state,
+                     uint32_t numFrames)
+{
+    ResetLevel(state, 0.0f);
+    UpdateHud(state, 0.0f);
+
+    RollbackSession session(state, transport);
+
+    //Frames are simulated on the game's clock at ROLLBACK_FRAME_RATE
+    //whatever the display rate. A frame the session does not simulate
+    //still uses up its time, so stalls really slow this peer down.
+    const float frameTime = 1.0f / ROLLBACK_FRAME_RATE;
+    float lastTime = system->getElapsedTime();
+    float nextFrameTime = lastTime;
+
+    bool bSystemOK = true;
+    for(;;)
+    {
+        const uint32_t confirmed = session.getConfirmedFrame();
+        if((numFrames && confirmed >= numFrames) ||
+            (!state.mPlayerLives && confirmed == session.getFrame()))
+        {
+            break;
+        }
+
+        if(session.getTimeSinceReceive() > PEER_TIMEOUT)
+        {
+            LogMessage("Rollback: no word from the peer, giving up at frame %u", session.getFrame());
+            break;
+        }
+
+        const float time = system->getElapsedTime();
+        if(time >= nextFrameTime && !(numFrames && session.getFrame() >= numFrames))
+        {
+            IDiceInvaders::KeyStatus keys;
+            system->getKeyStatus(keys);
+            session.update(keys);
+
+            //After a hitch carry on from now rather than racing to catch up.
+            nextFrameTime = std::max(nextFrameTime + frameTime, time - frameTime);
+        }
+        else
+        {
+            session.poll();
+        }
+
+        UpdateHud(state, time - lastTime);
+        lastTime = time;
+
+        DrawGame(system,
+            state.mSprites,
+            state.mWindowWidth,
+            state.mWindowHeight,
+            state.mScene,
+            state.mHud,
+            state.mPlayerLives);
+
+        bSystemOK = system->update();
+        LatencyMark(LATENCY_PRESENTED);
+        if(!bSystemOK)
+        {
+            break;
+        }
+
+        limiter.wait();
+    }
+
+    //The peer may still be waiting for the last inputs. Keep sending them
+    //for a while.
+    for(uint32_t tick = 0; tick < ROLLBACK_FRAME_RATE; ++tick)
+    {
+        session.poll();
+        ThreadSleep(1000000 / ROLLBACK_FRAME_RATE);
+    }
+
+    const uint32_t confirmed = session.getConfirmedFrame();
+    LogMessage("Rollback: confirmed frame %u, checksum %08x",
+        confirmed, session.getChecksum(confirmed));
+    session.logStats();
+    return bSystemOK;
+}
@@ -0,0 +1,127 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <vector>
+#include "Game.h"
+
+class FrameLimiter;
+class UdpTransport;
+
+//Rollback netcode for two peers sharing one ship. Both peers run the same
+//deterministic simulation at a fixed step, the ship obeying the keys of
+//either player. Each frame is simulated as soon as the local keys are
+//known, with the remote keys predicted to be the last ones received. When
+//the real remote keys arrive and differ, the state saved before the first
+//wrong frame is restored and every frame since is simulated again, all
+//within the current frame.
+//
+//Neither peer runs more than ROLLBACK_MAX_FRAMES ahead of the remote input
+//it has, which bounds both the state history and the work of one rollback.
+
+const uint32_t ROLLBACK_FRAME_RATE = 60;
+const uint32_t ROLLBACK_MAX_FRAMES = 8;
+
+class RollbackSession
+{
+public:
+    //state is simulated in place from frame 0. It must start out identical
+    //on both peers, which ResetLevel(state, 0) with the same window size
+    //does.
+    RollbackSession(GameState& state, UdpTransport& transport);
+
+    //Receive remote input and correct any mispredicted frames, then
+    //simulate the next frame with localKeys unless prediction has run as
+    //far ahead as allowed, the other peer needs to catch up, or the
+    //predicted game is over. Sends the local input either way. Returns
+    //true if a frame was simulated.
+    bool update(const IDiceInvaders::KeyStatus& localKeys);
+
+    //Receive and send without simulating, so the peer gets the last
+    //inputs after this one has finished.
+    void poll();
+
+    //Frames simulated so far. The state is at the start of this frame.
+    uint32_t getFrame() const;
+
+    //Frames whose input from both peers is known. The state of frames
+    //before this will not change again.
+    uint32_t getConfirmedFrame() const;
+
+    //Nanoseconds since a datagram last arrived from the peer.
+    uint64_t getTimeSinceReceive() const;
+
+    //Checksum of the state at the start of the given confirmed frame,
+    //which must be one of the last ROLLBACK_MAX_FRAMES.
+    uint32_t getChecksum(uint32_t frame) const;
+
+    //Log rollbacks, resimulation cost against the frame budget, stalls and
+    //the result of comparing state checksums with the peer.
+    void logStats() const;
+
+private:
+    RollbackSession(const RollbackSession&);
+    RollbackSession& operator=(const RollbackSession&);
+
+    void receive();
+    void send();
+    void simulateFrame(uint32_t frame);
+    void rollback(uint32_t frame);
+    void exchangeChecksums();
+    void compareChecksum(uint32_t frame, uint32_t local, uint32_t remote);
+
+private:
+    //Power of two, larger than the inputs one peer can have unacknowledged.
+    static const uint32_t INPUT_HISTORY = 128;
+    //States at the start of the last frames, enough to restore any frame
+    //that can still be corrected.
+    static const uint32_t STATE_HISTORY = ROLLBACK_MAX_FRAMES + 2;
+    static const uint32_t CHECKSUM_INTERVAL = 30;
+    static const uint32_t CHECKSUM_HISTORY = 16;
+
+    GameState& mState;
+    UdpTransport& mTransport;
+
+    uint32_t mFrame;
+    uint32_t mRemoteFrame;//Remote inputs known without a gap.
+    uint32_t mRemoteAck;//Local inputs the peer has acknowledged.
+    uint32_t mRemoteReportedFrame;//Peer's frame in its last datagram.
+    int32_t mRemoteAdvantage;//How far the peer thought it was ahead of us.
+    uint32_t mNextSyncFrame;
+    uint64_t mLastReceiveTime;
+
+    uint8_t mLocalInputs[INPUT_HISTORY];
+    uint8_t mRemoteInputs[INPUT_HISTORY];
+    uint32_t mRemoteInputFrames[INPUT_HISTORY];//Frame each remote slot holds.
+    uint8_t mPredictedInputs[INPUT_HISTORY];//Remote keys the frame ran with.
+    std::vector<GameState> mStates;//STATE_HISTORY slots.
+
+    uint32_t mNextChecksumFrame;
+    uint32_t mLocalChecksumFrames[CHECKSUM_HISTORY];
+    uint32_t mLocalChecksums[CHECKSUM_HISTORY];
+    uint32_t mRemoteChecksumFrames[CHECKSUM_HISTORY];
+    uint32_t mRemoteChecksums[CHECKSUM_HISTORY];
+
+    uint32_t mRollbacks;
+    uint32_t mResimulatedFrames;
+    uint32_t mMaxRollbackFrames;
+    uint64_t mMaxRollbackTime;
+    uint64_t mSaveTime;
+    uint32_t mSaves;
+    uint32_t mPredictionStalls;
+    uint32_t mSyncStalls;
+    uint32_t mChecksumsCompared;
+    uint32_t mDesyncs;
+};
+
+//Play a rollback game against the peer on transport until the confirmed
+//game is over, numFrames frames are confirmed (0 for no limit), the peer
+//goes quiet or the window is closed. The current predicted state is drawn
+//every frame. state must have been through InitLevel; it is reset to the
+//start of a game. Returns the last result of system->update().
+bool RunRollbackGame(IDiceInvaders* system,
+                     UdpTransport& transport,
+                     FrameLimiter& limiter,
+                     GameState& state,
+                     uint32_t numFrames);
+
+#endif
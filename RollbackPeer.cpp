@@ -0,0 +1,76 @@
+//Headless rollback peer for testing two processes against each other on
+//loopback. Each peer plays its own random key script and both print the
+//checksum of the same confirmed frame at the end, which must match.
+//Usage: RollbackPeer -port N -peer N [-frames N] [-seed N]
+//                    [-netdelay MS] [-netjitter MS] [-netloss PERCENT]
+//
+//    ./RollbackPeer -port 27970 -peer 27971 -seed 1 -netdelay 50 &
+//    ./RollbackPeer -port 27971 -peer 27970 -seed 2 -netdelay 50
+
+#include <cstdlib>
+#include <cstring>
+
+#include "FrameLimiter.h"
+#include "Game.h"
+#include "HeadlessInvaders.h"
+#include "Log.h"
+#include "Rollback.h"
+#include "ServerProtocol.h"
+#include "UdpTransport.h"
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+int main(int argc, char** argv)
+{
+    const int port = GetOptionInt(argc, argv, "-port", 0);
+    const int peerPort = GetOptionInt(argc, argv, "-peer", 0);
+    const int numFrames = GetOptionInt(argc, argv, "-frames", 1800);
+    if(port <= 0 || peerPort <= 0 || numFrames <= 0)
+    {
+        LogMessage("RollbackPeer: -port and -peer are required");
+        return 1;
+    }
+
+    UdpTransport transport;
+    if(!transport.open(static_cast<uint16_t>(port), static_cast<uint16_t>(peerPort)))
+    {
+        return 1;
+    }
+    transport.setConditions(GetOptionInt(argc, argv, "-netdelay", 0),
+        GetOptionInt(argc, argv, "-netjitter", 0),
+        GetOptionInt(argc, argv, "-netloss", 0));
+
+    //The display runs at the simulation rate. Its frame limit only stops a
+    //run whose peer never turns up.
+    HeadlessInvaders* system = new HeadlessInvaders(static_cast<float>(ROLLBACK_FRAME_RATE), numFrames * 10);
+    system->injectRandomKeys(GetOptionInt(argc, argv, "-seed", 1), numFrames / 6, 0.5f, 0.1f);
+    system->init(SERVER_WINDOW_WIDTH, SERVER_WINDOW_HEIGHT);
+
+    GameState state(SERVER_WINDOW_WIDTH, SERVER_WINDOW_HEIGHT);
+    InitLevel(system, state);
+
+    {
+        FrameLimiter limiter(system, 0.0f);
+        RunRollbackGame(system, transport, limiter, state, numFrames);
+        limiter.logStats("Rollback loop");
+    }
+
+    for(uint32_t index = 0; index < NUM_OBJECT_TYPES; ++index)
+    {
+        state.mSprites[index]->destroy();
+    }
+    system->destroy();
+    return 0;
+}
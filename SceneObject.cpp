@@ -1,41 +1,295 @@
 #include "SceneObject.h"
+#include "Latency.h"
+#include "ObjectTraits.h"
+#include <algorithm>
 #include <cmath>
 #include <assert.h>
 
-void SpawnAliens(SceneObjectVector& objects, const int windowWidth)
+namespace
 {
-    const int NumAlienRows = 8;
-    for(int i =0; i < NumAlienRows; ++i)
+    const int NUM_ALIEN_ROWS = 8;
+
+    //Seconds between the quickest presses of fire a player manages. A
+    //press always fires, so it is this rather than ROCKET_RATE_OF_FIRE
+    //that bounds the rockets in flight. Only sizes the tables.
+    const float QUICKEST_FIRE_PRESSES = 0.05f;
+
+    uint32_t AliensPerRow(const int windowWidth)
     {
-        //One row of aliens.
-        CreateObjects(ENEMY1,
-            static_cast<uint32_t>(std::floor(windowWidth/F_SPRITE_SIZE*0.66f)),
-            Vec2(1.0f, F_SPRITE_SIZE + F_SPRITE_SIZE * i),
-            Vec2(1.0f, 0.0f),
-            Vec2(F_SPRITE_SIZE + 4.0f, 0.0f),
-            objects);
+        return static_cast<uint32_t>(std::floor(windowWidth/F_SPRITE_SIZE*0.66f));
     }
-}
 
-static void SortObjectsByType(SceneObjectVector& objects)
-{
-    //Buble sort objects so that entities of the same type are next to each other.
-    bool swapped = true;
-    while(swapped)
+    template<TableId TABLE>
+    void ResetTable(ObjectTable& table)
+    {
+        table.mType = static_cast<ObjectType>(TableTraits<TABLE>::SPRITE);
+        table.mVelocity = TableTraits<TABLE>::Velocity();
+        table.mPositions.clear();
+    }
+
+    //Rows of a table starting at tableStart that fall in scene indices
+    //[begin, end).
+    void RowsInRange(const uint32_t tableStart, const uint32_t tableSize,
+                     const uint32_t begin, const uint32_t end,
+                     uint32_t& firstRow, uint32_t& lastRow)
+    {
+        const uint32_t tableEnd = tableStart + tableSize;
+        const uint32_t first = std::min(std::max(begin, tableStart), tableEnd);
+        const uint32_t last = std::max(std::min(end, tableEnd), first);
+        firstRow = first - tableStart;
+        lastRow = last - tableStart;
+    }
+
+    template<TableId TABLE>
+    void MoveTableRange(SceneTables& scene,
+                        const uint32_t starts[NUM_TABLES + 1],
+                        const uint32_t begin,
+                        const uint32_t end,
+                        const float lastTime,
+                        const float newTime)
     {
-        swapped = false;
-        for(size_t i = 1; i < objects.size(); ++i)
+        uint32_t firstRow, lastRow;
+        RowsInRange(starts[TABLE], starts[TABLE + 1] - starts[TABLE], begin, end, firstRow, lastRow);
+        MoveRows<TABLE>(scene.mTables[TABLE], firstRow, lastRow, lastTime, newTime);
+    }
+
+    template<TableId TABLE>
+    uint32_t CullTable(const SceneTables& scene,
+                       const uint32_t starts[NUM_TABLES + 1],
+                       const int width, const int height,
+                       SceneFlags& culled,
+                       int cullCounts[NUM_OBJECT_TYPES])
+    {
+        const ObjectTable& table = scene.mTables[TABLE];
+        return CullRows<TABLE>(table, starts[TABLE], 0, static_cast<uint32_t>(table.mPositions.size()),
+            width, height, culled, cullCounts);
+    }
+
+    //Each projectile of the rule's SHOTS table against every object of its
+    //TARGETS table. Returns whether anything was hit.
+    template<CollisionRule RULE>
+    bool CollideTable(const SceneTables& scene,
+                      const uint32_t starts[NUM_TABLES + 1],
+                      SceneFlags& hit,
+                      int hitCounts[NUM_OBJECT_TYPES])
+    {
+        const TableId SHOTS = RuleTraits<RULE>::SHOTS;
+        const TableId TARGETS = RuleTraits<RULE>::TARGETS;
+
+        const PositionVector& shots = scene.mTables[SHOTS].mPositions;
+        const ObjectTable& targets = scene.mTables[TARGETS];
+        const uint32_t firstShot = starts[SHOTS];
+        const uint32_t firstTarget = starts[TARGETS];
+
+        const uint32_t numTargets = static_cast<uint32_t>(targets.mPositions.size());
+
+        bool bHit = false;
+        for(uint32_t shot = 0; shot < shots.size(); ++shot)
         {
-            if(objects[i-1].mType > objects[i].mType)
+            for(uint32_t batch = 0; batch < numTargets; batch += HIT_MASK_BITS)
             {
-                std::swap(objects[i-1], objects[i]);
-                swapped = true;
+                uint32_t mask = ShotHitMask<SHOTS, TARGETS>(shots[shot], &targets.mPositions[batch],
+                    std::min(HIT_MASK_BITS, numTargets - batch));
+                for(uint32_t target = batch; mask; ++target, mask >>= 1)
+                {
+                    if((mask & 1) && RecordHit<SHOTS, TARGETS>(targets, firstShot + shot, firstTarget + target,
+                        hit, hitCounts))
+                    {
+                        bHit = true;
+                    }
+                }
             }
         }
+        return bHit;
+    }
+}
+
+void ResetScene(SceneTables& scene)
+{
+    ResetTable<TABLE_PLAYER>(scene.mTables[TABLE_PLAYER]);
+    ResetTable<TABLE_ALIENS>(scene.mTables[TABLE_ALIENS]);
+    ResetTable<TABLE_BOMBS>(scene.mTables[TABLE_BOMBS]);
+    ResetTable<TABLE_ROCKETS>(scene.mTables[TABLE_ROCKETS]);
+    scene.mDestroyed.mPositions.clear();
+    scene.mDestroyed.mVelocities.clear();
+}
+
+void MaxTableRows(const int width, const int height,
+                  uint32_t rows[NUM_TABLES])
+{
+    //AliensRandomFire drops at most one bomb a second.
+    const float fHeight = static_cast<float>(height);
+    rows[TABLE_PLAYER] = 1;
+    rows[TABLE_ALIENS] = NUM_ALIEN_ROWS * AliensPerRow(width);
+    rows[TABLE_BOMBS] = static_cast<uint32_t>(std::ceil(fHeight / BOMB_SPEED)) + 1;
+    rows[TABLE_ROCKETS] = static_cast<uint32_t>(std::ceil(fHeight / ROCKET_SPEED / QUICKEST_FIRE_PRESSES)) + 1;
+}
+
+uint32_t MaxAliensAcross()
+{
+    return 2 * NUM_ALIEN_ROWS;
+}
+
+void ReserveScene(SceneTables& scene,
+                  const uint32_t rows[NUM_TABLES])
+{
+    uint32_t numObjects = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        scene.mTables[table].mPositions.reserve(rows[table]);
+        numObjects += rows[table];
+    }
+
+    //Everything can be hit at once, in principle.
+    scene.mDestroyed.mPositions.reserve(numObjects);
+    scene.mDestroyed.mVelocities.reserve(numObjects);
+}
+
+size_t CullArenaBytes(const uint32_t rows[NUM_TABLES])
+{
+    //Flags and order cover the destroyed objects as well as the tables.
+    uint32_t numObjects = 0;
+    size_t bytes = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        numObjects += rows[table];
+        bytes += FrameArena::bytesFor<Position>(rows[table]);
+    }
+    return bytes + FrameArena::bytesFor<uint8_t>(numObjects * 2) + FrameArena::bytesFor<uint32_t>(numObjects * 2);
+}
+
+uint32_t NumObjects(const SceneTables& scene)
+{
+    uint32_t count = static_cast<uint32_t>(scene.mDestroyed.mPositions.size());
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        count += static_cast<uint32_t>(scene.mTables[table].mPositions.size());
+    }
+    return count;
+}
+
+uint32_t TableStart(const SceneTables& scene, const TableId table)
+{
+    uint32_t start = 0;
+    for(uint32_t before = 0; before < static_cast<uint32_t>(table); ++before)
+    {
+        start += static_cast<uint32_t>(scene.mTables[before].mPositions.size());
+    }
+    return start;
+}
+
+void TableStarts(const SceneTables& scene, uint32_t starts[NUM_TABLES + 1])
+{
+    starts[0] = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        starts[table + 1] = starts[table] + static_cast<uint32_t>(scene.mTables[table].mPositions.size());
+    }
+}
+
+uint32_t SceneMemory(const SceneTables& scene)
+{
+    size_t bytes = scene.mDestroyed.mPositions.capacity() * sizeof(Position) +
+        scene.mDestroyed.mVelocities.capacity() * sizeof(Vec2);
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        bytes += scene.mTables[table].mPositions.capacity() * sizeof(Position);
+    }
+    return static_cast<uint32_t>(bytes);
+}
+
+void FlattenScene(const SceneTables& scene, SceneObjectVector& objects)
+{
+    objects.resize(NumObjects(scene));
+
+    uint32_t next = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        const ObjectTable& source = scene.mTables[table];
+        for(size_t row = 0; row < source.mPositions.size(); ++row)
+        {
+            SceneObjectData& object = objects[next++];
+            object.mType = source.mType;
+            object.mPosition = source.mPositions[row];
+            object.mVelocity = source.mVelocity;
+        }
+    }
+
+    const DestroyedTable& destroyed = scene.mDestroyed;
+    for(size_t row = 0; row < destroyed.mPositions.size(); ++row)
+    {
+        SceneObjectData& object = objects[next++];
+        object.mType = NULL_OBJECT;
+        object.mPosition = destroyed.mPositions[row];
+        object.mVelocity = destroyed.mVelocities[row];
     }
 }
 
-void CalcAlienBBox(SceneObjectVector& objects,
+bool UnflattenScene(const SceneObjectVector& objects, SceneTables& scene)
+{
+    const TableId tableOfType[NUM_OBJECT_TYPES - 1] =
+    {
+        TABLE_PLAYER, TABLE_ALIENS, TABLE_ALIENS, TABLE_BOMBS, TABLE_ROCKETS,
+    };
+
+    ResetScene(scene);
+
+    uint32_t lastTable = 0;
+    for(size_t index = 0; index < objects.size(); ++index)
+    {
+        const SceneObjectData& object = objects[index];
+        if(object.mType >= NUM_OBJECT_TYPES)
+        {
+            return false;
+        }
+
+        if(object.mType == NULL_OBJECT)
+        {
+            scene.mDestroyed.mPositions.push_back(object.mPosition);
+            scene.mDestroyed.mVelocities.push_back(object.mVelocity);
+            lastTable = NUM_TABLES;
+            continue;
+        }
+
+        const uint32_t table = tableOfType[object.mType];
+        ObjectTable& target = scene.mTables[table];
+        if(table < lastTable)
+        {
+            return false;
+        }
+        if(target.mPositions.empty())
+        {
+            target.mType = object.mType;
+            target.mVelocity = object.mVelocity;
+        }
+        else if(target.mType != object.mType ||
+            target.mVelocity.x() != object.mVelocity.x() ||
+            target.mVelocity.y() != object.mVelocity.y())
+        {
+            return false;
+        }
+        target.mPositions.push_back(object.mPosition);
+        lastTable = table;
+    }
+    return true;
+}
+
+void SpawnAliens(SceneTables& scene, const int windowWidth)
+{
+    ObjectTable& aliens = scene.mTables[TABLE_ALIENS];
+    ResetTable<TABLE_ALIENS>(aliens);
+
+    for(int i =0; i < NUM_ALIEN_ROWS; ++i)
+    {
+        //One row of aliens.
+        CreateObjects(aliens,
+            AliensPerRow(windowWidth),
+            Vec2(1.0f, F_SPRITE_SIZE + F_SPRITE_SIZE * i),
+            Vec2(F_SPRITE_SIZE + 4.0f, 0.0f));
+    }
+}
+
+void CalcAlienBBox(const SceneTables& scene,
                    Box& box)
 {
     box.mBottom = 0.0f;
@@ -43,253 +297,321 @@ void CalcAlienBBox(SceneObjectVector& objects,
     box.mLeft = 100000.0f;
     box.mRight = 0.0f;
 
-    for(SceneObjectVector::iterator itor = objects.begin(); itor != objects.end(); ++itor)
+    const PositionVector& positions = scene.mTables[TABLE_ALIENS].mPositions;
+    for(PositionVector::const_iterator itor = positions.begin(); itor != positions.end(); ++itor)
     {
-        if(itor->mType == ENEMY1 || itor->mType == ENEMY2)
-        {
-            box.mBottom = std::max(box.mBottom, itor->mPosition.y());
-            box.mTop = std::min(box.mTop, itor->mPosition.y()-SPRITE_SIZE);
-            box.mLeft = std::min(box.mLeft, itor->mPosition.x());
-            box.mRight = std::max(box.mRight, itor->mPosition.x()+SPRITE_SIZE);
-        }
+        box.mBottom = std::max(box.mBottom, itor->y());
+        box.mTop = std::min(box.mTop, itor->y()-SPRITE_SIZE);
+        box.mLeft = std::min(box.mLeft, itor->x());
+        box.mRight = std::max(box.mRight, itor->x()+SPRITE_SIZE);
     }
 }
 
-void AliensChangeDirection(SceneObjectVector& objects,
+void AliensChangeDirection(SceneTables& scene,
                            Box& box,
                            const float clampMinX,
                            const float clampMaxX,
                            const float deltaTimeInSecs)
 {
-    const uint32_t count = objects.size();
+    ObjectTable& aliens = scene.mTables[TABLE_ALIENS];
+    aliens.mVelocity = Vec2(-1*aliens.mVelocity.x(), aliens.mVelocity.y());//Reverse x-direction
 
-    for(uint32_t index = FIRST_GENERIC_OBJECT; index < count; ++index)
+    const uint32_t count = static_cast<uint32_t>(aliens.mPositions.size());
+    for(uint32_t index = 0; index < count; ++index)
     {
-        SceneObjectData& obj = objects[index];
-
-        if((objects[index].mType == ENEMY1 ||
-            objects[index].mType == ENEMY2))
-        {
-            objects[index].mPosition += Vec2(0, F_SPRITE_SIZE);//Dropd down
-            objects[index].mVelocity = Vec2(-1*objects[index].mVelocity.x(), objects[index].mVelocity.y());//Reverse x-direction
+        Position& position = aliens.mPositions[index];
+        position += Vec2(0, F_SPRITE_SIZE);//Dropd down
 
-            //Snap position away from the edge so it does not get culled during
-            //CullObjects pass
-            const float clampedX = std::min(std::max(clampMinX, objects[index].mPosition.x()), clampMaxX);
-            objects[index].mPosition = Vec2(clampedX, objects[index].mPosition.y());
-        }
+        //Snap position away from the edge so it does not get culled during
+        //CullObjects pass
+        const float clampedX = std::min(std::max(clampMinX, position.x()), clampMaxX);
+        position = Vec2(clampedX, position.y());
     }
 }
 
 //Pick a random object each second. If the object is an alien
 //then it fires a bomb.
-void AliensRandomFire(SceneObjectVector& objects,
-                 int floorLastTime, int floorNewTime)
+void AliensRandomFire(SceneTables& scene,
+                 int floorLastTime, int floorNewTime,
+                 uint32_t& random)
 {
     if(floorLastTime != floorNewTime) //At least one second has passed.
     {
-        const uint32_t count = objects.size();
-        const uint32_t index = std::rand() % count;
+        const uint32_t count = NumObjects(scene);
+        const uint32_t index = NextRandom(random) % count;
 
-        if(objects[index].mType == ENEMY1 ||
-            objects[index].mType == ENEMY2 )
+        const uint32_t firstAlien = TableStart(scene, TABLE_ALIENS);
+        const PositionVector& aliens = scene.mTables[TABLE_ALIENS].mPositions;
+        if(index >= firstAlien && index - firstAlien < aliens.size())
         {
-            CreateObjects(BOMB, 1,
-                objects[index].mPosition + Vec2(0.0f, F_SPRITE_SIZE),
-                Vec2(0, BOMB_SPEED), Vec2(0, 0), objects);
+            Vec2 position = aliens[index - firstAlien];
+            CreateObjects(scene.mTables[TABLE_BOMBS], 1,
+                position + Vec2(0.0f, F_SPRITE_SIZE),
+                Vec2(0, 0));
         }
     }
 }
 
 //Currently a simple discrete method. Will fail to detect
 //collision if not called frequently enough.
-void CollideObjects(SceneObjectVector& objects,
+void CollideObjects(SceneTables& scene,
+                    FrameArena& arena,
                     int hitCounts[NUM_OBJECT_TYPES])
 {
-    const uint32_t count = objects.size();
-    bool bResort = false;
+    uint32_t starts[NUM_TABLES + 1];
+    TableStarts(scene, starts);
 
-    for(uint32_t index = FIRST_GENERIC_OBJECT; index < count; ++index)
-    {
-        if(objects[index].mType == ROCKET)
-        {
-            //Rocket bitmap dimensions (outside of this is black)
-            //12,7
-            //17,26
-            const float rx = objects[index].mPosition.x() + 12;
-            const float ry = objects[index].mPosition.y() + 7;
-            const float rx2 = rx + 5;
-            const float ry2 = ry + 19;
-            for(uint32_t innerIndex = FIRST_GENERIC_OBJECT; innerIndex < count; ++innerIndex)
-            {
-                if(objects[innerIndex].mType == ENEMY1 || objects[innerIndex].mType == ENEMY2 )
-                {
-                    const float left = objects[innerIndex].mPosition.x();
-                    const float top = objects[innerIndex].mPosition.y();
+    SceneFlags hit = arena.allocate<uint8_t>(NumObjects(scene), 0);
+    bool bHit = CollideTable<RULE_ROCKETS_ALIENS>(scene, starts, hit, hitCounts);
+    bHit = CollideTable<RULE_ROCKETS_BOMBS>(scene, starts, hit, hitCounts) || bHit;
+    bHit = CollideTable<RULE_BOMBS_PLAYER>(scene, starts, hit, hitCounts) || bHit;
 
-                    const float right = left + SPRITE_SIZE;
-                    const float bottom = top + SPRITE_SIZE;
+    if(bHit)
+    {
+        DestroyObjects(scene, hit);
+    }
+}
 
-                    if((rx > left) && (rx < right))
-                    {
-                        if((ry < bottom) && (ry > top))
-                        {
-                            hitCounts[objects[innerIndex].mType]++;
-                            objects[innerIndex].mType = NULL_OBJECT;
-                            objects[index].mType = NULL_OBJECT;
-                            bResort = true;
-                        }
-                    }
-                }
-            }
-        }
+void DestroyObjects(SceneTables& scene,
+                    const SceneFlags& hit)
+{
+    uint32_t numHit = 0;
+    const uint32_t numRows = NumObjects(scene) - static_cast<uint32_t>(scene.mDestroyed.mPositions.size());
+    for(uint32_t index = 0; index < numRows; ++index)
+    {
+        numHit += hit[index];
+    }
 
-        if(objects[index].mType == BOMB)
+    //Make room in front of the objects already destroyed. Both tables keep
+    //the memory they have.
+    DestroyedTable& destroyed = scene.mDestroyed;
+    const size_t numOld = destroyed.mPositions.size();
+    destroyed.mPositions.resize(numOld + numHit);
+    destroyed.mVelocities.resize(numOld + numHit);
+    std::copy_backward(destroyed.mPositions.begin(), destroyed.mPositions.begin() + numOld,
+        destroyed.mPositions.end());
+    std::copy_backward(destroyed.mVelocities.begin(), destroyed.mVelocities.begin() + numOld,
+        destroyed.mVelocities.end());
+
+    uint32_t index = 0;
+    uint32_t numDestroyed = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        ObjectTable& source = scene.mTables[table];
+        uint32_t kept = 0;
+        for(uint32_t row = 0; row < source.mPositions.size(); ++row, ++index)
         {
-            //Bomb bitmap dimensions (outside of this is black)
-            //9,8
-            //20,25
-            const float rx = objects[index].mPosition.x() + 9;
-            const float ry = objects[index].mPosition.y() + 8;
-            const float rx2 = rx + 11;
-            const float ry2 = ry + 17;
-            
-            const uint32_t innerIndex = 0;
-
-            const float left = objects[innerIndex].mPosition.x();
-            const float top = objects[innerIndex].mPosition.y();
-
-            const float right = left + SPRITE_SIZE;
-            const float bottom = top + SPRITE_SIZE;
-
-            if((rx > left) && (rx < right))
+            if(hit[index])
             {
-                if((ry < bottom) && (ry > top))
-                {
-                    hitCounts[objects[innerIndex].mType]++;
-                    objects[index].mType = NULL_OBJECT;
-                    bResort = true;
-                }
+                destroyed.mPositions[numDestroyed] = source.mPositions[row];
+                destroyed.mVelocities[numDestroyed] = source.mVelocity;
+                numDestroyed++;
+            }
+            else
+            {
+                source.mPositions[kept++] = source.mPositions[row];
             }
         }
+        source.mPositions.resize(kept);
     }
+}
+
+void CullObjects(SceneTables& scene,
+                 FrameArena& arena,
+                 const int width, const int height,
+                 int cullCounts[NUM_OBJECT_TYPES])
+{
+    DeleteDestroyedObjects(scene, cullCounts);
 
-    //Some objects may have changed to null type.
-    if(bResort)
+    uint32_t starts[NUM_TABLES + 1];
+    TableStarts(scene, starts);
+
+    SceneFlags culled = arena.allocate<uint8_t>(NumObjects(scene), 0);
+    uint32_t numCulled = 0;
+    numCulled += CullTable<TABLE_PLAYER>(scene, starts, width, height, culled, cullCounts);
+    numCulled += CullTable<TABLE_ALIENS>(scene, starts, width, height, culled, cullCounts);
+    numCulled += CullTable<TABLE_BOMBS>(scene, starts, width, height, culled, cullCounts);
+    numCulled += CullTable<TABLE_ROCKETS>(scene, starts, width, height, culled, cullCounts);
+
+    if(numCulled)
     {
-        SortObjectsByType(objects);
+        RemoveCulledObjects(scene, culled, numCulled, arena);
     }
 }
 
-void CullObjects(SceneObjectVector& objects,
-                 const int width, const int height,
-                 int cullCounts[NUM_OBJECT_TYPES])
+void DeleteDestroyedObjects(SceneTables& scene,
+                            int cullCounts[NUM_OBJECT_TYPES])
 {
-    bool bResort = false;
+    cullCounts[NULL_OBJECT] += static_cast<int>(scene.mDestroyed.mPositions.size());
+    scene.mDestroyed.mPositions.clear();
+    scene.mDestroyed.mVelocities.clear();
+}
 
-    //Delete null objects. They are sorted to be at the end of the
-    //vector.
-    assert(NULL_OBJECT == NUM_OBJECT_TYPES -1);
-    while(objects[objects.size()-1].mType == NULL_OBJECT)
+void RemoveCulledObjects(SceneTables& scene,
+                         const SceneFlags& culled,
+                         const uint32_t numCulled,
+                         FrameArena& arena)
+{
+    assert(scene.mDestroyed.mPositions.empty());
+    if(!numCulled)
     {
-         objects.pop_back();
-         cullCounts[NULL_OBJECT]++;
+        return;
     }
 
-    uint32_t count = objects.size();
+    //Objects are deleted in the order a single sorted list of them used
+    //to: each culled object is swapped with the last one, which is checked
+    //again in its place, then the list is put back in type order. That
+    //order is which alien AliensRandomFire picks, so it is kept.
+    uint32_t count = NumObjects(scene);
+    ArenaSpan<uint32_t> order = arena.allocate<uint32_t>(count);
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        order[index] = index;
+    }
     for(uint32_t index = FIRST_GENERIC_OBJECT; index < count;)
     {
-        if(objects[index].mPosition.x() < -1 || 
-            objects[index].mPosition.x() > width+1 ||
-            objects[index].mPosition.y() < -1 || 
-            objects[index].mPosition.y() > height+1)
+        if(culled[order[index]])
         {
-            cullCounts[objects[index].mType]++;
-
-            //Best to delete from the end of vector. Swap with the end object
-            //then delete.
-            objects[index] = objects.back();
-            objects.pop_back();
+            order[index] = order[count-1];
             count--;
-            //Don't update index
-            --index;
-            bResort = true;
         }
-        ++index;
+        else
+        {
+            ++index;
+        }
+    }
+
+    uint32_t tableEnds[NUM_TABLES];
+    uint32_t end = 0;
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        end += static_cast<uint32_t>(scene.mTables[table].mPositions.size());
+        tableEnds[table] = end;
     }
 
-    if(bResort)
+    ArenaSpan<Position> positions[NUM_TABLES];
+    uint32_t numKept[NUM_TABLES];
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
     {
-        SortObjectsByType(objects);
+        positions[table] = arena.allocate<Position>(static_cast<uint32_t>(scene.mTables[table].mPositions.size()));
+        numKept[table] = 0;
+    }
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        const uint32_t object = order[index];
+        uint32_t table = 0;
+        while(object >= tableEnds[table])
+        {
+            ++table;
+        }
+        const uint32_t row = object - (table ? tableEnds[table - 1] : 0);
+        positions[table][numKept[table]++] = scene.mTables[table].mPositions[row];
+    }
+
+    //Copied back, so each table keeps its own memory.
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
+    {
+        scene.mTables[table].mPositions.assign(positions[table].begin(),
+            positions[table].begin() + numKept[table]);
     }
 }
 
-void Animate(SceneObjectVector& objects,
+void Animate(SceneTables& scene,
              const int timeInSecs)
 {
-    const uint32_t count = objects.size();
+    AnimateRange(scene, FIRST_GENERIC_OBJECT, NumObjects(scene), timeInSecs);
+    AnimateSprites(scene, timeInSecs);
+}
+
+void AnimateRange(SceneTables& scene,
+                  const uint32_t begin,
+                  const uint32_t end,
+                  const int timeInSecs)
+{
+    ObjectTable& aliens = scene.mTables[TABLE_ALIENS];
 
-    for(uint32_t index = FIRST_GENERIC_OBJECT; index < count; ++index)
+    //Move when sprite changes.
+    if(TableSprite<TABLE_ALIENS>(timeInSecs) == aliens.mType)
     {
-        const ObjectType type = objects[index].mType;
-        if(type == ENEMY1 || type == ENEMY2)
-        {
-            if(timeInSecs & 1)
-                objects[index].mType = ENEMY2;
-            else
-                objects[index].mType = ENEMY1;
+        return;
+    }
 
-            //Move when sprite changes.
-            if(type != objects[index].mType)
-            {
-                objects[index].mPosition += Vec2(ALIEN_SPEED * objects[index].mVelocity.x(), 0);
-            }
-        }
+    uint32_t first, last;
+    RowsInRange(TableStart(scene, TABLE_ALIENS), static_cast<uint32_t>(aliens.mPositions.size()),
+        begin, end, first, last);
+    const Position step = Vec2(TableTraits<TABLE_ALIENS>::Speed() * aliens.mVelocity.x(), 0);
+    for(uint32_t row = first; row < last; ++row)
+    {
+        aliens.mPositions[row] += step;
     }
 }
 
-void MoveObjects(SceneObjectVector& objects,
-                 const float deltaTimeInSecs)
+void AnimateSprites(SceneTables& scene,
+                    const int timeInSecs)
 {
-    const uint32_t count = objects.size();
-    for(uint32_t index = FIRST_GENERIC_OBJECT; index < count; ++index)
-    {
-        objects[index].mPosition += objects[index].mVelocity * deltaTimeInSecs;
-    }
+    scene.mTables[TABLE_ALIENS].mType = TableSprite<TABLE_ALIENS>(timeInSecs);
+}
+
+void MoveObjects(SceneTables& scene,
+                 const float lastTime,
+                 const float newTime)
+{
+    MoveObjectRange(scene, FIRST_GENERIC_OBJECT, NumObjects(scene), lastTime, newTime);
 }
 
-void DrawObjects(SceneObjectVector& objects,
+void MoveObjectRange(SceneTables& scene,
+                     const uint32_t begin,
+                     const uint32_t end,
+                     const float lastTime,
+                     const float newTime)
+{
+    uint32_t starts[NUM_TABLES + 1];
+    TableStarts(scene, starts);
+    MoveTableRange<TABLE_PLAYER>(scene, starts, begin, end, lastTime, newTime);
+    MoveTableRange<TABLE_ALIENS>(scene, starts, begin, end, lastTime, newTime);
+    MoveTableRange<TABLE_BOMBS>(scene, starts, begin, end, lastTime, newTime);
+    MoveTableRange<TABLE_ROCKETS>(scene, starts, begin, end, lastTime, newTime);
+}
+
+void DrawObjects(const SceneTables& scene,
                  ISprite* __restrict sprites[NUM_OBJECT_TYPES])
 {
-    const uint32_t count = objects.size();
-    for(uint32_t index = 0; index < count; ++index)
+    for(uint32_t table = 0; table < NUM_TABLES; ++table)
     {
-        assert(objects[index].mType < NUM_OBJECT_TYPES);
-        sprites[objects[index].mType]->draw(static_cast<int>(objects[index].mPosition.x()),
-                                            static_cast<int>(objects[index].mPosition.y())-SPRITE_SIZE);
+        const ObjectTable& source = scene.mTables[table];
+        ISprite* sprite = sprites[source.mType];
+        for(size_t row = 0; row < source.mPositions.size(); ++row)
+        {
+            sprite->draw(static_cast<int>(source.mPositions[row].x()),
+                         static_cast<int>(source.mPositions[row].y())-SPRITE_SIZE);
+        }
     }
+
+    const PositionVector& destroyed = scene.mDestroyed.mPositions;
+    for(size_t row = 0; row < destroyed.size(); ++row)
+    {
+        sprites[NULL_OBJECT]->draw(static_cast<int>(destroyed[row].x()),
+                                   static_cast<int>(destroyed[row].y())-SPRITE_SIZE);
+    }
+
+    LatencyMark(LATENCY_DRAWN);
 }
 
-//Add <count> objects of <type>. Intitialse with given position and veclocity.
-void CreateObjects(const ObjectType type,
+//Add <count> objects to <table>, the first at pos.
+void CreateObjects(ObjectTable& table,
                    const uint32_t count,
                    const Vec2& pos,
-                   const Vec2& vel,
-                   const Vec2& deltaPos,
-                   SceneObjectVector& objects)
+                   const Vec2& deltaPos)
 {
-    assert(type < NUM_OBJECT_TYPES);
     Vec2 accumPos = pos;
     for(uint32_t index = 0; index < count; ++index)
     {
-        SceneObjectData newObject;
-        newObject.mType = type;
-        newObject.mPosition = accumPos;
-        newObject.mVelocity = vel;
-        objects.push_back(newObject);
-
+        table.mPositions.push_back(accumPos);
         accumPos += deltaPos;
     }
 
-    SortObjectsByType(objects);
+    if(table.mType == ROCKET)
+    {
+        LatencyMark(LATENCY_CREATED);
+    }
 }
@@ -2,7 +2,10 @@
 #define SCENE_OBJECT_H
 
 #include <vector>
+#include "AlignedAllocator.h"
 #include "DiceInvaders.h"
+#include "FixedPoint.h"
+#include "FrameArena.h"
 #include "pstdint.h"
 #include "Vec2.h"
 
@@ -18,6 +21,7 @@ enum ObjectType {
     NUM_OBJECT_TYPES,
 };
 
+//One object of the scene as a flat list, see FlattenScene.
 struct SceneObjectData
 {
     SceneObjectData(){}
@@ -28,6 +32,65 @@ struct SceneObjectData
 
 typedef std::vector<SceneObjectData> SceneObjectVector;
 
+//Where objects are. Builds with FIXED_POSITIONS keep FixedVec2s, half
+//the size and the same on every compiler and CPU, but limited to windows
+//up to 4096 pixels and 1/8 pixel steps, so they play differently.
+#if defined(FIXED_POSITIONS)
+typedef FixedVec2 Position;
+#else
+typedef Vec2 Position;
+#endif
+
+//Positions are what every pass reads, so they are kept apart from
+//everything else, packed into cache lines starting on one.
+typedef std::vector<Position, AlignedAllocator<Position, CACHE_LINE_SIZE> > PositionVector;
+
+//The kinds of object, in the order their objects come in the scene.
+enum TableId
+{
+    TABLE_PLAYER,
+    TABLE_ALIENS,
+    TABLE_BOMBS,
+    TABLE_ROCKETS,
+    NUM_TABLES,
+};
+
+//Every object of one kind. Objects only differ in position; the sprite
+//and velocity belong to the whole table, as aliens animate and march as
+//one formation and projectiles all fly straight at the same speed.
+//Systems run over a table at a time, so a new kind of object is a new
+//table rather than another branch in every loop.
+struct ObjectTable
+{
+    ObjectType mType;
+    Vec2 mVelocity;
+    PositionVector mPositions;
+};
+
+//Objects hit by CollideObjects, until CullObjects deletes them. Until
+//then they still count towards the objects AliensRandomFire picks from,
+//are drawn with the NULL_OBJECT sprite and are recorded with the
+//velocity they had, so they keep one. Only FlattenScene reads that, so
+//it stays out of the positions' cache lines.
+struct DestroyedTable
+{
+    PositionVector mPositions;
+    std::vector<Vec2> mVelocities;
+};
+
+//The game's objects. Scene order is every table in TableId order
+//followed by the destroyed objects, which is the order SortObjectsByType
+//used to keep a single list of objects in. Scene indices count objects
+//in that order.
+struct SceneTables
+{
+    ObjectTable mTables[NUM_TABLES];
+    DestroyedTable mDestroyed;
+};
+
+//One flag per object in scene order, for a frame.
+typedef ArenaSpan<uint8_t> SceneFlags;
+
 struct Box
 {
     float mLeft;
@@ -55,44 +118,139 @@ const float ROCKET_RATE_OF_FIRE = 0.3f;
 const int MAX_SCORE = 99999999;
 const int MAX_SCORE_DIGITS = 8;
 
-void CreateObjects(const ObjectType type,
+//Linear congruential generator. The state lives in GameState rather than
+//behind std::rand so a game can be saved, restored and replayed exactly.
+inline uint32_t NextRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+//Empty every table and give each its sprite and velocity.
+void ResetScene(SceneTables& scene);
+
+//The most rows each table holds at once in a game in a window of width by
+//height: one wave of aliens, and the bombs and rockets that can be fired
+//in the time one takes to cross the window. Rows past these are still
+//fine, they only cost the tables a reallocation.
+void MaxTableRows(const int width, const int height,
+                  uint32_t rows[NUM_TABLES]);
+
+//Aliens whose boxes an interval across no wider than a sprite can
+//overlap. A wave moves as one and its columns are more than a sprite
+//apart, so it is two columns at most.
+uint32_t MaxAliensAcross();
+
+//Make room for MaxTableRows in the tables, so a game's frames do not
+//grow them. Only their capacity changes.
+void ReserveScene(SceneTables& scene,
+                  const uint32_t rows[NUM_TABLES]);
+
+//The most FrameArena bytes CullObjects takes for a scene of rows, see
+//MaxTableRows.
+size_t CullArenaBytes(const uint32_t rows[NUM_TABLES]);
+
+//Objects of every table, destroyed ones included.
+uint32_t NumObjects(const SceneTables& scene);
+
+//Scene index of the table's first object.
+uint32_t TableStart(const SceneTables& scene, const TableId table);
+
+//TableStart of every table, and of NUM_TABLES: where the destroyed
+//objects start.
+void TableStarts(const SceneTables& scene, uint32_t starts[NUM_TABLES + 1]);
+
+//Bytes allocated for objects, not counting the SceneTables itself.
+uint32_t SceneMemory(const SceneTables& scene);
+
+//The scene as one list sorted by type, the form recordings, snapshots and
+//checksums use.
+void FlattenScene(const SceneTables& scene, SceneObjectVector& objects);
+
+//The scene FlattenScene made objects from. False if no scene flattens to
+//objects: they are not sorted by type, or objects of one table differ in
+//sprite or velocity.
+bool UnflattenScene(const SceneObjectVector& objects, SceneTables& scene);
+
+//Add <count> objects to table. Each one deltaPos on from the last.
+void CreateObjects(ObjectTable& table,
                    const uint32_t count,
                    const Vec2& pos,
-                   const Vec2& vel,
-                   const Vec2& deltaPos,
-                   SceneObjectVector& objects);
+                   const Vec2& deltaPos);
 
-void DrawObjects(SceneObjectVector& objects,
+void DrawObjects(const SceneTables& scene,
                  ISprite* __restrict sprites[NUM_OBJECT_TYPES]);
 
-void MoveObjects(SceneObjectVector& objects,
-                 const float deltaTimeInSecs);
+//Objects move with their table's velocity from lastTime to newTime, the
+//game times at the start and end of the frame. Destroyed objects stay
+//where they are, as they are deleted before anything looks at them again.
+void MoveObjects(SceneTables& scene,
+                 const float lastTime,
+                 const float newTime);
+
+//MoveObjects over scene indices [begin, end) only. Ranges that do not
+//overlap can move on different threads.
+void MoveObjectRange(SceneTables& scene,
+                     const uint32_t begin,
+                     const uint32_t end,
+                     const float lastTime,
+                     const float newTime);
+
+//Switch the aliens' sprite each second. The formation steps whenever it
+//does.
+void Animate(SceneTables& scene,
+             const int timeInSecs);
 
-void Animate(SceneObjectVector& objects,
-                 const int timeInSecs);
+//The step of Animate over scene indices [begin, end) only. Call
+//AnimateSprites once every range has stepped.
+void AnimateRange(SceneTables& scene,
+                  const uint32_t begin,
+                  const uint32_t end,
+                  const int timeInSecs);
+void AnimateSprites(SceneTables& scene,
+                    const int timeInSecs);
 
-void CullObjects(SceneObjectVector& objects,
+void CullObjects(SceneTables& scene,
+                 FrameArena& arena,
                  const int width, const int height,
                  int cullCounts[NUM_OBJECT_TYPES]);
 
-void CollideObjects(SceneObjectVector& objects,
+//The steps of CullObjects. DeleteDestroyedObjects comes first and
+//RemoveCulledObjects takes the flags of the objects left after it, set
+//for the objects outside the window. numCulled is how many are set.
+void DeleteDestroyedObjects(SceneTables& scene,
+                            int cullCounts[NUM_OBJECT_TYPES]);
+void RemoveCulledObjects(SceneTables& scene,
+                         const SceneFlags& culled,
+                         const uint32_t numCulled,
+                         FrameArena& arena);
+
+//Every projectile against every object of each table it hits, rule by
+//rule of ObjectTraits.h. The reference for the broadphase of
+//Broadphase.h, which the game uses.
+void CollideObjects(SceneTables& scene,
+                    FrameArena& arena,
                     int hitCounts[NUM_OBJECT_TYPES]);
 
-void AliensRandomFire(SceneObjectVector& objects,
-                 int floorLastTime, int floorNewTime);
+//Move the objects flagged in hit, by scene index, to the destroyed
+//table. They go before any already there, in scene order.
+void DestroyObjects(SceneTables& scene,
+                    const SceneFlags& hit);
+
+//random is the game's generator state, see NextRandom.
+void AliensRandomFire(SceneTables& scene,
+                 int floorLastTime, int floorNewTime,
+                 uint32_t& random);
 
-void AliensChangeDirection(SceneObjectVector& objects,
+void AliensChangeDirection(SceneTables& scene,
                            Box& box,
                            const float clampMinX,
                            const float clampMaxX,
                            const float deltaTimeInSecs);
 
-void CalcAlienBBox(SceneObjectVector& objects,
+void CalcAlienBBox(const SceneTables& scene,
                    Box& box);
 
-void SortObjectsByType(SceneObjectVector& objects);
-
-
-void SpawnAliens(SceneObjectVector& objects, const int windowWidth);
+void SpawnAliens(SceneTables& scene, const int windowWidth);
 
 #endif
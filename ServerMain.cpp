@@ -0,0 +1,86 @@
+//Headless game server for Linux. Hosts one game per TCP connection on
+//loopback. See GameServer.h.
+//Usage: GameServer [-port N] [-threads N] [-tickrate N] [-budget BYTES]
+//                  [-sessions N] [-seconds N] [-export NAME]
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+
+#include "GameServer.h"
+#include "Threading.h"
+
+static GameServer* gServer = 0;
+
+static void HandleSignal(int)
+{
+    if(gServer)
+    {
+        gServer->stop();
+    }
+}
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+//Returns the argument following option in argv or null.
+static const char* GetOptionString(int argc, char** argv, const char* option)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return argv[index + 1];
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    ServerConfig config;
+    config.mPort = static_cast<uint16_t>(GetOptionInt(argc, argv, "-port", SERVER_DEFAULT_PORT));
+    config.mNumThreads = std::max(GetOptionInt(argc, argv, "-threads", GetHardwareThreadCount()), 1);
+    config.mTickRate = std::max(GetOptionInt(argc, argv, "-tickrate", config.mTickRate), 1);
+    config.mSessionBudget = GetOptionInt(argc, argv, "-budget", config.mSessionBudget);
+    config.mMaxSessions = GetOptionInt(argc, argv, "-sessions", config.mMaxSessions);
+    config.mSeconds = GetOptionInt(argc, argv, "-seconds", 0);
+    config.mExportName = GetOptionString(argc, argv, "-export");
+
+    //One descriptor per session.
+    rlimit files;
+    if(getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    GameServer server(config);
+    if(!server.init())
+    {
+        return 1;
+    }
+
+    gServer = &server;
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+
+    server.run();
+
+    gServer = 0;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SERVER_PROTOCOL_H
+#define SERVER_PROTOCOL_H
+
+#include "DiceInvaders.h"
+#include "pstdint.h"
+
+//Wire format between GameServer and its clients. Messages are fixed size
+//structs in native byte order, which is fine for loopback.
+
+const uint16_t SERVER_DEFAULT_PORT = 27960;
+
+//Every session plays on a playfield of this size.
+const int SERVER_WINDOW_WIDTH = 1280;
+const int SERVER_WINDOW_HEIGHT = 720;
+
+enum InputBits
+{
+    INPUT_FIRE = 1,
+    INPUT_LEFT = 2,
+    INPUT_RIGHT = 4,
+};
+
+//Client -> server, sent whenever the keys change.
+struct InputMessage
+{
+    uint32_t mSequence;
+    uint8_t mKeys;//InputBits
+    uint8_t mPadding[3];
+};
+
+//Server -> client, one per tick.
+struct StateMessage
+{
+    uint32_t mTick;
+    uint32_t mInputSequence;//Last input applied.
+    int32_t mScore;
+    uint16_t mNumObjects;
+    uint8_t mLives;
+    uint8_t mGames;//Games finished, wraps.
+};
+
+inline uint8_t PackKeys(const IDiceInvaders::KeyStatus& keys)
+{
+    return static_cast<uint8_t>((keys.fire ? INPUT_FIRE : 0) |
+                                (keys.left ? INPUT_LEFT : 0) |
+                                (keys.right ? INPUT_RIGHT : 0));
+}
+
+inline void UnpackKeys(uint8_t bits, IDiceInvaders::KeyStatus& keys)
+{
+    keys.fire = (bits & INPUT_FIRE) != 0;
+    keys.left = (bits & INPUT_LEFT) != 0;
+    keys.right = (bits & INPUT_RIGHT) != 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+//Measures SnapshotCodec on real game scenes at growing sizes.
+//Usage: SnapshotBench [-ticks N] [-ackdelay N]
+//Columns: raw bytes of the SceneObjectVector, a full snapshot, the mean
+//packet and the largest (the full ones sent before the first ack).
+//A wider playfield spawns wider alien rows, so each scale multiplies the
+//object count. Every packet is decoded and checked against the encoder.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Game.h"
+#include "SnapshotCodec.h"
+#include "Timer.h"
+
+//Returns the integer following option in argv or defaultValue if the
+//option is not present.
+static int GetOptionInt(int argc, char** argv, const char* option, int defaultValue)
+{
+    for(int index = 1; index + 1 < argc; ++index)
+    {
+        if(std::strcmp(argv[index], option) == 0)
+        {
+            return std::atoi(argv[index + 1]);
+        }
+    }
+    return defaultValue;
+}
+
+static bool SameSnapshot(const Snapshot& a, const Snapshot& b)
+{
+    if(a.mTick != b.mTick || a.mObjects.size() != b.mObjects.size() ||
+        std::memcmp(a.mTypeStart, b.mTypeStart, sizeof(a.mTypeStart)) != 0)
+    {
+        return false;
+    }
+    return a.mObjects.empty() ||
+        std::memcmp(&a.mObjects[0], &b.mObjects[0], a.mObjects.size() * sizeof(QuantizedObject)) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t numTicks = GetOptionInt(argc, argv, "-ticks", 600);
+    const uint32_t ackDelay = GetOptionInt(argc, argv, "-ackdelay", 3);
+    const int widths[] = {1280, 8192, 32768, 131072};
+    const float tickTime = 1.0f / 60.0f;
+
+    std::printf("%8s %8s %10s %10s %10s %10s %12s %12s\n",
+        "width", "objects", "raw B", "full B", "delta B", "max B", "enc ns/obj", "dec ns/obj");
+
+    for(uint32_t scale = 0; scale < sizeof(widths) / sizeof(widths[0]); ++scale)
+    {
+        GameState state(widths[scale], 720);
+        ResetLevel(state, 0.0f);
+
+        SnapshotEncoder encoder;
+        SnapshotDecoder decoder;
+        std::vector<uint8_t> packet;
+        SceneObjectVector objects;
+        SceneObjectVector decoded;
+
+        uint64_t deltaBytes = 0;
+        uint32_t maxBytes = 0;
+        uint64_t objectTicks = 0;
+        uint64_t encodeTime = 0;
+        uint64_t decodeTime = 0;
+        uint32_t mismatches = 0;
+
+        for(uint32_t tick = 1; tick <= numTicks; ++tick)
+        {
+            //Sweep left and right with fire held.
+            FrameInput input;
+            input.mTime = tick * tickTime;
+            input.mKeys.fire = true;
+            input.mKeys.left = (tick / 90) % 2 == 0;
+            input.mKeys.right = !input.mKeys.left;
+            input.mTimestamped = false;
+            input.mNumEvents = 0;
+            SimulateGame(state, input);
+            if(!state.mPlayerLives)
+            {
+                ResetLevel(state, input.mTime);
+            }
+
+            FlattenScene(state.mScene, objects);
+            packet.clear();
+            const uint64_t encodeStart = GetTimeNanoseconds();
+            const uint32_t size = encoder.encode(tick, objects, packet);
+            const uint64_t decodeStart = GetTimeNanoseconds();
+            uint32_t decodedTick = 0;
+            const bool ok = decoder.decode(&packet[0], size, decodedTick, decoded);
+            const uint64_t decodeEnd = GetTimeNanoseconds();
+
+            encodeTime += decodeStart - encodeStart;
+            decodeTime += decodeEnd - decodeStart;
+            deltaBytes += size;
+            maxBytes = std::max(maxBytes, size);
+            objectTicks += objects.size();
+
+            if(!ok || !SameSnapshot(encoder.getLastSnapshot(), decoder.getLastSnapshot()))
+            {
+                mismatches++;
+            }
+
+            //The ack for a tick arrives ackDelay ticks later.
+            if(tick > ackDelay)
+            {
+                encoder.acknowledge(tick - ackDelay);
+            }
+        }
+
+        SnapshotEncoder fullEncoder;
+        packet.clear();
+        const uint32_t fullBytes = fullEncoder.encode(1, objects, packet);
+
+        std::printf("%8d %8u %10u %10u %10.1f %10u %12.1f %12.1f%s\n",
+            widths[scale],
+            static_cast<uint32_t>(objects.size()),
+            static_cast<uint32_t>(objects.size() * sizeof(SceneObjectData)),
+            fullBytes,
+            static_cast<double>(deltaBytes) / numTicks,
+            maxBytes,
+            static_cast<double>(encodeTime) / objectTicks,
+            static_cast<double>(decodeTime) / objectTicks,
+            mismatches ? "  MISMATCH" : "");
+
+        if(mismatches)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,566 @@
+#include "SnapshotCodec.h"
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    enum SnapshotOp
+    {
+        OP_MATCH,//count objects are their baseline plus the range offset.
+        OP_SKIP,//count baseline objects are gone.
+        OP_LITERAL,//count objects follow as residuals from their prediction.
+        OP_NEW,//count objects follow in full. They use no baseline object.
+        NUM_SNAPSHOT_OPS,
+    };
+
+    //How far ahead the encoder looks for an object whose baseline
+    //predecessors were destroyed.
+    const uint32_t MAX_SKIP_LOOKAHEAD = 4;
+
+    QuantizedObject Add(const QuantizedObject& a, const QuantizedObject& b)
+    {
+        QuantizedObject result;
+        result.mX = a.mX + b.mX;
+        result.mY = a.mY + b.mY;
+        result.mVelocityX = a.mVelocityX + b.mVelocityX;
+        result.mVelocityY = a.mVelocityY + b.mVelocityY;
+        return result;
+    }
+
+    QuantizedObject Subtract(const QuantizedObject& a, const QuantizedObject& b)
+    {
+        QuantizedObject result;
+        result.mX = a.mX - b.mX;
+        result.mY = a.mY - b.mY;
+        result.mVelocityX = a.mVelocityX - b.mVelocityX;
+        result.mVelocityY = a.mVelocityY - b.mVelocityY;
+        return result;
+    }
+
+    bool Equal(const QuantizedObject& a, const QuantizedObject& b)
+    {
+        return a.mX == b.mX && a.mY == b.mY &&
+            a.mVelocityX == b.mVelocityX && a.mVelocityY == b.mVelocityY;
+    }
+
+    //Close enough to send as a match. Positions are rounded one object at a
+    //time, so objects moving together can land one step either side of the
+    //shared offset.
+    bool Near(const QuantizedObject& a, const QuantizedObject& b)
+    {
+        return std::abs(a.mX - b.mX) <= SNAPSHOT_POSITION_TOLERANCE &&
+            std::abs(a.mY - b.mY) <= SNAPSHOT_POSITION_TOLERANCE &&
+            a.mVelocityX == b.mVelocityX && a.mVelocityY == b.mVelocityY;
+    }
+
+    void WriteVarint(uint32_t value, std::vector<uint8_t>& out)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void WriteSigned(int32_t value, std::vector<uint8_t>& out)
+    {
+        //Zigzag so small negative numbers stay short.
+        WriteVarint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31), out);
+    }
+
+    void WriteObject(const QuantizedObject& object, std::vector<uint8_t>& out)
+    {
+        WriteSigned(object.mX, out);
+        WriteSigned(object.mY, out);
+        WriteSigned(object.mVelocityX, out);
+        WriteSigned(object.mVelocityY, out);
+    }
+
+    class PacketReader
+    {
+    public:
+        PacketReader(const uint8_t* data, uint32_t size) : mData(data),
+            mEnd(data + size),
+            mError(false)
+        {
+        }
+
+        uint32_t readVarint()
+        {
+            uint32_t value = 0;
+            for(uint32_t shift = 0; shift < 35; shift += 7)
+            {
+                if(mData == mEnd)
+                {
+                    mError = true;
+                    return 0;
+                }
+                const uint8_t byte = *mData++;
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if(!(byte & 0x80))
+                {
+                    return value;
+                }
+            }
+            mError = true;
+            return 0;
+        }
+
+        int32_t readSigned()
+        {
+            const uint32_t value = readVarint();
+            return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+        }
+
+        void readObject(QuantizedObject& object)
+        {
+            object.mX = readSigned();
+            object.mY = readSigned();
+            object.mVelocityX = readSigned();
+            object.mVelocityY = readSigned();
+        }
+
+        bool failed() const
+        {
+            return mError;
+        }
+
+        bool atEnd() const
+        {
+            return mData == mEnd;
+        }
+
+    private:
+        const uint8_t* mData;
+        const uint8_t* mEnd;
+        bool mError;
+    };
+
+    //Collects consecutive ops of one kind into a single op.
+    class OpWriter
+    {
+    public:
+        explicit OpWriter(std::vector<uint8_t>& out) : mOut(out),
+            mOp(OP_MATCH),
+            mCount(0)
+        {
+        }
+
+        void add(SnapshotOp op, uint32_t count)
+        {
+            if(op != mOp)
+            {
+                flush();
+                mOp = op;
+            }
+            mCount += count;
+        }
+
+        void addObject(SnapshotOp op, const QuantizedObject& object)
+        {
+            add(op, 1);
+            WriteObject(object, mPayload);
+        }
+
+        void flush()
+        {
+            if(mCount)
+            {
+                WriteVarint((mCount << 2) | mOp, mOut);
+                mOut.insert(mOut.end(), mPayload.begin(), mPayload.end());
+            }
+            mPayload.clear();
+            mCount = 0;
+        }
+
+    private:
+        std::vector<uint8_t>& mOut;
+        std::vector<uint8_t> mPayload;
+        SnapshotOp mOp;
+        uint32_t mCount;
+    };
+}
+
+//Offset that moves baseline onto current, taken from the first current
+//object and whichever of the first baseline objects predicts the next one.
+static QuantizedObject FindRangeOffset(const QuantizedObject* current,
+                                       uint32_t numCurrent,
+                                       const QuantizedObject* baseline,
+                                       uint32_t numBaseline)
+{
+    QuantizedObject offset = {0, 0, 0, 0};
+    if(!numCurrent || !numBaseline)
+    {
+        return offset;
+    }
+
+    offset = Subtract(current[0], baseline[0]);
+    for(uint32_t skip = 0; skip < MAX_SKIP_LOOKAHEAD && skip < numBaseline; ++skip)
+    {
+        const QuantizedObject candidate = Subtract(current[0], baseline[skip]);
+        if(numCurrent == 1 || skip + 1 == numBaseline ||
+            Equal(current[1], Add(baseline[skip + 1], candidate)))
+        {
+            return candidate;
+        }
+    }
+    return offset;
+}
+
+//Objects of type in snapshot. None without a snapshot.
+static uint32_t GetRange(const Snapshot* snapshot,
+                         uint32_t type,
+                         const QuantizedObject*& objects)
+{
+    objects = 0;
+    if(!snapshot)
+    {
+        return 0;
+    }
+
+    const uint32_t begin = snapshot->mTypeStart[type];
+    const uint32_t count = snapshot->mTypeStart[type + 1] - begin;
+    if(count)
+    {
+        objects = &snapshot->mObjects[begin];
+    }
+    return count;
+}
+
+//Animate flips the whole formation between ENEMY1 and ENEMY2, so an alien
+//range with no baseline of its own is predicted from the other one.
+static uint32_t ChooseBaselineType(const Snapshot* baseline,
+                                   uint32_t type)
+{
+    const QuantizedObject* objects;
+    if((type == ENEMY1 || type == ENEMY2) && !GetRange(baseline, type, objects))
+    {
+        return type == ENEMY1 ? ENEMY2 : ENEMY1;
+    }
+    return type;
+}
+
+//Matched objects are replaced by their prediction, so the encoder's copy
+//of the snapshot stays identical to what the decoder rebuilds.
+static void EncodeRange(uint32_t type,
+                        Snapshot& snapshot,
+                        const Snapshot* baselineSnapshot,
+                        std::vector<uint8_t>& out)
+{
+    const uint32_t begin = snapshot.mTypeStart[type];
+    const uint32_t numCurrent = snapshot.mTypeStart[type + 1] - begin;
+    WriteVarint(numCurrent, out);
+    if(!numCurrent)
+    {
+        return;
+    }
+    QuantizedObject* current = &snapshot.mObjects[begin];
+
+    const uint32_t baselineType = ChooseBaselineType(baselineSnapshot, type);
+    WriteVarint(baselineType, out);
+
+    const QuantizedObject* baseline;
+    const uint32_t numBaseline = GetRange(baselineSnapshot, baselineType, baseline);
+
+    const QuantizedObject offset = FindRangeOffset(current, numCurrent, baseline, numBaseline);
+    WriteObject(offset, out);
+
+    OpWriter ops(out);
+    uint32_t base = 0;
+    for(uint32_t index = 0; index < numCurrent; )
+    {
+        if(base < numBaseline && Near(current[index], Add(baseline[base], offset)))
+        {
+            current[index] = Add(baseline[base], offset);
+            ops.add(OP_MATCH, 1);
+            ++index;
+            ++base;
+            continue;
+        }
+
+        uint32_t skip = 1;
+        while(skip <= MAX_SKIP_LOOKAHEAD && base + skip < numBaseline &&
+            !Near(current[index], Add(baseline[base + skip], offset)))
+        {
+            ++skip;
+        }
+        if(skip <= MAX_SKIP_LOOKAHEAD && base + skip < numBaseline)
+        {
+            ops.add(OP_SKIP, skip);
+            base += skip;
+            continue;
+        }
+
+        if(base < numBaseline)
+        {
+            ops.addObject(OP_LITERAL, Subtract(current[index], Add(baseline[base], offset)));
+            ++base;
+        }
+        else
+        {
+            ops.addObject(OP_NEW, current[index]);
+        }
+        ++index;
+    }
+    ops.flush();
+}
+
+static bool DecodeRange(PacketReader& reader,
+                        const Snapshot* baselineSnapshot,
+                        std::vector<QuantizedObject>& objects)
+{
+    const uint32_t numObjects = reader.readVarint();
+    if(!numObjects)
+    {
+        return !reader.failed();
+    }
+
+    const uint32_t baselineType = reader.readVarint();
+    if(baselineType >= NUM_OBJECT_TYPES)
+    {
+        return false;
+    }
+
+    const QuantizedObject* baseline;
+    const uint32_t numBaseline = GetRange(baselineSnapshot, baselineType, baseline);
+
+    QuantizedObject offset;
+    reader.readObject(offset);
+
+    uint32_t produced = 0;
+    uint32_t base = 0;
+    while(produced < numObjects && !reader.failed())
+    {
+        const uint32_t op = reader.readVarint();
+        const uint32_t count = op >> 2;
+        if(!count)
+        {
+            return false;
+        }
+
+        const bool usesBaseline = (op & 3) != OP_NEW;
+        const bool makesObjects = (op & 3) != OP_SKIP;
+        if((usesBaseline && count > numBaseline - base) ||
+            (makesObjects && count > numObjects - produced))
+        {
+            return false;
+        }
+
+        for(uint32_t index = 0; index < count; ++index)
+        {
+            QuantizedObject object;
+            switch(op & 3)
+            {
+            case OP_MATCH:
+                objects.push_back(Add(baseline[base + index], offset));
+                break;
+            case OP_LITERAL:
+                reader.readObject(object);
+                objects.push_back(Add(Add(baseline[base + index], offset), object));
+                break;
+            case OP_NEW:
+                reader.readObject(object);
+                objects.push_back(object);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if(usesBaseline)
+        {
+            base += count;
+        }
+        if(makesObjects)
+        {
+            produced += count;
+        }
+    }
+
+    return !reader.failed();
+}
+
+void QuantizeSnapshot(uint32_t tick,
+                      const SceneObjectVector& objects,
+                      Snapshot& snapshot)
+{
+    snapshot.mTick = tick;
+
+    //Counting sort by type. Objects keep their order within a type.
+    uint32_t counts[NUM_OBJECT_TYPES] = {0};
+    for(size_t index = 0; index < objects.size(); ++index)
+    {
+        assert(objects[index].mType < NUM_OBJECT_TYPES);
+        counts[objects[index].mType]++;
+    }
+
+    uint32_t start = 0;
+    uint32_t next[NUM_OBJECT_TYPES];
+    for(uint32_t type = 0; type < NUM_OBJECT_TYPES; ++type)
+    {
+        snapshot.mTypeStart[type] = start;
+        next[type] = start;
+        start += counts[type];
+    }
+    snapshot.mTypeStart[NUM_OBJECT_TYPES] = start;
+
+    snapshot.mObjects.resize(objects.size());
+    for(size_t index = 0; index < objects.size(); ++index)
+    {
+        const SceneObjectData& object = objects[index];
+        const float scale = static_cast<float>(SNAPSHOT_SUBPIXELS);
+
+        QuantizedObject& quantized = snapshot.mObjects[next[object.mType]++];
+        quantized.mX = static_cast<int32_t>(std::floor(object.mPosition.x() * scale + 0.5f));
+        quantized.mY = static_cast<int32_t>(std::floor(object.mPosition.y() * scale + 0.5f));
+        quantized.mVelocityX = static_cast<int32_t>(std::floor(object.mVelocity.x() * scale + 0.5f));
+        quantized.mVelocityY = static_cast<int32_t>(std::floor(object.mVelocity.y() * scale + 0.5f));
+    }
+}
+
+void ExpandSnapshot(const Snapshot& snapshot,
+                    SceneObjectVector& objects)
+{
+    const float scale = 1.0f / SNAPSHOT_SUBPIXELS;
+
+    objects.resize(snapshot.mObjects.size());
+    for(uint32_t type = 0; type < NUM_OBJECT_TYPES; ++type)
+    {
+        for(uint32_t index = snapshot.mTypeStart[type]; index < snapshot.mTypeStart[type + 1]; ++index)
+        {
+            const QuantizedObject& quantized = snapshot.mObjects[index];
+            objects[index].mType = static_cast<ObjectType>(type);
+            objects[index].mPosition = Vec2(quantized.mX * scale, quantized.mY * scale);
+            objects[index].mVelocity = Vec2(quantized.mVelocityX * scale, quantized.mVelocityY * scale);
+        }
+    }
+}
+
+SnapshotEncoder::SnapshotEncoder() : mNext(0),
+    mAckedTick(0)
+{
+    for(uint32_t index = 0; index < SNAPSHOT_HISTORY; ++index)
+    {
+        mHistory[index].mTick = 0;
+    }
+}
+
+uint32_t SnapshotEncoder::encode(uint32_t tick,
+                                 const SceneObjectVector& objects,
+                                 std::vector<uint8_t>& packet)
+{
+    assert(tick > 0);
+
+    Snapshot& snapshot = mHistory[mNext % SNAPSHOT_HISTORY];
+
+    const Snapshot* baseline = 0;
+    for(uint32_t index = 0; index < SNAPSHOT_HISTORY && mAckedTick; ++index)
+    {
+        //The slot about to be overwritten cannot be the baseline.
+        if(mHistory[index].mTick == mAckedTick && &mHistory[index] != &snapshot)
+        {
+            baseline = &mHistory[index];
+        }
+    }
+
+    QuantizeSnapshot(tick, objects, snapshot);
+    mNext++;
+
+    const size_t packetStart = packet.size();
+    WriteVarint(tick, packet);
+    WriteVarint(baseline ? tick - baseline->mTick : 0, packet);
+
+    for(uint32_t type = 0; type < NUM_OBJECT_TYPES; ++type)
+    {
+        EncodeRange(type, snapshot, baseline, packet);
+    }
+
+    return static_cast<uint32_t>(packet.size() - packetStart);
+}
+
+void SnapshotEncoder::acknowledge(uint32_t tick)
+{
+    if(tick > mAckedTick)
+    {
+        mAckedTick = tick;
+    }
+}
+
+const Snapshot& SnapshotEncoder::getLastSnapshot() const
+{
+    assert(mNext > 0);
+    return mHistory[(mNext - 1) % SNAPSHOT_HISTORY];
+}
+
+SnapshotDecoder::SnapshotDecoder() : mNext(0)
+{
+    for(uint32_t index = 0; index < SNAPSHOT_HISTORY; ++index)
+    {
+        mHistory[index].mTick = 0;
+    }
+}
+
+bool SnapshotDecoder::decode(const uint8_t* data,
+                             uint32_t size,
+                             uint32_t& tick,
+                             SceneObjectVector& objects)
+{
+    PacketReader reader(data, size);
+    tick = reader.readVarint();
+    const uint32_t baselineGap = reader.readVarint();
+    if(reader.failed() || !tick || baselineGap > tick)
+    {
+        return false;
+    }
+
+    Snapshot& snapshot = mHistory[mNext % SNAPSHOT_HISTORY];
+
+    const Snapshot* baseline = 0;
+    if(baselineGap)
+    {
+        for(uint32_t index = 0; index < SNAPSHOT_HISTORY; ++index)
+        {
+            if(mHistory[index].mTick == tick - baselineGap && &mHistory[index] != &snapshot)
+            {
+                baseline = &mHistory[index];
+            }
+        }
+        if(!baseline)
+        {
+            return false;
+        }
+    }
+
+    //The slot holds the oldest snapshot. Mark it unused until the packet
+    //has decoded cleanly.
+    snapshot.mTick = 0;
+    snapshot.mObjects.clear();
+    for(uint32_t type = 0; type < NUM_OBJECT_TYPES; ++type)
+    {
+        snapshot.mTypeStart[type] = static_cast<uint32_t>(snapshot.mObjects.size());
+        if(!DecodeRange(reader, baseline, snapshot.mObjects))
+        {
+            return false;
+        }
+    }
+    snapshot.mTypeStart[NUM_OBJECT_TYPES] = static_cast<uint32_t>(snapshot.mObjects.size());
+
+    if(!reader.atEnd())
+    {
+        return false;
+    }
+
+    snapshot.mTick = tick;
+    mNext++;
+
+    ExpandSnapshot(snapshot, objects);
+    return true;
+}
+
+const Snapshot& SnapshotDecoder::getLastSnapshot() const
+{
+    assert(mNext > 0);
+    return mHistory[(mNext - 1) % SNAPSHOT_HISTORY];
+}
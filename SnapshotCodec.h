@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_CODEC_H
+#define SNAPSHOT_CODEC_H
+
+#include <vector>
+#include "SceneObject.h"
+
+//Positions and velocities are sent in 1/SNAPSHOT_SUBPIXELS of a pixel.
+const int32_t SNAPSHOT_SUBPIXELS = 16;
+
+//A position within this many subpixels of its prediction is sent as
+//predicted. The error does not build up since the prediction is made from
+//what the decoder already has.
+const int32_t SNAPSHOT_POSITION_TOLERANCE = 1;
+
+//Snapshots each side keeps to diff against. An ack older than this
+//makes the encoder send the next snapshot in full.
+const uint32_t SNAPSHOT_HISTORY = 32;
+
+//Object as it travels in a snapshot.
+struct QuantizedObject
+{
+    int32_t mX;
+    int32_t mY;
+    int32_t mVelocityX;
+    int32_t mVelocityY;
+};
+
+//Objects grouped by type, in the order the snapshot lists them.
+struct Snapshot
+{
+    uint32_t mTick;
+    uint32_t mTypeStart[NUM_OBJECT_TYPES + 1];//Objects of type t are [mTypeStart[t], mTypeStart[t+1]).
+    std::vector<QuantizedObject> mObjects;
+};
+
+//Delta compresses a scene for spectators. Each packet is diffed against
+//the newest snapshot the receiver has acknowledged. Objects are grouped
+//into one range per type and each range is predicted as its baseline
+//range moved by one shared offset, which is how the alien formation and
+//every stream of rockets or bombs move. Only the objects that break the
+//prediction cost more than a few bits: runs of predicted objects, skipped
+//(destroyed) baseline objects, residuals and new objects are written as
+//varint coded ops.
+class SnapshotEncoder
+{
+public:
+    SnapshotEncoder();
+
+    //Append the packet for objects at tick (ticks start at 1 and increase)
+    //to packet. Returns the packet size in bytes.
+    uint32_t encode(uint32_t tick,
+                    const SceneObjectVector& objects,
+                    std::vector<uint8_t>& packet);
+
+    //The receiver has decoded the packet for tick.
+    void acknowledge(uint32_t tick);
+
+    //Snapshot last passed to encode, as the decoder will rebuild it.
+    const Snapshot& getLastSnapshot() const;
+
+private:
+    Snapshot mHistory[SNAPSHOT_HISTORY];
+    uint32_t mNext;
+    uint32_t mAckedTick;
+};
+
+class SnapshotDecoder
+{
+public:
+    SnapshotDecoder();
+
+    //Rebuild the objects of one packet. Returns false if the packet is
+    //malformed or its baseline is no longer known; the receiver should then
+    //not acknowledge it so the encoder falls back to an older baseline.
+    bool decode(const uint8_t* data,
+                uint32_t size,
+                uint32_t& tick,
+                SceneObjectVector& objects);
+
+    const Snapshot& getLastSnapshot() const;
+
+private:
+    Snapshot mHistory[SNAPSHOT_HISTORY];
+    uint32_t mNext;
+};
+
+//Group objects by type and quantize them the way SnapshotEncoder does.
+void QuantizeSnapshot(uint32_t tick,
+                      const SceneObjectVector& objects,
+                      Snapshot& snapshot);
+
+//Objects of snapshot as SceneObjectData in snapshot order.
+void ExpandSnapshot(const Snapshot& snapshot,
+                    SceneObjectVector& objects);
+
+#endif
@@ -0,0 +1,253 @@
+#define NOMINMAX
+#include <windows.h>
+#include <cassert>
+#include <cstring>
+
+#include "SoftwareInvaders.h"
+#include "AssetLoader.h"
+#include "Bitmap.h"
+#include "Hud.h"
+#include "Log.h"
+#include "ThreadPool.h"
+#include "TileRasterizer.h"
+#include "Timer.h"
+
+class SoftwareSprite : public ISprite
+{
+public:
+    SoftwareSprite(TileRasterizer& rasterizer, uint32_t image) : mRasterizer(rasterizer),
+        mImage(image)
+    {
+    }
+
+    virtual void destroy()
+    {
+        //Pixels are owned by the rasterizer and live until it is destroyed.
+        delete this;
+    }
+
+    virtual void draw(int x, int y)
+    {
+        mRasterizer.drawImage(mImage, x, y);
+    }
+
+private:
+    TileRasterizer& mRasterizer;
+    const uint32_t mImage;
+};
+
+class SoftwareInvaders : public IDiceInvaders
+{
+public:
+    SoftwareInvaders(uint32_t numThreads, AssetLoader& assets) : mPool(numThreads > 1 ? numThreads - 1 : 0),
+        mAssets(assets),
+        mWindow(0),
+        mQuit(false),
+        mFirstUpdate(true),
+        mFileOpens(0),
+        mBytesRead(0),
+        mSpritesLoaded(0),
+        mAssetNanoseconds(0)
+    {
+        mStartTime.QuadPart = 0;
+        mFrequency.QuadPart = 1;
+#if defined(SHOW_STATS)
+        mFilledTenths = -1;
+        mFillText[0] = 0;
+#endif
+    }
+
+    virtual void destroy()
+    {
+        if(mWindow)
+        {
+            DestroyWindow(mWindow);
+        }
+        delete this;
+    }
+
+    virtual bool init(int width, int height)
+    {
+        static const char* className = "DiceInvadersSoftware";
+
+        HINSTANCE instance = GetModuleHandleA(0);
+
+        WNDCLASSA windowClass = {};
+        windowClass.style = CS_OWNDC;
+        windowClass.lpfnWndProc = WindowProc;
+        windowClass.hInstance = instance;
+        windowClass.hCursor = LoadCursorA(0, IDC_ARROW);
+        windowClass.lpszClassName = className;
+        RegisterClassA(&windowClass);
+
+        const DWORD style = WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
+        RECT rect = {0, 0, width, height};
+        AdjustWindowRect(&rect, style, FALSE);
+
+        mWindow = CreateWindowExA(0, className, "Dice Invaders", style,
+            CW_USEDEFAULT, CW_USEDEFAULT, rect.right - rect.left, rect.bottom - rect.top,
+            0, 0, instance, this);
+        if(!mWindow)
+        {
+            return false;
+        }
+        ShowWindow(mWindow, SW_SHOW);
+
+        mRasterizer.init(width, height, mPool.getNumThreads() > 1 ? &mPool : 0);
+
+        QueryPerformanceFrequency(&mFrequency);
+        QueryPerformanceCounter(&mStartTime);
+        return true;
+    }
+
+    virtual bool update()
+    {
+        if(mFirstUpdate)
+        {
+            //All sprites have been created by now.
+            LogMessage("Sprites: %u from the loader, %u file opens, %u bytes read, %.3f ms in createSprite",
+                mSpritesLoaded, mFileOpens, mBytesRead,
+                NanosecondsToMilliseconds(mAssetNanoseconds));
+            mFirstUpdate = false;
+        }
+
+#if defined(SHOW_STATS)
+        {
+            //Share of the screen repainted last frame, in tenths of a
+            //percent. The text is only reformatted when that changes, so
+            //the rasterizer sees the same strip and need not repaint it.
+            const uint64_t screenPixels = static_cast<uint64_t>(mRasterizer.getWidth()) * mRasterizer.getHeight();
+            const int filledTenths = static_cast<int>((mRasterizer.getFilledPixels() * 1000ull + screenPixels / 2) / screenPixels);
+            if(filledTenths != mFilledTenths)
+            {
+                const uint32_t length = FormatFixed(filledTenths / 10.0f, 1, mFillText);
+                std::strcpy(mFillText + length, "% filled");
+                mFilledTenths = filledTenths;
+            }
+            mRasterizer.drawText(0, mRasterizer.getHeight()-96, mFillText);
+        }
+#endif
+        mRasterizer.rasterize();
+        present();
+
+        MSG msg;
+        while(PeekMessageA(&msg, 0, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessageA(&msg);
+        }
+
+        return !mQuit;
+    }
+
+    virtual ISprite* createSprite(const char* name)
+    {
+        const uint64_t startTime = GetTimeNanoseconds();
+        ISprite* sprite = 0;
+
+        //Waits for the loader the first time.
+        const uint32_t* loadedPixels = mAssets.getPixels(name);
+        if(loadedPixels)
+        {
+            sprite = new SoftwareSprite(mRasterizer, mRasterizer.addImageView(loadedPixels));
+            mSpritesLoaded++;
+        }
+        else
+        {
+            uint32_t pixels[RASTER_IMAGE_SIZE * RASTER_IMAGE_SIZE];
+            mFileOpens++;
+            if(LoadBmp(name, pixels, RASTER_IMAGE_SIZE, RASTER_IMAGE_SIZE))
+            {
+                sprite = new SoftwareSprite(mRasterizer, mRasterizer.addImage(pixels));
+                mBytesRead += sizeof(pixels);
+            }
+        }
+
+        mAssetNanoseconds += GetTimeNanoseconds() - startTime;
+        return sprite;
+    }
+
+    virtual void drawText(int x, int y, const char* msg)
+    {
+        mRasterizer.drawText(x, y, msg);
+    }
+
+    virtual float getElapsedTime()
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return static_cast<float>(static_cast<double>(now.QuadPart - mStartTime.QuadPart) / mFrequency.QuadPart);
+    }
+
+    virtual void getKeyStatus(KeyStatus& keys)
+    {
+        //Ignore the keyboard when the window is in the background.
+        const bool bFocus = GetForegroundWindow() == mWindow;
+        keys.fire = bFocus && (GetAsyncKeyState(VK_SPACE) & 0x8000) != 0;
+        keys.left = bFocus && (GetAsyncKeyState(VK_LEFT) & 0x8000) != 0;
+        keys.right = bFocus && (GetAsyncKeyState(VK_RIGHT) & 0x8000) != 0;
+    }
+
+private:
+    void present()
+    {
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(info.bmiHeader);
+        info.bmiHeader.biWidth = mRasterizer.getWidth();
+        info.bmiHeader.biHeight = -mRasterizer.getHeight();//Top-down rows.
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+
+        HDC dc = GetDC(mWindow);
+        StretchDIBits(dc, 0, 0, mRasterizer.getWidth(), mRasterizer.getHeight(),
+            0, 0, mRasterizer.getWidth(), mRasterizer.getHeight(),
+            mRasterizer.getPixels(), &info, DIB_RGB_COLORS, SRCCOPY);
+        ReleaseDC(mWindow, dc);
+    }
+
+    static LRESULT CALLBACK WindowProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        if(message == WM_NCCREATE)
+        {
+            const CREATESTRUCTA* create = reinterpret_cast<const CREATESTRUCTA*>(lParam);
+            SetWindowLongPtrA(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+        }
+
+        SoftwareInvaders* self = reinterpret_cast<SoftwareInvaders*>(GetWindowLongPtrA(window, GWLP_USERDATA));
+        if(self && message == WM_CLOSE)
+        {
+            self->mQuit = true;
+            return 0;
+        }
+
+        return DefWindowProcA(window, message, wParam, lParam);
+    }
+
+private:
+    ThreadPool mPool;
+    TileRasterizer mRasterizer;
+    AssetLoader& mAssets;
+    HWND mWindow;
+    bool mQuit;
+
+    //Startup asset statistics, logged on the first update.
+    bool mFirstUpdate;
+    uint32_t mFileOpens;
+    uint32_t mBytesRead;
+    uint32_t mSpritesLoaded;
+    uint64_t mAssetNanoseconds;
+    LARGE_INTEGER mStartTime;
+    LARGE_INTEGER mFrequency;
+
+#if defined(SHOW_STATS)
+    int mFilledTenths;//Value shown by mFillText.
+    char mFillText[MAX_HUD_TEXT];
+#endif
+};
+
+IDiceInvaders* CreateSoftwareInvaders(uint32_t numThreads, AssetLoader& assets)
+{
+    assert(numThreads > 0);
+    return new SoftwareInvaders(numThreads, assets);
+}
@@ -0,0 +1,25 @@
+#ifndef SOFTWARE_INVADERS_H
+#define SOFTWARE_INVADERS_H
+
+#include "DiceInvaders.h"
+#include "pstdint.h"
+
+class AssetLoader;
+
+//Written by AtlasPacker as part of the build.
+#define SPRITE_ATLAS_PATH "data/sprites.atlas"
+
+//IDiceInvaders backed by a CPU framebuffer instead of DiceInvaders.dll.
+//Sprites are rasterized by TileRasterizer on numThreads threads and
+//blitted to a GDI window on update(). numThreads == 1 is the single
+//threaded reference renderer.
+//
+//createSprite takes the pixels assets loaded for the name, which come
+//straight from the memory mapped SPRITE_ATLAS_PATH or were decoded on its
+//workers, and draws from them where they are. Only sprites it does not
+//have open and decode their BMP file there and then. assets must outlive
+//the system.
+IDiceInvaders* CreateSoftwareInvaders(uint32_t numThreads,
+                                      AssetLoader& assets);
+
+#endif
@@ -0,0 +1,54 @@
+#include "SpriteAtlas.h"
+#include <cstring>
+
+bool SpriteAtlas::open(const char* path)
+{
+    if(!mFile.open(path))
+    {
+        return false;
+    }
+
+    //Validate the index once so find() can trust it.
+    const AtlasHeader* header = reinterpret_cast<const AtlasHeader*>(mFile.getData());
+    bool bValid = mFile.getSize() >= sizeof(AtlasHeader) &&
+        header->mMagic == ATLAS_MAGIC &&
+        header->mVersion == ATLAS_VERSION &&
+        header->mFileSize == mFile.getSize() &&
+        sizeof(AtlasHeader) + header->mNumEntries * sizeof(AtlasEntry) <= mFile.getSize();
+
+    const AtlasEntry* entries = reinterpret_cast<const AtlasEntry*>(header + 1);
+    for(uint32_t index = 0; bValid && index < header->mNumEntries; ++index)
+    {
+        const AtlasEntry& entry = entries[index];
+        bValid = (entry.mOffset % ATLAS_ALIGNMENT) == 0 &&
+            entry.mOffset + static_cast<size_t>(entry.mWidth) * entry.mHeight * sizeof(uint32_t) <= mFile.getSize() &&
+            std::memchr(entry.mName, 0, ATLAS_NAME_SIZE) != 0;
+    }
+
+    if(!bValid)
+    {
+        mFile.close();
+    }
+    return bValid;
+}
+
+const uint32_t* SpriteAtlas::find(const char* name, uint32_t width, uint32_t height) const
+{
+    if(!isOpen())
+    {
+        return 0;
+    }
+
+    const AtlasHeader* header = reinterpret_cast<const AtlasHeader*>(mFile.getData());
+    const AtlasEntry* entries = reinterpret_cast<const AtlasEntry*>(header + 1);
+    for(uint32_t index = 0; index < header->mNumEntries; ++index)
+    {
+        if(entries[index].mWidth == width &&
+            entries[index].mHeight == height &&
+            std::strcmp(entries[index].mName, name) == 0)
+        {
+            return reinterpret_cast<const uint32_t*>(mFile.getData() + entries[index].mOffset);
+        }
+    }
+    return 0;
+}
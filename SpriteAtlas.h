@@ -0,0 +1,59 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include "pstdint.h"
+#include "MappedFile.h"
+
+//Pre-decoded sprite pack written by AtlasPacker. Layout:
+//  AtlasHeader
+//  AtlasEntry[mNumEntries]
+//  pixel blocks, each starting on an ATLAS_ALIGNMENT byte boundary
+//Pixels are 32-bit 0xAARRGGBB, top row first, as produced by DecodeBmp,
+//so they can be drawn straight out of the mapped file.
+const uint32_t ATLAS_MAGIC = 0x54414944;//"DIAT"
+const uint32_t ATLAS_VERSION = 1;
+const uint32_t ATLAS_ALIGNMENT = 64;
+const uint32_t ATLAS_NAME_SIZE = 48;
+
+struct AtlasHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mNumEntries;
+    uint32_t mFileSize;
+};
+
+//64 bytes so the index stays cache line sized.
+struct AtlasEntry
+{
+    char mName[ATLAS_NAME_SIZE];//Path the sprite was packed from.
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mOffset;//From the start of the file.
+    uint32_t mReserved;
+};
+
+class SpriteAtlas
+{
+public:
+    bool open(const char* path);
+
+    bool isOpen() const
+    {
+        return mFile.getData() != 0;
+    }
+
+    //Pixels of the sprite packed from name, or null if it is not in the
+    //atlas or has a different size. Points into the mapping.
+    const uint32_t* find(const char* name, uint32_t width, uint32_t height) const;
+
+    size_t getSize() const
+    {
+        return mFile.getSize();
+    }
+
+private:
+    MappedFile mFile;
+};
+
+#endif
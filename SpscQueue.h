@@ -0,0 +1,92 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "Atomics.h"
+
+//Lock-free fixed capacity queue for exactly one producer thread and one
+//consumer thread. Slots are written and read in place so elements holding
+//containers keep their capacity from one use to the next.
+template<typename T, uint32_t Capacity>
+class SpscQueue
+{
+    //Counters wrap at 2^32 which must be a multiple of the capacity.
+    typedef char CapacityMustBePowerOfTwo[(Capacity & (Capacity - 1)) == 0 ? 1 : -1];
+
+public:
+    SpscQueue() : mHead(0), mTail(0)
+    {
+    }
+
+    //Producer: slot to fill, or null if the queue is full.
+    T* beginPush()
+    {
+        const uint32_t tail = static_cast<uint32_t>(AtomicLoad(&mTail));
+        if(static_cast<uint32_t>(mHead) - tail == Capacity)
+        {
+            return 0;
+        }
+        return &mSlots[static_cast<uint32_t>(mHead) % Capacity];
+    }
+
+    //Producer: publish the slot returned by beginPush.
+    void endPush()
+    {
+        AtomicStore(&mHead, mHead + 1);
+    }
+
+    bool push(const T& value)
+    {
+        T* slot = beginPush();
+        if(!slot)
+        {
+            return false;
+        }
+        *slot = value;
+        endPush();
+        return true;
+    }
+
+    //Consumer: oldest element, or null if the queue is empty.
+    T* front()
+    {
+        const uint32_t head = static_cast<uint32_t>(AtomicLoad(&mHead));
+        if(head == static_cast<uint32_t>(mTail))
+        {
+            return 0;
+        }
+        return &mSlots[static_cast<uint32_t>(mTail) % Capacity];
+    }
+
+    //Consumer: release the slot returned by front.
+    void pop()
+    {
+        AtomicStore(&mTail, mTail + 1);
+    }
+
+    bool pop(T& value)
+    {
+        T* slot = front();
+        if(!slot)
+        {
+            return false;
+        }
+        value = *slot;
+        pop();
+        return true;
+    }
+
+private:
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+private:
+    T mSlots[Capacity];
+
+    //Each counter is written by one side only. Keep them on separate
+    //cache lines so the two threads do not fight over one line.
+    volatile int32_t mHead;
+    char mPadding[64 - sizeof(int32_t)];
+    volatile int32_t mTail;
+};
+
+#endif
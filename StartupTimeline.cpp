@@ -0,0 +1,94 @@
+#include "StartupTimeline.h"
+#include "Atomics.h"
+#include "Log.h"
+#include "Timer.h"
+#include <algorithm>
+
+namespace
+{
+    const uint32_t MAX_STARTUP_SPANS = 64;
+
+    struct Span
+    {
+        const char* mWhat;
+        const char* mDetail;
+        uint64_t mStart;
+        uint64_t mEnd;//0 until ended.
+    };
+
+    struct Timeline
+    {
+        uint64_t mOrigin;
+        volatile int32_t mNumSpans;//Taken, may be past MAX_STARTUP_SPANS.
+        Span mSpans[MAX_STARTUP_SPANS];
+    };
+
+    Timeline gTimeline;
+}
+
+static bool StartsEarlier(const Span& lhs, const Span& rhs)
+{
+    return lhs.mStart < rhs.mStart;
+}
+
+void StartupTimelineBegin()
+{
+    gTimeline.mOrigin = GetTimeNanoseconds();
+    gTimeline.mNumSpans = 0;
+}
+
+uint32_t StartupSpanBegin(const char* what, const char* detail)
+{
+    const uint32_t span = static_cast<uint32_t>(AtomicIncrement(&gTimeline.mNumSpans) - 1);
+    if(span < MAX_STARTUP_SPANS)
+    {
+        Span& entry = gTimeline.mSpans[span];
+        entry.mWhat = what;
+        entry.mDetail = detail;
+        entry.mEnd = 0;
+        entry.mStart = GetTimeNanoseconds();
+    }
+    return span;
+}
+
+void StartupSpanEnd(const uint32_t span)
+{
+    if(span < MAX_STARTUP_SPANS)
+    {
+        gTimeline.mSpans[span].mEnd = GetTimeNanoseconds();
+    }
+}
+
+void LogStartupTimeline()
+{
+    const uint32_t numTaken = static_cast<uint32_t>(AtomicLoad(&gTimeline.mNumSpans));
+    const uint32_t numSpans = std::min(numTaken, MAX_STARTUP_SPANS);
+
+    Span spans[MAX_STARTUP_SPANS];
+    std::copy(gTimeline.mSpans, gTimeline.mSpans + numSpans, spans);
+    std::stable_sort(spans, spans + numSpans, StartsEarlier);
+
+    const uint64_t origin = gTimeline.mOrigin;
+    uint64_t last = origin;
+    for(uint32_t index = 0; index < numSpans; ++index)
+    {
+        const Span& span = spans[index];
+        if(!span.mEnd)
+        {
+            LogMessage("Startup: %8.3f ms            %s %s (not ended)",
+                NanosecondsToMilliseconds(span.mStart - origin),
+                span.mWhat, span.mDetail ? span.mDetail : "");
+            continue;
+        }
+
+        LogMessage("Startup: %8.3f - %8.3f ms %8.3f ms %s %s",
+            NanosecondsToMilliseconds(span.mStart - origin),
+            NanosecondsToMilliseconds(span.mEnd - origin),
+            NanosecondsToMilliseconds(span.mEnd - span.mStart),
+            span.mWhat, span.mDetail ? span.mDetail : "");
+        last = std::max(last, span.mEnd);
+    }
+
+    LogMessage("Startup: %.3f ms in all, %u spans, %u dropped",
+        NanosecondsToMilliseconds(last - origin), numSpans, numTaken - numSpans);
+}
@@ -0,0 +1,48 @@
+#ifndef STARTUP_TIMELINE_H
+#define STARTUP_TIMELINE_H
+
+#include "pstdint.h"
+
+//Spans of startup work, on whatever thread does them, in milliseconds
+//from StartupTimelineBegin. Logged once the first frame is up so cold
+//start time can be followed as the game gets more to load.
+//
+//Spans are kept in a fixed table filled with an atomic index, so workers
+//can add theirs while the main thread adds its own. Names are not
+//copied and must outlive the timeline; string literals and the sprite
+//paths do. Spans past the table's end are counted and dropped.
+
+//The origin of every span. Call once, first thing.
+void StartupTimelineBegin();
+
+//Start a span named what, or what and detail (may be null). Returns the
+//span to end.
+uint32_t StartupSpanBegin(const char* what, const char* detail);
+void StartupSpanEnd(const uint32_t span);
+
+//Every span with its start, end and length, in the order they started,
+//and the time from the origin to the end of the last one.
+void LogStartupTimeline();
+
+//A span over a scope. detail may be null.
+class StartupSpan
+{
+public:
+    StartupSpan(const char* what, const char* detail) : mSpan(StartupSpanBegin(what, detail))
+    {
+    }
+
+    ~StartupSpan()
+    {
+        StartupSpanEnd(mSpan);
+    }
+
+private:
+    StartupSpan(const StartupSpan&);
+    StartupSpan& operator=(const StartupSpan&);
+
+private:
+    const uint32_t mSpan;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "ThreadPool.h"
+#include "Atomics.h"
+#include <algorithm>
+#include <cassert>
+
+ThreadPool::ThreadPool(uint32_t numWorkers) : mNumWorkers(numWorkers),
+    mFunc(0),
+    mContext(0),
+    mCount(0),
+    mGrainSize(1),
+    mNumChunks(0),
+    mNextChunk(0),
+    mGeneration(0),
+    mBusyWorkers(0),
+    mWorkersWoken(false),
+    mQuit(false)
+{
+    mWorkers.reserve(mNumWorkers);
+    for(uint32_t index = 0; index < mNumWorkers; ++index)
+    {
+        Thread* worker = new Thread;
+        worker->start(WorkerMain, this);
+        mWorkers.push_back(worker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        ScopedLock lock(mMutex);
+        mQuit = true;
+        mWorkReady.notifyAll();
+    }
+
+    for(size_t index = 0; index < mWorkers.size(); ++index)
+    {
+        mWorkers[index]->join();
+        delete mWorkers[index];
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count,
+                             uint32_t grainSize,
+                             ParallelForFunc func,
+                             void* context)
+{
+    beginParallelFor(count, grainSize, func, context);
+    endParallelFor();
+}
+
+void ThreadPool::beginParallelFor(uint32_t count,
+                                  uint32_t grainSize,
+                                  ParallelForFunc func,
+                                  void* context)
+{
+    assert(!mWorkersWoken);
+
+    grainSize = std::max(grainSize, 1u);
+    const uint32_t numChunks = (count + grainSize - 1) / grainSize;
+
+    //endParallelFor runs the chunks itself if it is not worth waking the
+    //workers.
+    if(mNumWorkers == 0 || numChunks <= 1)
+    {
+        mFunc = func;
+        mContext = context;
+        mCount = count;
+        mGrainSize = grainSize;
+        mNumChunks = numChunks;
+        mNextChunk = 0;
+        return;
+    }
+
+    ScopedLock lock(mMutex);
+    assert(mBusyWorkers == 0);
+    mFunc = func;
+    mContext = context;
+    mCount = count;
+    mGrainSize = grainSize;
+    mNumChunks = numChunks;
+    mNextChunk = 0;
+    mBusyWorkers = mNumWorkers;
+    mWorkersWoken = true;
+    ++mGeneration;
+    mWorkReady.notifyAll();
+}
+
+void ThreadPool::endParallelFor()
+{
+    runChunks();
+
+    if(!mWorkersWoken)
+    {
+        return;
+    }
+
+    //Every worker must have seen this generation before the job
+    //fields can be reused.
+    ScopedLock lock(mMutex);
+    while(mBusyWorkers)
+    {
+        mWorkDone.wait(mMutex);
+    }
+    mWorkersWoken = false;
+}
+
+void ThreadPool::runChunks()
+{
+    for(;;)
+    {
+        const uint32_t chunk = static_cast<uint32_t>(AtomicIncrement(&mNextChunk) - 1);
+        if(chunk >= mNumChunks)
+        {
+            break;
+        }
+
+        const uint32_t begin = chunk * mGrainSize;
+        mFunc(mContext, begin, std::min(begin + mGrainSize, mCount));
+    }
+}
+
+void ThreadPool::WorkerMain(void* context)
+{
+    ThreadPool* pool = static_cast<ThreadPool*>(context);
+    uint32_t seenGeneration = 0;
+
+    pool->mMutex.lock();
+    for(;;)
+    {
+        while(!pool->mQuit && pool->mGeneration == seenGeneration)
+        {
+            pool->mWorkReady.wait(pool->mMutex);
+        }
+
+        if(pool->mQuit)
+        {
+            break;
+        }
+
+        seenGeneration = pool->mGeneration;
+
+        pool->mMutex.unlock();
+        pool->runChunks();
+        pool->mMutex.lock();
+
+        if(--pool->mBusyWorkers == 0)
+        {
+            pool->mWorkDone.notifyAll();
+        }
+    }
+    pool->mMutex.unlock();
+}
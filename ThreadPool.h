@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include "pstdint.h"
+#include "Threading.h"
+
+//Called with a half open range [begin, end) of work items.
+typedef void (*ParallelForFunc)(void* context, uint32_t begin, uint32_t end);
+
+//Fixed set of worker threads that execute parallelFor jobs. The calling
+//thread takes part in every job, so a pool with 0 workers runs everything
+//inline on the caller.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint32_t numWorkers);
+    ~ThreadPool();
+
+    //Workers plus the calling thread.
+    uint32_t getNumThreads() const
+    {
+        return mNumWorkers + 1;
+    }
+
+    //Split [0, count) into chunks of grainSize items and call func on each
+    //chunk. Chunks are handed out dynamically so the order of execution is
+    //not defined. Returns when every chunk has completed.
+    void parallelFor(uint32_t count,
+                     uint32_t grainSize,
+                     ParallelForFunc func,
+                     void* context);
+
+    //parallelFor in two halves, so the calling thread can do work of its
+    //own while the workers start on the chunks. Every begin must be
+    //followed by an end, which runs the remaining chunks and returns when
+    //all have completed.
+    void beginParallelFor(uint32_t count,
+                          uint32_t grainSize,
+                          ParallelForFunc func,
+                          void* context);
+    void endParallelFor();
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    static void WorkerMain(void* context);
+    void runChunks();
+
+private:
+    Mutex mMutex;
+    ConditionVariable mWorkReady;
+    ConditionVariable mWorkDone;
+    std::vector<Thread*> mWorkers;
+    const uint32_t mNumWorkers;
+
+    //Current job. Written under mMutex before mGeneration is bumped.
+    ParallelForFunc mFunc;
+    void* mContext;
+    uint32_t mCount;
+    uint32_t mGrainSize;
+    uint32_t mNumChunks;
+    volatile int32_t mNextChunk;
+
+    uint32_t mGeneration;
+    uint32_t mBusyWorkers;
+    bool mWorkersWoken;//The current job was handed to the workers.
+    bool mQuit;
+};
+
+#endif
@@ -0,0 +1,275 @@
+#include "Threading.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <cassert>
+
+#if defined(_WIN32)
+
+namespace
+{
+    struct ThreadStart
+    {
+        ThreadFunc mFunc;
+        void* mContext;
+    };
+
+    DWORD WINAPI ThreadEntry(LPVOID param)
+    {
+        ThreadStart start = *static_cast<ThreadStart*>(param);
+        delete static_cast<ThreadStart*>(param);
+        start.mFunc(start.mContext);
+        return 0;
+    }
+}
+
+Thread::Thread() : mFunc(0), mContext(0), mHandle(0)
+{
+}
+
+Thread::~Thread()
+{
+    join();
+}
+
+bool Thread::start(ThreadFunc func, void* context)
+{
+    assert(!mHandle);
+    mFunc = func;
+    mContext = context;
+
+    ThreadStart* start = new ThreadStart;
+    start->mFunc = func;
+    start->mContext = context;
+
+    mHandle = CreateThread(0, 0, ThreadEntry, start, 0, 0);
+    if(!mHandle)
+    {
+        delete start;
+        return false;
+    }
+    return true;
+}
+
+void Thread::join()
+{
+    if(mHandle)
+    {
+        WaitForSingleObject(mHandle, INFINITE);
+        CloseHandle(mHandle);
+        mHandle = 0;
+    }
+}
+
+Mutex::Mutex() : mLock(0)
+{
+    //SRWLOCK is a single pointer which is zero when unlocked.
+    InitializeSRWLock(reinterpret_cast<PSRWLOCK>(&mLock));
+}
+
+Mutex::~Mutex()
+{
+}
+
+void Mutex::lock()
+{
+    AcquireSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&mLock));
+}
+
+void Mutex::unlock()
+{
+    ReleaseSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&mLock));
+}
+
+ConditionVariable::ConditionVariable() : mCondition(0)
+{
+    InitializeConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&mCondition));
+}
+
+ConditionVariable::~ConditionVariable()
+{
+}
+
+void ConditionVariable::wait(Mutex& mutex)
+{
+    SleepConditionVariableSRW(reinterpret_cast<PCONDITION_VARIABLE>(&mCondition),
+        reinterpret_cast<PSRWLOCK>(&mutex.mLock), INFINITE, 0);
+}
+
+void ConditionVariable::notifyOne()
+{
+    WakeConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&mCondition));
+}
+
+void ConditionVariable::notifyAll()
+{
+    WakeAllConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&mCondition));
+}
+
+uint32_t GetHardwareThreadCount()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+void ThreadYield()
+{
+    SwitchToThread();
+}
+
+void ThreadSleep(uint32_t microseconds)
+{
+    Sleep((microseconds + 999) / 1000);
+}
+
+void BeginHighResolutionSleep()
+{
+    timeBeginPeriod(1);
+}
+
+void EndHighResolutionSleep()
+{
+    timeEndPeriod(1);
+}
+
+#else
+
+namespace
+{
+    struct ThreadStart
+    {
+        ThreadFunc mFunc;
+        void* mContext;
+    };
+
+    void* ThreadEntry(void* param)
+    {
+        ThreadStart start = *static_cast<ThreadStart*>(param);
+        delete static_cast<ThreadStart*>(param);
+        start.mFunc(start.mContext);
+        return 0;
+    }
+}
+
+Thread::Thread() : mFunc(0), mContext(0), mStarted(false)
+{
+}
+
+Thread::~Thread()
+{
+    join();
+}
+
+bool Thread::start(ThreadFunc func, void* context)
+{
+    assert(!mStarted);
+    mFunc = func;
+    mContext = context;
+
+    ThreadStart* start = new ThreadStart;
+    start->mFunc = func;
+    start->mContext = context;
+
+    if(pthread_create(&mHandle, 0, ThreadEntry, start) != 0)
+    {
+        delete start;
+        return false;
+    }
+    mStarted = true;
+    return true;
+}
+
+void Thread::join()
+{
+    if(mStarted)
+    {
+        pthread_join(mHandle, 0);
+        mStarted = false;
+    }
+}
+
+Mutex::Mutex()
+{
+    pthread_mutex_init(&mLock, 0);
+}
+
+Mutex::~Mutex()
+{
+    pthread_mutex_destroy(&mLock);
+}
+
+void Mutex::lock()
+{
+    pthread_mutex_lock(&mLock);
+}
+
+void Mutex::unlock()
+{
+    pthread_mutex_unlock(&mLock);
+}
+
+ConditionVariable::ConditionVariable()
+{
+    pthread_cond_init(&mCondition, 0);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+    pthread_cond_destroy(&mCondition);
+}
+
+void ConditionVariable::wait(Mutex& mutex)
+{
+    pthread_cond_wait(&mCondition, &mutex.mLock);
+}
+
+void ConditionVariable::notifyOne()
+{
+    pthread_cond_signal(&mCondition);
+}
+
+void ConditionVariable::notifyAll()
+{
+    pthread_cond_broadcast(&mCondition);
+}
+
+uint32_t GetHardwareThreadCount()
+{
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? static_cast<uint32_t>(count) : 1;
+}
+
+void ThreadYield()
+{
+    sched_yield();
+}
+
+void ThreadSleep(uint32_t microseconds)
+{
+    timespec duration;
+    duration.tv_sec = microseconds / 1000000;
+    duration.tv_nsec = static_cast<long>(microseconds % 1000000) * 1000;
+    while(nanosleep(&duration, &duration) != 0 && errno == EINTR)
+    {
+    }
+}
+
+void BeginHighResolutionSleep()
+{
+}
+
+void EndHighResolutionSleep()
+{
+}
+
+#endif
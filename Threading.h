@@ -0,0 +1,121 @@
+#ifndef THREADING_H
+#define THREADING_H
+
+#include "pstdint.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+//Thin wrappers over the native threading primitives. Windows handles
+//are kept as void* so that windows.h is not pulled into every file.
+
+typedef void (*ThreadFunc)(void* context);
+
+class Thread
+{
+public:
+    Thread();
+    ~Thread();
+
+    bool start(ThreadFunc func, void* context);
+    void join();
+
+private:
+    Thread(const Thread&);
+    Thread& operator=(const Thread&);
+
+private:
+    ThreadFunc mFunc;
+    void* mContext;
+#if defined(_WIN32)
+    void* mHandle;
+#else
+    pthread_t mHandle;
+    bool mStarted;
+#endif
+};
+
+class Mutex
+{
+public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+private:
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+
+    friend class ConditionVariable;
+
+private:
+#if defined(_WIN32)
+    void* mLock;//SRWLOCK
+#else
+    pthread_mutex_t mLock;
+#endif
+};
+
+class ScopedLock
+{
+public:
+    explicit ScopedLock(Mutex& mutex) : mMutex(mutex)
+    {
+        mMutex.lock();
+    }
+
+    ~ScopedLock()
+    {
+        mMutex.unlock();
+    }
+
+private:
+    ScopedLock(const ScopedLock&);
+    ScopedLock& operator=(const ScopedLock&);
+
+private:
+    Mutex& mMutex;
+};
+
+class ConditionVariable
+{
+public:
+    ConditionVariable();
+    ~ConditionVariable();
+
+    //mutex must be locked by the caller.
+    void wait(Mutex& mutex);
+    void notifyOne();
+    void notifyAll();
+
+private:
+    ConditionVariable(const ConditionVariable&);
+    ConditionVariable& operator=(const ConditionVariable&);
+
+private:
+#if defined(_WIN32)
+    void* mCondition;//CONDITION_VARIABLE
+#else
+    pthread_cond_t mCondition;
+#endif
+};
+
+//Number of logical processors. Always at least 1.
+uint32_t GetHardwareThreadCount();
+
+//Give up the rest of the time slice. Used by spin waits.
+void ThreadYield();
+
+//Sleep for at least the given time. Windows rounds up to the scheduler
+//tick (15.6ms by default) unless high resolution sleep is on.
+void ThreadSleep(uint32_t microseconds);
+
+//Ask for a 1ms scheduler tick while a thread needs short sleeps. Calls
+//must be paired. Does nothing where sleeps are already precise.
+void BeginHighResolutionSleep();
+void EndHighResolutionSleep();
+
+#endif
@@ -0,0 +1,408 @@
+#include "TileRasterizer.h"
+#include "Bitmap.h"
+#include "Font5x7.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+const uint32_t TEXT_COLOUR = 0xFFFFFFFF;
+const uint32_t CLEAR_COLOUR = 0xFF000000;
+
+static bool SameCommand(const RasterCommand& a, const RasterCommand& b)
+{
+    return a.mX == b.mX && a.mY == b.mY &&
+        a.mWidth == b.mWidth && a.mHeight == b.mHeight &&
+        a.mImage == b.mImage && a.mKind == b.mKind;
+}
+
+struct Rect
+{
+    int mLeft;
+    int mTop;
+    int mRight;
+    int mBottom;
+};
+
+//Grow rect to cover command, clipped to clip.
+static void AddCommandRect(const RasterCommand& command, const Rect& clip, Rect& rect)
+{
+    rect.mLeft = std::min(rect.mLeft, std::max(clip.mLeft, static_cast<int>(command.mX)));
+    rect.mTop = std::min(rect.mTop, std::max(clip.mTop, static_cast<int>(command.mY)));
+    rect.mRight = std::max(rect.mRight, std::min(clip.mRight, command.mX + command.mWidth));
+    rect.mBottom = std::max(rect.mBottom, std::min(clip.mBottom, command.mY + command.mHeight));
+}
+
+TileRasterizer::TileRasterizer() : mWidth(0),
+    mHeight(0),
+    mTilesX(0),
+    mTilesY(0),
+    mPool(0),
+    mFilledPixels(0),
+    mFullRedraw(true),
+    mFrame(2),
+    mStripsRasterized(0)
+{
+    for(int strip = 0; strip < MAX_TEXT_STRIPS; ++strip)
+    {
+        mStrips[strip].mText[0] = 0;
+        mStrips[strip].mWidth = 0;
+        mStrips[strip].mLastUsedFrame = 0;
+    }
+}
+
+TileRasterizer::~TileRasterizer()
+{
+    for(size_t index = 0; index < mOwnedImages.size(); ++index)
+    {
+        delete [] mOwnedImages[index];
+    }
+}
+
+void TileRasterizer::init(int width, int height, ThreadPool* pool)
+{
+    mWidth = width;
+    mHeight = height;
+    mTilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    mTilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    mPool = pool;
+
+    mFramebuffer.assign(static_cast<size_t>(width) * height, CLEAR_COLOUR);
+    mTileStart.assign(mTilesX * mTilesY + 1, 0);
+    mPrevTileStart.assign(mTilesX * mTilesY + 1, 0);
+    mTileFilledPixels.assign(mTilesX * mTilesY, 0);
+    mCommands.reserve(1024);
+    mTileCommands.reserve(1024);
+    mPrevCommands.reserve(1024);
+    mPrevTileCommands.reserve(1024);
+    mFilledPixels = 0;
+    mFullRedraw = true;
+}
+
+uint32_t TileRasterizer::addImage(const uint32_t* pixels)
+{
+    uint32_t* image = new uint32_t[RASTER_IMAGE_SIZE * RASTER_IMAGE_SIZE];
+    std::memcpy(image, pixels, sizeof(uint32_t) * RASTER_IMAGE_SIZE * RASTER_IMAGE_SIZE);
+    mOwnedImages.push_back(image);
+    return addImageView(image);
+}
+
+uint32_t TileRasterizer::addImageView(const uint32_t* pixels)
+{
+    mImages.push_back(pixels);
+    return static_cast<uint32_t>(mImages.size() - 1);
+}
+
+void TileRasterizer::addCommand(int x, int y, int w, int h, uint16_t image, uint16_t kind)
+{
+    //Reject anything fully off screen now so coordinates fit in 16 bits.
+    if(x >= mWidth || y >= mHeight || x + w <= 0 || y + h <= 0)
+    {
+        return;
+    }
+
+    RasterCommand command;
+    command.mX = static_cast<int16_t>(x);
+    command.mY = static_cast<int16_t>(y);
+    command.mWidth = static_cast<uint16_t>(w);
+    command.mHeight = static_cast<uint16_t>(h);
+    command.mImage = image;
+    command.mKind = kind;
+    mCommands.push_back(command);
+}
+
+void TileRasterizer::drawImage(uint32_t image, int x, int y)
+{
+    assert(image < mImages.size());
+    addCommand(x, y, RASTER_IMAGE_SIZE, RASTER_IMAGE_SIZE, static_cast<uint16_t>(image), RASTER_IMAGE);
+}
+
+int TileRasterizer::findTextStrip(const char* msg)
+{
+    const size_t length = std::strlen(msg);
+    if(length == 0 || length > MAX_STRIP_CHARS)
+    {
+        return -1;
+    }
+
+    int oldest = -1;
+    for(int strip = 0; strip < MAX_TEXT_STRIPS; ++strip)
+    {
+        if(std::strcmp(mStrips[strip].mText, msg) == 0)
+        {
+            mStrips[strip].mLastUsedFrame = mFrame;
+            return strip;
+        }
+
+        if(mStrips[strip].mLastUsedFrame + 1 < mFrame &&
+            (oldest < 0 || mStrips[strip].mLastUsedFrame < mStrips[oldest].mLastUsedFrame))
+        {
+            oldest = strip;
+        }
+    }
+
+    if(oldest < 0)
+    {
+        return -1;
+    }
+
+    //Rasterize the string once into the replaced strip.
+    TextStrip& strip = mStrips[oldest];
+    std::memcpy(strip.mText, msg, length + 1);
+    strip.mWidth = static_cast<int>(length) * GLYPH_ADVANCE;
+    strip.mLastUsedFrame = mFrame;
+    strip.mPixels.assign(strip.mWidth * GLYPH_HEIGHT, TRANSPARENT_PIXEL);
+
+    for(size_t index = 0; index < length; ++index)
+    {
+        const uint32_t c = static_cast<unsigned char>(msg[index]);
+        if(c <= FONT_FIRST_CHAR || c > FONT_LAST_CHAR)
+        {
+            continue;
+        }
+
+        const uint8_t* glyph = FONT_5X7[c - FONT_FIRST_CHAR];
+        for(int y = 0; y < GLYPH_HEIGHT; ++y)
+        {
+            uint32_t* dst = &strip.mPixels[y * strip.mWidth + index * GLYPH_ADVANCE];
+            for(int x = 0; x < GLYPH_WIDTH; ++x)
+            {
+                if((glyph[x / GLYPH_SCALE] >> (y / GLYPH_SCALE)) & 1)
+                {
+                    dst[x] = TEXT_COLOUR;
+                }
+            }
+        }
+    }
+
+    mStripsRasterized++;
+    return oldest;
+}
+
+void TileRasterizer::drawText(int x, int y, const char* msg)
+{
+    const int strip = findTextStrip(msg);
+    if(strip >= 0)
+    {
+        addCommand(x, y, mStrips[strip].mWidth, GLYPH_HEIGHT, static_cast<uint16_t>(strip), RASTER_STRIP);
+        return;
+    }
+
+    //Too long or too many distinct strings this frame. Draw per glyph.
+    for(; *msg; ++msg, x += GLYPH_ADVANCE)
+    {
+        const uint32_t c = static_cast<unsigned char>(*msg);
+        if(c > FONT_FIRST_CHAR && c <= FONT_LAST_CHAR)
+        {
+            addCommand(x, y, GLYPH_WIDTH, GLYPH_HEIGHT, static_cast<uint16_t>(c), RASTER_GLYPH);
+        }
+    }
+}
+
+void TileRasterizer::binCommands()
+{
+    const uint32_t numTiles = mTilesX * mTilesY;
+    const uint32_t numCommands = static_cast<uint32_t>(mCommands.size());
+
+    std::fill(mTileStart.begin(), mTileStart.end(), 0);
+
+    //Count commands per tile. Commands were clipped against the screen
+    //when added so the tile range is never empty.
+    for(uint32_t index = 0; index < numCommands; ++index)
+    {
+        const RasterCommand& command = mCommands[index];
+        const uint32_t tx0 = std::max(0, static_cast<int>(command.mX)) / RASTER_TILE_SIZE;
+        const uint32_t ty0 = std::max(0, static_cast<int>(command.mY)) / RASTER_TILE_SIZE;
+        const uint32_t tx1 = std::min(mWidth - 1, command.mX + command.mWidth - 1) / RASTER_TILE_SIZE;
+        const uint32_t ty1 = std::min(mHeight - 1, command.mY + command.mHeight - 1) / RASTER_TILE_SIZE;
+
+        for(uint32_t ty = ty0; ty <= ty1; ++ty)
+        {
+            for(uint32_t tx = tx0; tx <= tx1; ++tx)
+            {
+                mTileStart[ty * mTilesX + tx + 1]++;
+            }
+        }
+    }
+
+    for(uint32_t tile = 0; tile < numTiles; ++tile)
+    {
+        mTileStart[tile + 1] += mTileStart[tile];
+    }
+
+    //Second pass writes the indices. Walking the commands in order keeps
+    //the submission order within every tile.
+    mTileCommands.resize(mTileStart[numTiles]);
+    std::vector<uint32_t>& cursor = mTileStart;
+    for(uint32_t index = 0; index < numCommands; ++index)
+    {
+        const RasterCommand& command = mCommands[index];
+        const uint32_t tx0 = std::max(0, static_cast<int>(command.mX)) / RASTER_TILE_SIZE;
+        const uint32_t ty0 = std::max(0, static_cast<int>(command.mY)) / RASTER_TILE_SIZE;
+        const uint32_t tx1 = std::min(mWidth - 1, command.mX + command.mWidth - 1) / RASTER_TILE_SIZE;
+        const uint32_t ty1 = std::min(mHeight - 1, command.mY + command.mHeight - 1) / RASTER_TILE_SIZE;
+
+        for(uint32_t ty = ty0; ty <= ty1; ++ty)
+        {
+            for(uint32_t tx = tx0; tx <= tx1; ++tx)
+            {
+                mTileCommands[cursor[ty * mTilesX + tx]++] = index;
+            }
+        }
+    }
+
+    //The cursors now hold the end of each tile which is the start of the
+    //next one. Shift back to get the starts again.
+    for(uint32_t tile = numTiles; tile > 0; --tile)
+    {
+        mTileStart[tile] = mTileStart[tile - 1];
+    }
+    mTileStart[0] = 0;
+}
+
+void TileRasterizer::drawCommand(const RasterCommand& command, int clipLeft, int clipTop, int clipRight, int clipBottom)
+{
+    const int left = std::max(clipLeft, static_cast<int>(command.mX));
+    const int top = std::max(clipTop, static_cast<int>(command.mY));
+    const int right = std::min(clipRight, command.mX + command.mWidth);
+    const int bottom = std::min(clipBottom, command.mY + command.mHeight);
+
+    if(command.mKind == RASTER_IMAGE || command.mKind == RASTER_STRIP)
+    {
+        //Both are images with a stride of their width.
+        const uint32_t* image = command.mKind == RASTER_IMAGE ?
+            mImages[command.mImage] : &mStrips[command.mImage].mPixels[0];
+        for(int y = top; y < bottom; ++y)
+        {
+            const uint32_t* src = image + (y - command.mY) * command.mWidth + (left - command.mX);
+            uint32_t* dst = &mFramebuffer[y * mWidth];
+            for(int x = left; x < right; ++x, ++src)
+            {
+                if(*src != TRANSPARENT_PIXEL)
+                {
+                    dst[x] = *src;
+                }
+            }
+        }
+    }
+    else
+    {
+        const uint8_t* glyph = FONT_5X7[command.mImage - FONT_FIRST_CHAR];
+        for(int y = top; y < bottom; ++y)
+        {
+            const int row = (y - command.mY) / GLYPH_SCALE;
+            uint32_t* dst = &mFramebuffer[y * mWidth];
+            for(int x = left; x < right; ++x)
+            {
+                const int column = (x - command.mX) / GLYPH_SCALE;
+                if((glyph[column] >> row) & 1)
+                {
+                    dst[x] = TEXT_COLOUR;
+                }
+            }
+        }
+    }
+}
+
+void TileRasterizer::rasterizeTile(uint32_t tile)
+{
+    Rect tileRect;
+    tileRect.mLeft = (tile % mTilesX) * RASTER_TILE_SIZE;
+    tileRect.mTop = (tile / mTilesX) * RASTER_TILE_SIZE;
+    tileRect.mRight = std::min(tileRect.mLeft + RASTER_TILE_SIZE, mWidth);
+    tileRect.mBottom = std::min(tileRect.mTop + RASTER_TILE_SIZE, mHeight);
+
+    const uint32_t begin = mTileStart[tile];
+    const uint32_t end = mTileStart[tile + 1];
+
+    Rect dirty = tileRect;
+    if(!mFullRedraw)
+    {
+        //Commands before the first difference produce the same pixels as
+        //last frame. Everything after it in either frame may have changed.
+        const uint32_t prevBegin = mPrevTileStart[tile];
+        const uint32_t prevEnd = mPrevTileStart[tile + 1];
+        uint32_t same = 0;
+        while(begin + same < end && prevBegin + same < prevEnd &&
+            SameCommand(mCommands[mTileCommands[begin + same]], mPrevCommands[mPrevTileCommands[prevBegin + same]]))
+        {
+            ++same;
+        }
+
+        if(begin + same == end && prevBegin + same == prevEnd)
+        {
+            mTileFilledPixels[tile] = 0;
+            return;
+        }
+
+        dirty.mLeft = tileRect.mRight;
+        dirty.mTop = tileRect.mBottom;
+        dirty.mRight = tileRect.mLeft;
+        dirty.mBottom = tileRect.mTop;
+        for(uint32_t index = begin + same; index < end; ++index)
+        {
+            AddCommandRect(mCommands[mTileCommands[index]], tileRect, dirty);
+        }
+        for(uint32_t index = prevBegin + same; index < prevEnd; ++index)
+        {
+            AddCommandRect(mPrevCommands[mPrevTileCommands[index]], tileRect, dirty);
+        }
+    }
+
+    for(int y = dirty.mTop; y < dirty.mBottom; ++y)
+    {
+        std::fill(&mFramebuffer[y * mWidth + dirty.mLeft], &mFramebuffer[y * mWidth + dirty.mRight], CLEAR_COLOUR);
+    }
+
+    //Earlier commands can overlap the dirty rectangle so every command
+    //of the tile is replayed, clipped to it.
+    for(uint32_t index = begin; index < end; ++index)
+    {
+        const RasterCommand& command = mCommands[mTileCommands[index]];
+        if(command.mX < dirty.mRight && command.mX + command.mWidth > dirty.mLeft &&
+            command.mY < dirty.mBottom && command.mY + command.mHeight > dirty.mTop)
+        {
+            drawCommand(command, dirty.mLeft, dirty.mTop, dirty.mRight, dirty.mBottom);
+        }
+    }
+
+    mTileFilledPixels[tile] = (dirty.mRight - dirty.mLeft) * (dirty.mBottom - dirty.mTop);
+}
+
+void TileRasterizer::RasterizeTiles(void* context, uint32_t begin, uint32_t end)
+{
+    TileRasterizer* rasterizer = static_cast<TileRasterizer*>(context);
+    for(uint32_t tile = begin; tile < end; ++tile)
+    {
+        rasterizer->rasterizeTile(tile);
+    }
+}
+
+void TileRasterizer::rasterize()
+{
+    binCommands();
+
+    const uint32_t numTiles = mTilesX * mTilesY;
+    if(mPool)
+    {
+        mPool->parallelFor(numTiles, 1, RasterizeTiles, this);
+    }
+    else
+    {
+        RasterizeTiles(this, 0, numTiles);
+    }
+
+    mFilledPixels = 0;
+    for(uint32_t tile = 0; tile < numTiles; ++tile)
+    {
+        mFilledPixels += mTileFilledPixels[tile];
+    }
+
+    //This frame becomes the reference for the next one.
+    mCommands.swap(mPrevCommands);
+    mTileStart.swap(mPrevTileStart);
+    mTileCommands.swap(mPrevTileCommands);
+    mCommands.clear();
+    mFullRedraw = false;
+    mFrame++;
+}
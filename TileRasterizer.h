@@ -0,0 +1,165 @@
+#ifndef TILE_RASTERIZER_H
+#define TILE_RASTERIZER_H
+
+#include <vector>
+#include "pstdint.h"
+
+class ThreadPool;
+
+//All images are 32*32 pixels, same as the sprites of IDiceInvaders.
+const int RASTER_IMAGE_SIZE = 32;
+
+//Screen is split into square tiles which are rasterized independently.
+const int RASTER_TILE_SIZE = 64;
+
+//Text uses the 5x7 font scaled up by GLYPH_SCALE.
+const int GLYPH_SCALE = 2;
+const int GLYPH_WIDTH = 5 * GLYPH_SCALE;
+const int GLYPH_HEIGHT = 8 * GLYPH_SCALE;
+const int GLYPH_ADVANCE = 6 * GLYPH_SCALE;
+
+//Rasterized strings kept for reuse by drawText.
+const int MAX_TEXT_STRIPS = 16;
+const int MAX_STRIP_CHARS = 63;
+
+enum RasterCommandKind {
+    RASTER_IMAGE,
+    RASTER_GLYPH,
+    RASTER_STRIP,
+};
+
+//One queued draw. Coordinates are the upper left corner in pixels.
+struct RasterCommand
+{
+    int16_t mX;
+    int16_t mY;
+    uint16_t mWidth;
+    uint16_t mHeight;
+    uint16_t mImage;//Image index, character code or text strip.
+    uint16_t mKind;
+};
+
+//A whole string rasterized once and then blitted like an image.
+struct TextStrip
+{
+    char mText[MAX_STRIP_CHARS + 1];
+    int mWidth;
+    uint32_t mLastUsedFrame;
+    std::vector<uint32_t> mPixels;//mWidth * GLYPH_HEIGHT
+};
+
+//Software renderer for a 32-bit framebuffer. Draws are queued and binned
+//into screen tiles on rasterize(). Each tile replays its commands in
+//submission order, so the output does not depend on how many threads the
+//tiles are spread over.
+//
+//The framebuffer is kept between frames. A tile whose command list matches
+//the previous frame is skipped. Otherwise only the dirty rectangle, the
+//union of the commands after the first difference in either frame, is
+//cleared and redrawn.
+class TileRasterizer
+{
+public:
+    TileRasterizer();
+    ~TileRasterizer();
+
+    //pool may be null in which case tiles are rasterized on the caller.
+    void init(int width, int height, ThreadPool* pool);
+
+    //Copy a 32*32 image. Returns the index to pass to drawImage.
+    uint32_t addImage(const uint32_t* pixels);
+
+    //Same as addImage but draws straight from pixels, which must stay
+    //valid for the lifetime of the rasterizer (e.g. a mapped SpriteAtlas).
+    uint32_t addImageView(const uint32_t* pixels);
+
+    void drawImage(uint32_t image, int x, int y);
+
+    //Strings seen in recent frames are drawn from a cached strip, so a
+    //HUD line costs one command instead of one per character.
+    void drawText(int x, int y, const char* msg);
+
+    //Rasterize and then discard all queued commands.
+    void rasterize();
+
+    //Force the next rasterize() to repaint the whole screen.
+    void invalidate()
+    {
+        mFullRedraw = true;
+    }
+
+    //Number of pixels cleared and redrawn by the last rasterize().
+    uint32_t getFilledPixels() const
+    {
+        return mFilledPixels;
+    }
+
+    //Number of text strips rasterized since init.
+    uint32_t getStripsRasterized() const
+    {
+        return mStripsRasterized;
+    }
+
+    const uint32_t* getPixels() const
+    {
+        return mFramebuffer.empty() ? 0 : &mFramebuffer[0];
+    }
+
+    int getWidth() const
+    {
+        return mWidth;
+    }
+
+    int getHeight() const
+    {
+        return mHeight;
+    }
+
+private:
+    TileRasterizer(const TileRasterizer&);
+    TileRasterizer& operator=(const TileRasterizer&);
+
+    void addCommand(int x, int y, int w, int h, uint16_t image, uint16_t kind);
+    int findTextStrip(const char* msg);
+    void binCommands();
+    void rasterizeTile(uint32_t tile);
+    void drawCommand(const RasterCommand& command, int left, int top, int right, int bottom);
+
+    static void RasterizeTiles(void* context, uint32_t begin, uint32_t end);
+
+private:
+    int mWidth;
+    int mHeight;
+    uint32_t mTilesX;
+    uint32_t mTilesY;
+    ThreadPool* mPool;
+
+    std::vector<uint32_t> mFramebuffer;
+    std::vector<const uint32_t*> mImages;
+    std::vector<uint32_t*> mOwnedImages;
+
+    std::vector<RasterCommand> mCommands;
+
+    //Command indices of each tile are mTileCommands[mTileStart[t]] to
+    //mTileCommands[mTileStart[t+1]-1].
+    std::vector<uint32_t> mTileStart;
+    std::vector<uint32_t> mTileCommands;
+
+    //Last frame's binned commands, swapped with the current ones after
+    //each rasterize().
+    std::vector<RasterCommand> mPrevCommands;
+    std::vector<uint32_t> mPrevTileStart;
+    std::vector<uint32_t> mPrevTileCommands;
+
+    std::vector<uint32_t> mTileFilledPixels;
+    uint32_t mFilledPixels;
+    bool mFullRedraw;
+
+    //A strip drawn this frame or the last one is referenced by the command
+    //lists used for dirty tracking, so only older strips are replaced.
+    TextStrip mStrips[MAX_TEXT_STRIPS];
+    uint32_t mFrame;
+    uint32_t mStripsRasterized;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "Timer.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#if defined(_WIN32)
+
+uint64_t GetTimeNanoseconds()
+{
+    static LARGE_INTEGER frequency = {};
+    if(frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    //Split to avoid overflowing 64 bits with high frequency counters.
+    const uint64_t seconds = now.QuadPart / frequency.QuadPart;
+    const uint64_t remainder = now.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000ull + remainder * 1000000000ull / frequency.QuadPart;
+}
+
+uint64_t GetProcessCpuNanoseconds()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if(!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0;
+    }
+
+    //FILETIME counts 100ns intervals.
+    const uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    const uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return (kernel + user) * 100;
+}
+
+#else
+
+uint64_t GetTimeNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+uint64_t GetProcessCpuNanoseconds()
+{
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+    const uint64_t seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec;
+    const uint64_t microseconds = usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    return seconds * 1000000000ull + microseconds * 1000ull;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "pstdint.h"
+
+//Monotonic high resolution clock with an arbitrary origin.
+uint64_t GetTimeNanoseconds();
+
+//User plus kernel time used by all threads of this process so far.
+uint64_t GetProcessCpuNanoseconds();
+
+inline double NanosecondsToMilliseconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / 1000000.0;
+}
+
+#endif
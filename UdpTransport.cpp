@@ -0,0 +1,183 @@
+#include "UdpTransport.h"
+#include "Log.h"
+#include "Timer.h"
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+static const uintptr_t NO_SOCKET = INVALID_SOCKET;
+#else
+static const int NO_SOCKET = -1;
+#endif
+
+UdpTransport::UdpTransport() : mSocket(NO_SOCKET),
+    mOpen(false),
+    mRemotePort(0),
+    mLatency(0),
+    mJitter(0),
+    mLossPercent(0),
+    mRandom(1),
+    mNumDelayed(0)
+{
+}
+
+UdpTransport::~UdpTransport()
+{
+    if(mSocket != NO_SOCKET)
+    {
+#if defined(_WIN32)
+        closesocket(mSocket);
+#else
+        close(mSocket);
+#endif
+    }
+
+#if defined(_WIN32)
+    if(mOpen)
+    {
+        WSACleanup();
+    }
+#endif
+}
+
+bool UdpTransport::open(uint16_t localPort, uint16_t remotePort)
+{
+#if defined(_WIN32)
+    WSADATA data;
+    if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        LogMessage("UdpTransport: WSAStartup failed");
+        return false;
+    }
+#endif
+    mOpen = true;
+    mRemotePort = remotePort;
+
+    mSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(mSocket == NO_SOCKET)
+    {
+        LogMessage("UdpTransport: socket failed");
+        return false;
+    }
+
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    ioctlsocket(mSocket, FIONBIO, &nonBlocking);
+#else
+    fcntl(mSocket, F_SETFL, fcntl(mSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(localPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        LogMessage("UdpTransport: cannot bind port %u", localPort);
+        return false;
+    }
+
+    //Seed the conditions from the port so the two peers do not drop and
+    //delay in step.
+    mRandom = localPort;
+    return true;
+}
+
+void UdpTransport::setConditions(uint32_t latency, uint32_t jitter, uint32_t lossPercent)
+{
+    mLatency = latency * 1000000ull;
+    mJitter = jitter * 1000000ull;
+    mLossPercent = lossPercent;
+}
+
+void UdpTransport::send(const void* data, uint32_t size)
+{
+    if(size > MAX_DATAGRAM_SIZE)
+    {
+        return;
+    }
+
+    mRandom = mRandom * 1664525u + 1013904223u;
+    if((mRandom >> 8) % 100 < mLossPercent)
+    {
+        return;
+    }
+
+    if(!mLatency && !mJitter)
+    {
+        sendNow(static_cast<const uint8_t*>(data), size);
+        return;
+    }
+
+    //A full queue loses the datagram like a full router would.
+    if(mNumDelayed == MAX_DELAYED)
+    {
+        return;
+    }
+
+    mRandom = mRandom * 1664525u + 1013904223u;
+    DelayedDatagram& delayed = mDelayed[mNumDelayed++];
+    delayed.mDueTime = GetTimeNanoseconds() + mLatency +
+        (mJitter ? (mRandom >> 8) % mJitter : 0);
+    delayed.mSize = size;
+    std::memcpy(delayed.mData, data, size);
+}
+
+void UdpTransport::flush()
+{
+    const uint64_t now = GetTimeNanoseconds();
+    uint32_t index = 0;
+    while(index < mNumDelayed)
+    {
+        if(mDelayed[index].mDueTime <= now)
+        {
+            sendNow(mDelayed[index].mData, mDelayed[index].mSize);
+            mDelayed[index] = mDelayed[--mNumDelayed];
+        }
+        else
+        {
+            ++index;
+        }
+    }
+}
+
+uint32_t UdpTransport::receive(void* buffer, uint32_t capacity)
+{
+    if(mSocket == NO_SOCKET)
+    {
+        return 0;
+    }
+
+    //The sender is not checked. The caller validates every datagram.
+    const int received = recvfrom(mSocket, static_cast<char*>(buffer), capacity, 0, 0, 0);
+    return received > 0 ? static_cast<uint32_t>(received) : 0;
+}
+
+void UdpTransport::sendNow(const uint8_t* data, uint32_t size)
+{
+    if(mSocket == NO_SOCKET)
+    {
+        return;
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(mRemotePort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    //Errors such as the peer not listening yet are ignored, the next
+    //datagram carries the same inputs again.
+    sendto(mSocket, reinterpret_cast<const char*>(data), size, 0,
+        reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
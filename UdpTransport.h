@@ -0,0 +1,71 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include "pstdint.h"
+
+//Connectionless datagram link between two processes on 127.0.0.1, with
+//optional artificial network conditions for testing. Outgoing datagrams
+//are held for the configured latency plus a random jitter before they
+//reach the socket, and a percentage of them are dropped, so two peers on
+//one machine see roughly what they would over the internet. Jitter can
+//reorder datagrams the same way a real network does.
+class UdpTransport
+{
+public:
+    static const uint32_t MAX_DATAGRAM_SIZE = 256;
+
+    UdpTransport();
+    ~UdpTransport();
+
+    //Bind localPort and address everything to remotePort.
+    bool open(uint16_t localPort, uint16_t remotePort);
+
+    //Delay every datagram by latency plus up to jitter milliseconds and
+    //drop lossPercent of them. All zero by default.
+    void setConditions(uint32_t latency, uint32_t jitter, uint32_t lossPercent);
+
+    //Queue a datagram of at most MAX_DATAGRAM_SIZE bytes. Sent by flush
+    //once it is due.
+    void send(const void* data, uint32_t size);
+
+    //Send the queued datagrams that are due. Call every frame.
+    void flush();
+
+    //Copy the next received datagram to buffer. Returns its size, or 0 if
+    //nothing is waiting.
+    uint32_t receive(void* buffer, uint32_t capacity);
+
+private:
+    UdpTransport(const UdpTransport&);
+    UdpTransport& operator=(const UdpTransport&);
+
+    void sendNow(const uint8_t* data, uint32_t size);
+
+private:
+    struct DelayedDatagram
+    {
+        uint64_t mDueTime;
+        uint32_t mSize;
+        uint8_t mData[MAX_DATAGRAM_SIZE];
+    };
+
+    static const uint32_t MAX_DELAYED = 256;
+
+#if defined(_WIN32)
+    uintptr_t mSocket;//SOCKET
+#else
+    int mSocket;
+#endif
+    bool mOpen;
+    uint16_t mRemotePort;
+
+    uint64_t mLatency;//Nanoseconds.
+    uint64_t mJitter;
+    uint32_t mLossPercent;
+    uint32_t mRandom;
+
+    DelayedDatagram mDelayed[MAX_DELAYED];//Unordered.
+    uint32_t mNumDelayed;
+};
+
+#endif